@@ -52,7 +52,9 @@ void AST::insert(const Token& token) {
   if (!m_current) {
     throw EvalError("Inserting node " + n->print() + " returned a deficient current node");
   }
-  m_log.debug("AST: " + print());
+  if (m_log.isDebug()) {
+    m_log.debug("AST: " + print());
+  }
 }
 
 void AST::evaluate() {
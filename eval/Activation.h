@@ -0,0 +1,66 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Activation_h_
+#define _Activation_h_
+
+/* Activation of a function body
+ *
+ * The nodes of a function body hold the state of the call that is running
+ * it: which nodes have been evaluated, and their results.  When the body is
+ * re-entered (it calls itself, directly or not), Block::call() saves that
+ * state into an Activation, runs the inner call, then puts it back so the
+ * outer call carries on where it left off.
+ *
+ * Node::saveActivation() and restoreActivation() walk the body in the same
+ * order, so the state is just three queues read back in the order it was
+ * written.  An Activation holds a reference to each Object saved in it, and
+ * hands it back on restore; any it still has when destroyed are released.
+ */
+
+#include "Object.h"
+#include "Value.h"
+
+#include <stddef.h>
+#include <vector>
+
+namespace eval {
+
+class Activation {
+public:
+  Activation()
+    : m_nextFlag(0),
+      m_nextValue(0),
+      m_nextObject(0) {}
+  ~Activation() {
+    for (size_t i = m_nextObject; i < m_objects.size(); ++i) {
+      if (m_objects[i]) m_objects[i]->release();
+    }
+  }
+
+  void saveFlag(bool flag) { m_flags.push_back(flag); }
+  bool restoreFlag() { return m_flags.at(m_nextFlag++); }
+
+  void saveValue(const Value& value) { m_values.push_back(value); }
+  const Value& restoreValue() { return m_values.at(m_nextValue++); }
+
+  // Saves a reference to object, which may be NULL
+  void saveObject(Object* object) {
+    if (object) object->retain();
+    m_objects.push_back(object);
+  }
+  // The caller takes over our reference
+  Object* restoreObject() { return m_objects.at(m_nextObject++); }
+
+private:
+  std::vector<bool> m_flags;
+  std::vector<Value> m_values;
+  std::vector<Object*> m_objects;
+  size_t m_nextFlag;
+  size_t m_nextValue;
+  size_t m_nextObject;
+};
+
+};
+
+#endif // _Activation_h_
@@ -0,0 +1,258 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Arithmetic.h"
+
+#include "EvalError.h"
+
+#include <limits>
+#include <stdint.h>
+using std::numeric_limits;
+
+using namespace eval;
+
+namespace {
+  const int64_t INT_MAX64 = numeric_limits<int64_t>::max();
+  const int64_t INT_MIN64 = numeric_limits<int64_t>::min();
+  const int64_t SCALE = Value::FIXED_SCALE;
+
+  void check(bool ok, const char* what) {
+    if (!ok) {
+      throw EvalError(std::string("Arithmetic error: ") + what);
+    }
+  }
+
+  // A non-negative int power
+  uint64_t exponent(const Value& r) {
+    check(r.getInt().isSmall(), "^ has too large a power");
+    return (uint64_t)r.getInt().getSmall();
+  }
+
+  // (a * b) / c without overflowing the intermediate product
+  bool mulDiv(int64_t a, int64_t b, int64_t c, int64_t& result) {
+    if (0 == c) return false;
+#if defined(__SIZEOF_INT128__)
+    // __extension__, since -pedantic has no 128-bit types
+    __extension__ typedef __int128 int128;
+    int128 r = (int128)a * b / c;
+    if (r > INT_MAX64 || r < INT_MIN64) return false;
+    result = (int64_t)r;
+    return true;
+#else
+    int64_t product;
+    if (!Arithmetic::Mul(a, b, product)) return false;
+    return Arithmetic::Div(product, c, result);
+#endif
+  }
+
+  /* int kernels: int64 when both operands and the result fit, else
+     BigInt */
+
+  void intAdd(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Add(a, b, x)) {
+      out = Value::Int(x);
+    } else {
+      out = Value::Int(l.getInt() + r.getInt());
+    }
+  }
+  void intSub(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Sub(a, b, x)) {
+      out = Value::Int(x);
+    } else {
+      out = Value::Int(l.getInt() - r.getInt());
+    }
+  }
+  void intMul(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Mul(a, b, x)) {
+      out = Value::Int(x);
+    } else {
+      out = Value::Int(l.getInt() * r.getInt());
+    }
+  }
+  void intDiv(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Div(a, b, x)) {
+      out = Value::Int(x);
+    } else {
+      out = Value::Int(l.getInt() / r.getInt());
+    }
+  }
+  void intMod(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Mod(a, b, x)) {
+      out = Value::Int(x);
+    } else {
+      out = Value::Int(l.getInt() % r.getInt());
+    }
+  }
+  void intPow(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallInt(a) && r.getSmallInt(b) && Arithmetic::Pow(a, b, x)) {
+      out = Value::Int(x);
+      return;
+    }
+    check(!r.getInt().isNegative(), "int ^ has a negative power");
+    out = Value::Int(BigInt::Pow(l.getInt(), exponent(r)));
+  }
+  void intPlus(const Value& l, const Value&, Value& out) {
+    out = l;
+  }
+  void intNeg(const Value& l, const Value&, Value& out) {
+    out = Value::Int(-l.getInt());
+  }
+
+  /* fixed kernels; either operand may be an int */
+
+  void fixedAdd(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallFixed(a) && r.getSmallFixed(b) && Arithmetic::Add(a, b, x)) {
+      out = Value::Fixed(x);
+    } else {
+      out = Value::Fixed(l.getFixed() + r.getFixed());
+    }
+  }
+  void fixedSub(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallFixed(a) && r.getSmallFixed(b) && Arithmetic::Sub(a, b, x)) {
+      out = Value::Fixed(x);
+    } else {
+      out = Value::Fixed(l.getFixed() - r.getFixed());
+    }
+  }
+  void fixedMul(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallFixed(a) && r.getSmallFixed(b) && mulDiv(a, b, SCALE, x)) {
+      out = Value::Fixed(x);
+    } else {
+      out = Value::Fixed(l.getFixed() * r.getFixed() / BigInt(SCALE));
+    }
+  }
+  void fixedDiv(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallFixed(a) && r.getSmallFixed(b) && mulDiv(a, SCALE, b, x)) {
+      out = Value::Fixed(x);
+    } else {
+      out = Value::Fixed(l.getFixed() * BigInt(SCALE) / r.getFixed());
+    }
+  }
+  void fixedMod(const Value& l, const Value& r, Value& out) {
+    int64_t a, b, x;
+    if (l.getSmallFixed(a) && r.getSmallFixed(b) && Arithmetic::Mod(a, b, x)) {
+      out = Value::Fixed(x);
+    } else {
+      out = Value::Fixed(l.getFixed() % r.getFixed());
+    }
+  }
+  // A fixed to an int power.  Each step truncates to FIXED_DIGITS places, as
+  // repeated * would.
+  void fixedPow(const Value& l, const Value& r, Value& out) {
+    check(!r.getInt().isNegative(), "fixed ^ has a negative power");
+    uint64_t exp = exponent(r);
+    BigInt scale(SCALE);
+    BigInt base = l.getFixed();
+    BigInt x = scale;
+    while (exp > 0) {
+      if (exp & 1) {
+        x = x * base / scale;
+      }
+      exp >>= 1;
+      if (exp > 0) {
+        base = base * base / scale;
+      }
+    }
+    out = Value::Fixed(x);
+  }
+  void fixedPlus(const Value& l, const Value&, Value& out) {
+    out = Value::Fixed(l.getFixed());
+  }
+  void fixedNeg(const Value& l, const Value&, Value& out) {
+    out = Value::Fixed(-l.getFixed());
+  }
+};
+
+Arithmetic::kernel_fn Arithmetic::Select(Operator::KIND kind,
+                                         Operator::ARITY arity,
+                                         bool isFixed) {
+  if (Operator::PREFIX == arity) {
+    switch (kind) {
+      case Operator::KIND_PLUS:  return isFixed ? fixedPlus : intPlus;
+      case Operator::KIND_MINUS: return isFixed ? fixedNeg : intNeg;
+      default: return NULL;
+    }
+  } else if (Operator::INFIX == arity) {
+    switch (kind) {
+      case Operator::KIND_PLUS:    return isFixed ? fixedAdd : intAdd;
+      case Operator::KIND_MINUS:   return isFixed ? fixedSub : intSub;
+      case Operator::KIND_STAR:    return isFixed ? fixedMul : intMul;
+      case Operator::KIND_SLASH:   return isFixed ? fixedDiv : intDiv;
+      case Operator::KIND_PERCENT: return isFixed ? fixedMod : intMod;
+      case Operator::KIND_CARAT:   return isFixed ? fixedPow : intPow;
+      default: return NULL;
+    }
+  }
+  return NULL;
+}
+
+bool Arithmetic::Add(int64_t a, int64_t b, int64_t& result) {
+  if ((b > 0 && a > INT_MAX64 - b) || (b < 0 && a < INT_MIN64 - b)) {
+    return false;
+  }
+  result = a + b;
+  return true;
+}
+
+bool Arithmetic::Sub(int64_t a, int64_t b, int64_t& result) {
+  if ((b < 0 && a > INT_MAX64 + b) || (b > 0 && a < INT_MIN64 + b)) {
+    return false;
+  }
+  result = a - b;
+  return true;
+}
+
+bool Arithmetic::Mul(int64_t a, int64_t b, int64_t& result) {
+  if (a != 0 && b != 0) {
+    if (a > 0 ? (b > 0 ? a > INT_MAX64 / b : b < INT_MIN64 / a)
+              : (b > 0 ? a < INT_MIN64 / b : b < INT_MAX64 / a)) {
+      return false;
+    }
+  }
+  result = a * b;
+  return true;
+}
+
+bool Arithmetic::Div(int64_t a, int64_t b, int64_t& result) {
+  if (0 == b || (INT_MIN64 == a && -1 == b)) {
+    return false;
+  }
+  result = a / b;
+  return true;
+}
+
+bool Arithmetic::Mod(int64_t a, int64_t b, int64_t& result) {
+  if (0 == b || (INT_MIN64 == a && -1 == b)) {
+    return false;
+  }
+  result = a % b;
+  return true;
+}
+
+// Square-and-multiply, checking each step for overflow
+bool Arithmetic::Pow(int64_t a, int64_t b, int64_t& result) {
+  if (b < 0) {
+    return false;
+  }
+  int64_t base = a;
+  int64_t r = 1;
+  while (b > 0) {
+    if (b & 1) {
+      if (!Mul(r, base, r)) return false;
+    }
+    b >>= 1;
+    if (b > 0 && !Mul(base, base, base)) return false;
+  }
+  result = r;
+  return true;
+}
@@ -0,0 +1,46 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Arithmetic_h_
+#define _Arithmetic_h_
+
+/* Arithmetic kernels
+ *
+ * Built-in arithmetic on stdlib numbers.  When an Operator's operand types
+ * are both known to be numeric, analysis picks one of these kernels for its
+ * operator, arity and result kind (int, or fixed if either side is), and
+ * evaluation is then a single call on the operands' unboxed Values, with no
+ * type tests, method lookup or allocation.
+ *
+ * Each kernel computes in int64 while the operands and result fit, and
+ * otherwise in BigInt, so arithmetic never overflows.  Division by zero and
+ * negative int powers throw an EvalError.
+ */
+
+#include "Operator.h"
+#include "Value.h"
+
+namespace eval {
+
+class Arithmetic {
+public:
+  // Computes result from the operands; a prefix kernel ignores right
+  typedef void (*kernel_fn)(const Value& left, const Value& right,
+                            Value& result);
+
+  // The kernel for an operator, or NULL if it is not built-in arithmetic
+  static kernel_fn Select(Operator::KIND kind, Operator::ARITY arity,
+                          bool isFixed);
+
+  // Checked int64 operations; false on overflow or an undefined operation
+  static bool Add(int64_t a, int64_t b, int64_t& result);
+  static bool Sub(int64_t a, int64_t b, int64_t& result);
+  static bool Mul(int64_t a, int64_t b, int64_t& result);
+  static bool Div(int64_t a, int64_t b, int64_t& result);
+  static bool Mod(int64_t a, int64_t b, int64_t& result);
+  static bool Pow(int64_t a, int64_t b, int64_t& result);
+};
+
+};
+
+#endif // _Arithmetic_h_
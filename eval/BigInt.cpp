@@ -0,0 +1,515 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "BigInt.h"
+
+#include "Arithmetic.h"
+#include "EvalError.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <stdint.h>
+#include <string>
+using std::string;
+
+using namespace eval;
+
+const size_t BigInt::KARATSUBA_LIMBS;
+const uint64_t BigInt::MAX_BITS;
+
+namespace {
+  typedef BigInt::limb_vec limb_vec;
+
+  const uint64_t LIMB_BASE = (uint64_t)1 << 32;
+  // The largest power of ten in a limb, and its number of digits
+  const uint32_t DECIMAL_BASE = 1000000000;
+  const size_t DECIMAL_DIGITS = 9;
+  // Values at least this long are printed by divide and conquer
+  const size_t PRINT_SPLIT_LIMBS = 64;
+
+  void trim(limb_vec& a) {
+    while (!a.empty() && 0 == a.back()) {
+      a.pop_back();
+    }
+  }
+
+  int compareMag(const limb_vec& a, const limb_vec& b) {
+    if (a.size() != b.size()) {
+      return a.size() < b.size() ? -1 : 1;
+    }
+    for (size_t i = a.size(); i-- > 0; ) {
+      if (a[i] != b[i]) {
+        return a[i] < b[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+
+  limb_vec addMag(const limb_vec& a, const limb_vec& b) {
+    const limb_vec& longer = a.size() < b.size() ? b : a;
+    const limb_vec& shorter = a.size() < b.size() ? a : b;
+    limb_vec r(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+      uint64_t t = (uint64_t)longer[i] + carry;
+      if (i < shorter.size()) t += shorter[i];
+      r[i] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    r[longer.size()] = (uint32_t)carry;
+    trim(r);
+    return r;
+  }
+
+  // a - b, where |a| >= |b|
+  limb_vec subMag(const limb_vec& a, const limb_vec& b) {
+    limb_vec r(a.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < a.size(); ++i) {
+      int64_t t = (int64_t)a[i] - borrow;
+      if (i < b.size()) t -= b[i];
+      borrow = t < 0 ? 1 : 0;
+      r[i] = (uint32_t)(t + (borrow ? LIMB_BASE : 0));
+    }
+    trim(r);
+    return r;
+  }
+
+  // r += a << (32 * shift)
+  void addShifted(limb_vec& r, const limb_vec& a, size_t shift) {
+    if (r.size() < a.size() + shift + 1) {
+      r.resize(a.size() + shift + 1, 0);
+    }
+    uint64_t carry = 0;
+    size_t i = 0;
+    for (; i < a.size(); ++i) {
+      uint64_t t = (uint64_t)r[i + shift] + a[i] + carry;
+      r[i + shift] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    for (i += shift; carry && i < r.size(); ++i) {
+      uint64_t t = (uint64_t)r[i] + carry;
+      r[i] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    if (carry) {
+      r.push_back((uint32_t)carry);
+    }
+  }
+
+  limb_vec slice(const limb_vec& a, size_t begin, size_t end) {
+    begin = std::min(begin, a.size());
+    end = std::min(end, a.size());
+    limb_vec r(a.begin() + begin, a.begin() + end);
+    trim(r);
+    return r;
+  }
+
+  limb_vec schoolbookMul(const limb_vec& a, const limb_vec& b) {
+    limb_vec r(a.size() + b.size(), 0);
+    for (size_t i = 0; i < a.size(); ++i) {
+      uint64_t carry = 0;
+      for (size_t j = 0; j < b.size(); ++j) {
+        uint64_t t = (uint64_t)a[i] * b[j] + r[i + j] + carry;
+        r[i + j] = (uint32_t)t;
+        carry = t >> 32;
+      }
+      r[i + b.size()] = (uint32_t)carry;
+    }
+    trim(r);
+    return r;
+  }
+
+  limb_vec mulMag(const limb_vec& a, const limb_vec& b) {
+    if (a.empty() || b.empty()) {
+      return limb_vec();
+    }
+    const limb_vec& longer = a.size() < b.size() ? b : a;
+    const limb_vec& shorter = a.size() < b.size() ? a : b;
+    if (shorter.size() < BigInt::KARATSUBA_LIMBS) {
+      return schoolbookMul(a, b);
+    }
+    size_t half = longer.size() / 2;
+    if (shorter.size() <= half) {
+      // Too lopsided to split both evenly: multiply the shorter by each
+      // shorter-sized block of the longer
+      limb_vec r;
+      for (size_t i = 0; i < longer.size(); i += shorter.size()) {
+        addShifted(r, mulMag(slice(longer, i, i + shorter.size()), shorter), i);
+      }
+      trim(r);
+      return r;
+    }
+    // Karatsuba: with a = a1*B + a0 and b = b1*B + b0 for B = 2^(32*half),
+    // a*b = z2*B^2 + (z1 - z2 - z0)*B + z0, for three half-size products
+    limb_vec a0 = slice(a, 0, half), a1 = slice(a, half, a.size());
+    limb_vec b0 = slice(b, 0, half), b1 = slice(b, half, b.size());
+    limb_vec z0 = mulMag(a0, b0);
+    limb_vec z2 = mulMag(a1, b1);
+    limb_vec z1 = mulMag(addMag(a0, a1), addMag(b0, b1));
+    z1 = subMag(subMag(z1, z0), z2);
+    limb_vec r(z0);
+    addShifted(r, z1, half);
+    addShifted(r, z2, 2 * half);
+    trim(r);
+    return r;
+  }
+
+  // a = a * m + add
+  void mulAddSmall(limb_vec& a, uint32_t m, uint32_t add) {
+    uint64_t carry = add;
+    for (size_t i = 0; i < a.size(); ++i) {
+      uint64_t t = (uint64_t)a[i] * m + carry;
+      a[i] = (uint32_t)t;
+      carry = t >> 32;
+    }
+    if (carry) {
+      a.push_back((uint32_t)carry);
+    }
+  }
+
+  // a = a / d, returning the remainder
+  uint32_t divSmall(limb_vec& a, uint32_t d) {
+    uint64_t rem = 0;
+    for (size_t i = a.size(); i-- > 0; ) {
+      uint64_t t = (rem << 32) | a[i];
+      a[i] = (uint32_t)(t / d);
+      rem = t % d;
+    }
+    trim(a);
+    return (uint32_t)rem;
+  }
+
+  // divSmall(a, DECIMAL_BASE), with a constant divisor the compiler can turn
+  // into a multiplication; this is the inner loop of print()
+  uint32_t divDecimal(limb_vec& a) {
+    uint64_t rem = 0;
+    for (size_t i = a.size(); i-- > 0; ) {
+      uint64_t t = (rem << 32) | a[i];
+      uint64_t q = t / DECIMAL_BASE;
+      a[i] = (uint32_t)q;
+      rem = t - q * DECIMAL_BASE;
+    }
+    trim(a);
+    return (uint32_t)rem;
+  }
+
+  // Knuth's Algorithm D (TAOCP 4.3.1), on magnitudes with |v| > 0
+  void divModMag(const limb_vec& u, const limb_vec& v,
+                 limb_vec& q, limb_vec& r) {
+    if (compareMag(u, v) < 0) {
+      q.clear();
+      r = u;
+      return;
+    }
+    if (1 == v.size()) {
+      q = u;
+      uint32_t rem = divSmall(q, v[0]);
+      r.clear();
+      if (rem) r.push_back(rem);
+      return;
+    }
+    size_t n = v.size();
+    size_t m = u.size() - n;
+    // Normalize so the top limb of the divisor has its high bit set
+    int s = __builtin_clz(v[n - 1]);
+    limb_vec vn(n), un(u.size() + 1);
+    for (size_t i = n - 1; i > 0; --i) {
+      vn[i] = (v[i] << s) | (s ? v[i - 1] >> (32 - s) : 0);
+    }
+    vn[0] = v[0] << s;
+    un[u.size()] = s ? u[u.size() - 1] >> (32 - s) : 0;
+    for (size_t i = u.size() - 1; i > 0; --i) {
+      un[i] = (u[i] << s) | (s ? u[i - 1] >> (32 - s) : 0);
+    }
+    un[0] = u[0] << s;
+
+    q.assign(m + 1, 0);
+    for (size_t j = m + 1; j-- > 0; ) {
+      // Estimate the quotient limb from the top two limbs, then correct it
+      uint64_t num = ((uint64_t)un[j + n] << 32) | un[j + n - 1];
+      uint64_t qhat = num / vn[n - 1];
+      uint64_t rhat = num % vn[n - 1];
+      while (qhat >= LIMB_BASE ||
+             qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2])) {
+        --qhat;
+        rhat += vn[n - 1];
+        if (rhat >= LIMB_BASE) break;
+      }
+      // Multiply and subtract
+      int64_t k = 0;
+      int64_t t;
+      for (size_t i = 0; i < n; ++i) {
+        uint64_t p = qhat * vn[i];
+        t = (int64_t)un[i + j] - k - (int64_t)(p & 0xFFFFFFFF);
+        un[i + j] = (uint32_t)t;
+        k = (int64_t)(p >> 32) - (t >> 32);
+      }
+      t = (int64_t)un[j + n] - k;
+      un[j + n] = (uint32_t)t;
+      q[j] = (uint32_t)qhat;
+      if (t < 0) {
+        // Subtracted one too many; add it back
+        --q[j];
+        uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+          uint64_t sum = (uint64_t)un[i + j] + vn[i] + carry;
+          un[i + j] = (uint32_t)sum;
+          carry = sum >> 32;
+        }
+        un[j + n] += (uint32_t)carry;
+      }
+    }
+    trim(q);
+    // Unnormalize the remainder
+    r.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+      r[i] = (uint32_t)(((((uint64_t)un[i + 1]) << 32) | un[i]) >> s);
+    }
+    trim(r);
+  }
+  // Appends the decimal digits of mag to out, zero-padded on the left to
+  // width.  Long values are split in two by the largest power of ten
+  // 10^(9 * 2^i) in powers that leaves halves of similar size, so that most
+  // of the work is in divModMag() rather than in one divDecimal() per nine
+  // digits.
+  void printMag(const limb_vec& mag, size_t width,
+                std::vector<limb_vec>& powers, string& out) {
+    if (mag.size() < PRINT_SPLIT_LIMBS) {
+      limb_vec rest(mag);
+      std::vector<uint32_t> chunks;
+      while (!rest.empty()) {
+        chunks.push_back(divDecimal(rest));
+      }
+      string s;
+      for (size_t i = chunks.size(); i-- > 0; ) {
+        string digits = boost::lexical_cast<string>(chunks[i]);
+        s += (s.empty() ? "" : string(DECIMAL_DIGITS - digits.size(), '0')) +
+             digits;
+      }
+      if (s.size() < width) {
+        out += string(width - s.size(), '0');
+      }
+      out += s;
+      return;
+    }
+    if (powers.empty()) {
+      powers.push_back(limb_vec(1, DECIMAL_BASE));
+    }
+    while (2 * powers.back().size() <= mag.size()) {
+      powers.push_back(mulMag(powers.back(), powers.back()));
+    }
+    size_t i = powers.size() - 1;
+    while (i > 0 && 2 * powers[i].size() > mag.size()) {
+      --i;
+    }
+    size_t digits = DECIMAL_DIGITS << i;
+    limb_vec hi, lo;
+    divModMag(mag, powers[i], hi, lo);
+    printMag(hi, width > digits ? width - digits : 0, powers, out);
+    printMag(lo, digits, powers, out);
+  }
+};
+
+BigInt BigInt::Parse(const string& text) {
+  bool negative = !text.empty() && '-' == text[0];
+  size_t begin = negative ? 1 : 0;
+  if (begin == text.size()) {
+    throw EvalError("Cannot parse an integer from '" + text + "'");
+  }
+  for (size_t i = begin; i < text.size(); ++i) {
+    if (text[i] < '0' || text[i] > '9') {
+      throw EvalError("Cannot parse an integer from '" + text + "'");
+    }
+  }
+  // Short enough for an int64 outright
+  if (text.size() - begin <= 2 * DECIMAL_DIGITS) {
+    int64_t r = 0;
+    for (size_t i = begin; i < text.size(); ++i) {
+      r = r * 10 + (text[i] - '0');
+    }
+    return BigInt(negative ? -r : r);
+  }
+  limb_vec mag;
+  size_t chunk = (text.size() - begin) % DECIMAL_DIGITS;
+  if (0 == chunk) chunk = DECIMAL_DIGITS;
+  for (size_t i = begin; i < text.size(); ) {
+    uint32_t digits = 0;
+    uint32_t scale = 1;
+    for (size_t end = i + chunk; i < end; ++i) {
+      digits = digits * 10 + (text[i] - '0');
+      scale *= 10;
+    }
+    mulAddSmall(mag, scale, digits);
+    chunk = DECIMAL_DIGITS;
+  }
+  return Make(mag, negative);
+}
+
+string BigInt::print() const {
+  if (isSmall()) {
+    return boost::lexical_cast<string>(m_small);
+  }
+  string s = m_negative ? "-" : "";
+  std::vector<limb_vec> powers;
+  printMag(m_limbs, 0, powers, s);
+  return s;
+}
+
+int64_t BigInt::getSmall() const {
+  if (!isSmall()) {
+    throw EvalError("Integer " + print() + " is too large for this use");
+  }
+  return m_small;
+}
+
+size_t BigInt::bits() const {
+  limb_vec mag = magnitude();
+  if (mag.empty()) return 0;
+  return 32 * mag.size() - __builtin_clz(mag.back());
+}
+
+int BigInt::Compare(const BigInt& a, const BigInt& b) {
+  if (a.isSmall() && b.isSmall()) {
+    return a.m_small < b.m_small ? -1 : (a.m_small > b.m_small ? 1 : 0);
+  }
+  if (a.isNegative() != b.isNegative()) {
+    return a.isNegative() ? -1 : 1;
+  }
+  int c = compareMag(a.magnitude(), b.magnitude());
+  return a.isNegative() ? -c : c;
+}
+
+BigInt BigInt::operator-() const {
+  if (isSmall() && m_small != std::numeric_limits<int64_t>::min()) {
+    return BigInt(-m_small);
+  }
+  limb_vec mag = magnitude();
+  return Make(mag, !isNegative());
+}
+
+BigInt BigInt::operator+(const BigInt& b) const {
+  int64_t r;
+  if (isSmall() && b.isSmall() && Arithmetic::Add(m_small, b.m_small, r)) {
+    return BigInt(r);
+  }
+  limb_vec x = magnitude(), y = b.magnitude();
+  if (isNegative() == b.isNegative()) {
+    limb_vec sum = addMag(x, y);
+    return Make(sum, isNegative());
+  }
+  // Opposite signs: the larger magnitude decides the sign
+  if (compareMag(x, y) >= 0) {
+    limb_vec diff = subMag(x, y);
+    return Make(diff, isNegative());
+  }
+  limb_vec diff = subMag(y, x);
+  return Make(diff, b.isNegative());
+}
+
+BigInt BigInt::operator-(const BigInt& b) const {
+  int64_t r;
+  if (isSmall() && b.isSmall() && Arithmetic::Sub(m_small, b.m_small, r)) {
+    return BigInt(r);
+  }
+  return *this + -b;
+}
+
+BigInt BigInt::operator*(const BigInt& b) const {
+  int64_t r;
+  if (isSmall() && b.isSmall() && Arithmetic::Mul(m_small, b.m_small, r)) {
+    return BigInt(r);
+  }
+  if (bits() + b.bits() > MAX_BITS) {
+    throw EvalError("Integer product is too large");
+  }
+  limb_vec product = mulMag(magnitude(), b.magnitude());
+  return Make(product, isNegative() != b.isNegative());
+}
+
+BigInt BigInt::operator/(const BigInt& b) const {
+  BigInt q, r;
+  DivMod(*this, b, q, r);
+  return q;
+}
+
+BigInt BigInt::operator%(const BigInt& b) const {
+  BigInt q, r;
+  DivMod(*this, b, q, r);
+  return r;
+}
+
+void BigInt::DivMod(const BigInt& a, const BigInt& b,
+                    BigInt& quotient, BigInt& remainder) {
+  if (b.isZero()) {
+    throw EvalError("Integer division by zero");
+  }
+  int64_t q, r;
+  if (a.isSmall() && b.isSmall() && Arithmetic::Div(a.m_small, b.m_small, q) &&
+      Arithmetic::Mod(a.m_small, b.m_small, r)) {
+    quotient = BigInt(q);
+    remainder = BigInt(r);
+    return;
+  }
+  limb_vec qmag, rmag;
+  divModMag(a.magnitude(), b.magnitude(), qmag, rmag);
+  quotient = Make(qmag, a.isNegative() != b.isNegative());
+  remainder = Make(rmag, a.isNegative());
+}
+
+// Square-and-multiply
+BigInt BigInt::Pow(const BigInt& base, uint64_t exp) {
+  if (0 == exp) {
+    return BigInt(1);
+  }
+  // 0, 1 and -1 stay small however high the power; anything else grows by
+  // at least a bit per step
+  if (base.bits() > 1 && exp > MAX_BITS / (base.bits() - 1)) {
+    throw EvalError("Integer power is too large");
+  }
+  BigInt b(base);
+  BigInt r(1);
+  while (exp > 0) {
+    if (exp & 1) {
+      r = r * b;
+    }
+    exp >>= 1;
+    if (exp > 0) {
+      b = b * b;
+    }
+  }
+  return r;
+}
+
+/* private */
+
+BigInt::limb_vec BigInt::magnitude() const {
+  if (!isSmall()) {
+    return m_limbs;
+  }
+  uint64_t u = m_small < 0 ? 0 - (uint64_t)m_small : (uint64_t)m_small;
+  limb_vec mag;
+  if (u) mag.push_back((uint32_t)u);
+  if (u >> 32) mag.push_back((uint32_t)(u >> 32));
+  return mag;
+}
+
+BigInt BigInt::Make(limb_vec& mag, bool negative) {
+  trim(mag);
+  if (mag.size() <= 2) {
+    uint64_t u = mag.empty() ? 0 : mag[0];
+    if (2 == mag.size()) u |= (uint64_t)mag[1] << 32;
+    const uint64_t max = std::numeric_limits<int64_t>::max();
+    if (u <= max) {
+      return BigInt(negative ? -(int64_t)u : (int64_t)u);
+    } else if (negative && max + 1 == u) {
+      return BigInt(std::numeric_limits<int64_t>::min());
+    }
+  }
+  BigInt r;
+  r.m_limbs.swap(mag);
+  r.m_negative = negative;
+  return r;
+}
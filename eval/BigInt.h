@@ -0,0 +1,85 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _BigInt_h_
+#define _BigInt_h_
+
+/* Arbitrary-precision integer
+ *
+ * An int literal may have any number of digits, and int arithmetic never
+ * wraps, so ints are BigInts.  Almost all of them are small, though, so a
+ * BigInt that fits in an int64 is kept inline as one and never allocates;
+ * only a larger value spills into a vector of 32-bit limbs (sign and
+ * magnitude, least significant limb first).  Every result is normalized, so
+ * isSmall() is exactly "fits in an int64".
+ *
+ * Multiplication is schoolbook for short operands and Karatsuba beyond
+ * KARATSUBA_LIMBS.  Division truncates toward zero, and the remainder takes
+ * the sign of the dividend, as for int64.  Conversion to and from decimal
+ * works nine digits at a time.
+ *
+ * fixed values are BigInts too: a count of 1/Value::FIXED_SCALE units.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class BigInt {
+public:
+  // Operands shorter than this many limbs are multiplied directly
+  static const size_t KARATSUBA_LIMBS = 32;
+  // Refuse to compute results with more bits than this
+  static const uint64_t MAX_BITS = 1 << 26;
+
+  BigInt(int64_t i = 0)
+    : m_small(i), m_negative(false) {}
+
+  // Optional '-' followed by decimal digits; throws if malformed
+  static BigInt Parse(const std::string& text);
+  std::string print() const;
+
+  bool isSmall() const { return m_limbs.empty(); }
+  // Throws unless isSmall()
+  int64_t getSmall() const;
+  bool isZero() const { return isSmall() && 0 == m_small; }
+  bool isNegative() const { return isSmall() ? m_small < 0 : m_negative; }
+  size_t bits() const;
+
+  // <0, 0 or >0 as a is less than, equal to, or greater than b
+  static int Compare(const BigInt& a, const BigInt& b);
+  bool operator==(const BigInt& b) const { return 0 == Compare(*this, b); }
+  bool operator!=(const BigInt& b) const { return 0 != Compare(*this, b); }
+  bool operator<(const BigInt& b) const { return Compare(*this, b) < 0; }
+
+  BigInt operator-() const;
+  BigInt abs() const { return isNegative() ? -*this : *this; }
+  BigInt operator+(const BigInt& b) const;
+  BigInt operator-(const BigInt& b) const;
+  BigInt operator*(const BigInt& b) const;
+  BigInt operator/(const BigInt& b) const;
+  BigInt operator%(const BigInt& b) const;
+  // Throws on division by zero
+  static void DivMod(const BigInt& a, const BigInt& b,
+                     BigInt& quotient, BigInt& remainder);
+  // Throws if the result would be larger than MAX_BITS
+  static BigInt Pow(const BigInt& base, uint64_t exp);
+
+  typedef std::vector<uint32_t> limb_vec;
+
+private:
+  // Magnitude of any value as limbs
+  limb_vec magnitude() const;
+  // Normalized value from a magnitude, which is trimmed in place
+  static BigInt Make(limb_vec& mag, bool negative);
+
+  int64_t m_small;
+  limb_vec m_limbs;   // empty when the value is small
+  bool m_negative;
+};
+
+};
+
+#endif // _BigInt_h_
@@ -5,17 +5,31 @@
 
 #include "EvalError.h"
 #include "Expression.h"
+#include "Function.h"
+
+#include <boost/lexical_cast.hpp>
 
 #include <string>
+#include <vector>
 using std::string;
+using std::vector;
 
 using namespace eval;
 
 Block::~Block() {
+  // Our statements may refer to our scope, so they go first
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    delete *i;
+  }
+  children.clear();
+  for (vector<Object*>::const_iterator i = m_parameters.begin();
+       i != m_parameters.end(); ++i) {
+    (*i)->release();
+  }
 }
 
 void Block::initScope(Node* scopeParent) {
-  m_scope.init(scopeParent);
+  m_scope.init(parentScope);
 }
 
 void Block::setup() {
@@ -28,6 +42,7 @@ void Block::setup() {
   if (1 == children.size()) {
     m_exp = dynamic_cast<Expression*>(children.front());
   }
+  m_body = isBody() ? this : enclosingBody();
 }
 
 // We don't actually have to do anything here.  Nodes are evaluated
@@ -36,7 +51,141 @@ void Block::setup() {
 void Block::evaluate() {
 }
 
-string Block::cmdText() const {
+void Block::declareParameters(const Signature& signature) {
+  if (!children.empty() || m_signature) {
+    throw EvalError("Block parameters must be declared before its statements, and only once");
+  }
+  const argspec_list& args = signature.getArgs();
+  for (argspec_iter i = args.begin(); i != args.end(); ++i) {
+    Object& parameter = m_scope.newObject(i->getName(), i->getType());
+    m_scope.commit(i->getName());
+    parameter.retain();
+    m_parameters.push_back(&parameter);
+  }
+  m_signature = &signature;
+}
+
+TypeRef Block::getReturnType() const {
+  if (!m_signature) {
+    throw EvalError("Block " + print() + " is not a function body");
+  }
+  return m_signature->getReturnType();
+}
+
+Object* Block::call(CallFrame& frame) {
+  if (!m_signature) {
+    throw EvalError("Block " + print() + " is not a function body");
+  } else if (frame.argc() != m_parameters.size()) {
+    throw EvalError("Function body takes " + boost::lexical_cast<string>(m_parameters.size()) + " arguments, not " + boost::lexical_cast<string>(frame.argc()));
+  }
+  // Take the arguments' values first: an argument may be one of our own
+  // parameters or locals, which are about to change
+  vector<Value> args;
+  args.reserve(m_parameters.size());
+  for (size_t n = 0; n < m_parameters.size(); ++n) {
+    Object* arg = frame.getArg(n);
+    if (!arg) {
+      throw EvalError("Function " + frame.function().print() + " is missing an argument");
+    }
+    args.push_back(arg->getValue());
+  }
+  // Re-entered: set aside the call in progress
+  Activation outer;
+  bool isNested = m_callDepth > 0;
+  if (isNested) {
+    saveActivation(outer);
+  }
+  for (size_t n = 0; n < m_parameters.size(); ++n) {
+    m_parameters[n]->setValue(args[n]);
+  }
+  CallFrame* outerFrame = m_frame;
+  m_frame = &frame;
+  ++m_callDepth;
+  try {
+    resetEvaluated();
+    evaluateNode();
+    // An expression block's value is its result
+    if (!m_isReturning && m_exp) {
+      Object* result = new Object(log, "return", m_exp->getType());
+      result->setValue(m_exp->getValue());
+      returnWith(result);
+    }
+  } catch (EvalError&) {
+    // Nobody will take the result
+    if (m_result) {
+      m_result->retain();
+      m_result->release();
+    }
+    m_result = NULL;
+    m_isReturning = false;
+    m_frame = outerFrame;
+    --m_callDepth;
+    throw;
+  }
+  Object* result = m_result;
+  m_result = NULL;
+  m_isReturning = false;
+  m_frame = outerFrame;
+  --m_callDepth;
+  if (isNested) {
+    restoreActivation(outer);
+  }
+  return result;
+}
+
+void Block::returnWith(Object* result) {
+  if (!m_signature || m_callDepth < 1) {
+    throw EvalError("Block " + print() + " is not running as a function body");
+  } else if (m_isReturning) {
+    throw EvalError("Function body " + print() + " has already returned");
+  }
+  m_result = result;
+  m_isReturning = true;
+}
+
+CallFrame& Block::currentFrame() const {
+  if (!m_frame) {
+    throw EvalError("Block " + print() + " is not running as a function body");
+  }
+  return *m_frame;
+}
+
+void Block::addChild(Node* child) {
+  m_savepoints.push_back(m_scope.savepoint());
+  Brace::addChild(child);
+}
+
+void Block::removeChildrenStartingAt(const Node* child) {
+  for (size_t i = 0; i < children.size() && i < m_savepoints.size(); ++i) {
+    if (child == children.at(i)) {
+      m_scope.rollback(m_savepoints.at(i));
+      m_savepoints.resize(i);
+      break;
+    }
+  }
+  Brace::removeChildrenStartingAt(child);
+}
+
+void Block::evaluateChildren() {
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    if (m_body && m_body->m_isReturning) return;
+    (*i)->evaluateNode();
+  }
+}
+
+void Block::saveResult(Activation& activation) const {
+  for (size_t n = 0; n < m_parameters.size(); ++n) {
+    activation.saveValue(m_parameters[n]->getValue());
+  }
+}
+
+void Block::restoreResult(Activation& activation) {
+  for (size_t n = 0; n < m_parameters.size(); ++n) {
+    m_parameters[n]->setValue(activation.restoreValue());
+  }
+}
+
+Rope Block::cmdText() const {
   if (!m_exp) {
     throw EvalError("Cannot get cmdText of a code block");
   }
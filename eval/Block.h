@@ -9,17 +9,38 @@
  * The Token (construction-time) does not have enough information to know if
  * this is a code block (list of statements) or an expression block (single
  * expression).  We have to wait until setup()-time to determine which.
+ *
+ * A Block may also be the body of a function.  Its parameters are declared
+ * as objects in its scope before its statements are set up, so the body
+ * resolves them like any other names.  Each call() copies the arguments'
+ * values into them and evaluates the body again, until it finishes or a
+ * return statement gives it a result.
+ *
+ * The nodes of a body hold the results of the call in progress.  So when a
+ * body is re-entered -- it calls itself, directly or not -- call() first sets
+ * aside the running call's Activation (those results, and the parameters'
+ * and locals' values), and puts it back once the inner call is done.
+ *
+ * A return statement whose value is just a call is a tail call: rather than
+ * nesting, it retargets the running call's frame (see CallFrame::tailCall())
+ * and the body returns with no result, for Function::call() to run the
+ * callee in its place.
  */
 
+#include "Activation.h"
 #include "Brace.h"
+#include "CallStack.h"
 #include "Expression.h"
 #include "Log.h"
 #include "RootNode.h"
+#include "Rope.h"
+#include "Signature.h"
 #include "Token.h"
 //#include "Statement.h"
 #include "Variable.h"
 
 #include <map>
+#include <vector>
 
 namespace eval {
 
@@ -28,20 +49,68 @@ public:
   Block(Log& log, RootNode*const root, const Token& token)
     : Brace(log, root, token, true),
       m_scope(log),
-      m_exp(NULL) {}
+      m_exp(NULL),
+      m_signature(NULL),
+      m_body(NULL),
+      m_callDepth(0),
+      m_frame(NULL),
+      m_result(NULL),
+      m_isReturning(false) {}
   ~Block();
 
   virtual void initScope(Node* scopeParent);
   virtual void setup();
   virtual void evaluate();
-  virtual std::string cmdText() const;
+  virtual Rope cmdText() const;
 
   bool isCodeBlock() const { return !m_exp; }
   virtual Scope* getScope() { return &m_scope; }
 
+  // As the body of a function with this signature: declare its parameters
+  // in our scope.  Must come before our statements are added, so that they
+  // resolve to them.
+  void declareParameters(const Signature& signature);
+  bool isBody() const { return m_signature != NULL; }
+  // The return type of the function whose body we are; NULL for none
+  TypeRef getReturnType() const;
+  // Run the body on the arguments of frame.  Returns the result given by a
+  // return statement (or an expression block), or NULL if there is none.
+  // The result has no references yet; the caller should retain() it.
+  Object* call(CallFrame& frame);
+  // Finish the call in progress with result, which may be NULL.  Called by
+  // a return statement.
+  void returnWith(Object* result);
+  // The frame of the call in progress, for a tail call to retarget
+  CallFrame& currentFrame() const;
+
+protected:
+  // Each statement gets a savepoint in our scope, so that if it fails we can
+  // drop whatever it (and anything after it) made pending.
+  virtual void addChild(Node* child);
+  virtual void removeChildrenStartingAt(const Node* child);
+  // Stop once a return statement has finished the call
+  virtual void evaluateChildren();
+  // As a body: our parameters' values
+  virtual void saveResult(Activation& activation) const;
+  virtual void restoreResult(Activation& activation);
+
 private:
   Expression* m_exp;
   Scope m_scope;
+  // Savepoint taken just before each child was added, by child index
+  std::vector<Scope::Savepoint> m_savepoints;
+  // Our parameters, if we are a function body; we hold a reference
+  std::vector<Object*> m_parameters;
+  // The signature whose body we are, or NULL
+  const Signature* m_signature;
+  // The function body we are in (ourself, if we are one), or NULL; set up
+  Block* m_body;
+  // As a body: how many calls of us are running, and the result given by
+  // the innermost one's frame, and the result given by its return statement
+  int m_callDepth;
+  CallFrame* m_frame;
+  Object* m_result;
+  bool m_isReturning;
 };
 
 };
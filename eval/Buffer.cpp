@@ -0,0 +1,116 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Buffer.h"
+
+#include "EvalError.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <errno.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using std::string;
+
+using namespace eval;
+
+const size_t Buffer::MIN_CAPACITY;
+
+namespace {
+  string errorText() {
+    return strerror(errno);
+  }
+
+  size_t pageSize() {
+    static size_t size = sysconf(_SC_PAGESIZE);
+    return size;
+  }
+};
+
+boost::shared_ptr<const Buffer> Buffer::Read(int fd) {
+  boost::shared_ptr<Buffer> buffer(new Buffer());
+  struct stat st;
+  if (-1 == fstat(fd, &st)) {
+    throw EvalError("Cannot read command output: " + errorText());
+  }
+  if (S_ISREG(st.st_mode) && st.st_size > 0) {
+    buffer->mapFile(fd, st.st_size);
+  } else {
+    buffer->readAll(fd);
+  }
+  return buffer;
+}
+
+Buffer::~Buffer() {
+  if (m_data) {
+    munmap(m_data, m_capacity);
+  }
+}
+
+/* private */
+
+Buffer::Buffer()
+  : m_data(NULL),
+    m_size(0),
+    m_capacity(0) {
+}
+
+void Buffer::mapFile(int fd, size_t size) {
+  void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (MAP_FAILED == p) {
+    throw EvalError("Cannot map command output: " + errorText());
+  }
+  // Advisory; the output is most likely walked front to back, once
+  madvise(p, size, MADV_SEQUENTIAL);
+  m_data = (char*)p;
+  m_size = size;
+  m_capacity = size;
+}
+
+void Buffer::readAll(int fd) {
+  while (true) {
+    reserve(pageSize());
+    ssize_t n = read(fd, m_data + m_size, m_capacity - m_size);
+    if (0 == n) {
+      return;
+    } else if (-1 == n) {
+      if (EINTR == errno) continue;
+      throw EvalError("Cannot read command output: " + errorText());
+    }
+    m_size += n;
+  }
+}
+
+void Buffer::reserve(size_t n) {
+  if (m_capacity - m_size >= n) {
+    return;
+  }
+  size_t capacity = m_capacity ? m_capacity : MIN_CAPACITY;
+  while (capacity - m_size < n) {
+    capacity *= 2;
+  }
+  void* p;
+  if (!m_data) {
+    p = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  } else {
+#if defined(__linux__)
+    p = mremap(m_data, m_capacity, capacity, MREMAP_MAYMOVE);
+#else
+    p = mmap(NULL, capacity, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED != p) {
+      memcpy(p, m_data, m_size);
+      munmap(m_data, m_capacity);
+    }
+#endif
+  }
+  if (MAP_FAILED == p) {
+    throw EvalError("Out of memory for command output: " + errorText());
+  }
+  m_data = (char*)p;
+  m_capacity = capacity;
+}
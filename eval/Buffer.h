@@ -0,0 +1,58 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Buffer_h_
+#define _Buffer_h_
+
+/* Buffer
+ *
+ * A large, page-aligned byte buffer for the output of commands.
+ *
+ * Read() maps a regular file straight into memory, so its contents are never
+ * copied at all: pages come in from the page cache as they are touched, and
+ * the kernel may drop them again behind a sequential reader.  Anything that
+ * cannot be mapped (a pipe) is read into anonymous pages, which grow by
+ * doubling; on Linux the growth is an mremap that moves page table entries
+ * rather than bytes.
+ *
+ * A Buffer is immutable once read.  str values that are slices of it (see
+ * Rope) hold a shared_ptr to it, which keeps it mapped.
+ */
+
+#include <boost/shared_ptr.hpp>
+
+#include <stddef.h>
+
+namespace eval {
+
+class Buffer {
+public:
+  // Anonymous mappings start at this size
+  static const size_t MIN_CAPACITY = 1 << 20;
+
+  // Everything readable from fd.  fd may be closed afterwards.
+  static boost::shared_ptr<const Buffer> Read(int fd);
+
+  ~Buffer();
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+
+private:
+  Buffer();
+  Buffer(const Buffer&);
+  Buffer& operator=(const Buffer&);
+
+  void mapFile(int fd, size_t size);
+  void readAll(int fd);
+  // Room for at least n more bytes after m_size
+  void reserve(size_t n);
+
+  char* m_data;
+  size_t m_size;
+  size_t m_capacity;    // bytes mapped
+};
+
+};
+
+#endif // _Buffer_h_
@@ -0,0 +1,495 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Builtins.h"
+
+#include "CallStack.h"
+#include "Capture.h"
+#include "EvalError.h"
+#include "List.h"
+#include "Map.h"
+#include "Symbol.h"
+#include "Value.h"
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+using std::string;
+
+using namespace eval;
+
+namespace {
+  /* Helpers for native bodies */
+
+  const Value& arg(CallFrame& frame, size_t n) {
+    Object* object = frame.getArg(n);
+    if (!object) {
+      throw EvalError("Function " + frame.function().print() + " is missing an argument");
+    }
+    return object->getValue();
+  }
+
+  Object* result(Log& log, CallFrame& frame, const Value& value) {
+    Object* object = new Object(log, frame.function().print() + "()",
+                                frame.signature().getReturnType());
+    object->setValue(value);
+    return object;
+  }
+
+  /* str */
+
+  Object* strLength(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::Int(arg(frame, 0).getText().size()));
+  }
+
+  Object* strUpper(Log& log, CallFrame& frame) {
+    string s = arg(frame, 0).getStr();
+    for (string::iterator i = s.begin(); i != s.end(); ++i) {
+      *i = toupper((unsigned char)*i);
+    }
+    return result(log, frame, Value::Str(s));
+  }
+
+  Object* strLower(Log& log, CallFrame& frame) {
+    string s = arg(frame, 0).getStr();
+    for (string::iterator i = s.begin(); i != s.end(); ++i) {
+      *i = tolower((unsigned char)*i);
+    }
+    return result(log, frame, Value::Str(s));
+  }
+
+  // Shares the operands' text rather than copying it, where it is long
+  Object* strConcat(Log& log, CallFrame& frame) {
+    Rope text(arg(frame, 0).getText());
+    text += arg(frame, 1).getText();
+    return result(log, frame, Value::Str(text));
+  }
+
+  // Index of the first occurrence of the second str in the first, or -1
+  Object* strFind(Log& log, CallFrame& frame) {
+    size_t pos = arg(frame, 0).getStr().find(arg(frame, 1).getStr());
+    return result(log, frame,
+                  Value::Int(string::npos == pos ? -1 : (int64_t)pos));
+  }
+
+  /* math */
+
+  Object* mathAbs(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::Int(arg(frame, 0).getInt().abs()));
+  }
+
+  Object* mathMin(Log& log, CallFrame& frame) {
+    const BigInt& a = arg(frame, 0).getInt();
+    const BigInt& b = arg(frame, 1).getInt();
+    return result(log, frame, Value::Int(a < b ? a : b));
+  }
+
+  Object* mathMax(Log& log, CallFrame& frame) {
+    const BigInt& a = arg(frame, 0).getInt();
+    const BigInt& b = arg(frame, 1).getInt();
+    return result(log, frame, Value::Int(b < a ? a : b));
+  }
+
+  Object* mathPow(Log& log, CallFrame& frame) {
+    const BigInt& exp = arg(frame, 1).getInt();
+    if (exp.isNegative()) {
+      throw EvalError("math.pow cannot take a negative exponent");
+    }
+    return result(log, frame,
+                  Value::Int(BigInt::Pow(arg(frame, 0).getInt(),
+                                         exp.getSmall())));
+  }
+
+  /* list */
+
+  const List& listArg(CallFrame& frame, size_t n) {
+    return arg(frame, n).getList();
+  }
+
+  Object* listRange(Log& log, CallFrame& frame) {
+    return result(log, frame,
+                  Value::NewList(List::Range(arg(frame, 0).getInt().getSmall())));
+  }
+
+  Object* listOf(Log& log, CallFrame& frame) {
+    List list;
+    list.push(arg(frame, 0));
+    return result(log, frame, Value::NewList(list));
+  }
+
+  Object* listSize(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::Int(listArg(frame, 0).size()));
+  }
+
+  Object* listAt(Log& log, CallFrame& frame) {
+    const BigInt& i = arg(frame, 1).getInt();
+    if (i.isNegative()) {
+      throw EvalError("list.at cannot take a negative index");
+    }
+    Value element = listArg(frame, 0).at(i.getSmall());
+    if (Value::KIND_INT != element.kind()) {
+      throw EvalError("list.at found " + element.print() + ", which is not an int");
+    }
+    return result(log, frame, element);
+  }
+
+  // Appends to the list in place, so that building a list is linear rather
+  // than quadratic; returns the new size
+  Object* listPush(Log& log, CallFrame& frame) {
+    listArg(frame, 0);
+    List& list = frame.getArg(0)->getMutableValue().getMutableList();
+    list.push(arg(frame, 1));
+    return result(log, frame, Value::Int(list.size()));
+  }
+
+  Object* elementwise(Log& log, CallFrame& frame, Operator::KIND kind) {
+    return result(log, frame, Value::NewList(
+        List::Elementwise(kind, listArg(frame, 0), listArg(frame, 1))));
+  }
+  Object* listAdd(Log& log, CallFrame& frame) {
+    return elementwise(log, frame, Operator::KIND_PLUS);
+  }
+  Object* listSub(Log& log, CallFrame& frame) {
+    return elementwise(log, frame, Operator::KIND_MINUS);
+  }
+  Object* listMul(Log& log, CallFrame& frame) {
+    return elementwise(log, frame, Operator::KIND_STAR);
+  }
+  Object* listDiv(Log& log, CallFrame& frame) {
+    return elementwise(log, frame, Operator::KIND_SLASH);
+  }
+
+  Object* compare(Log& log, CallFrame& frame, Operator::KIND kind) {
+    return result(log, frame, Value::NewList(
+        List::Compare(kind, listArg(frame, 0), listArg(frame, 1))));
+  }
+  Object* listEq(Log& log, CallFrame& frame) {
+    return compare(log, frame, Operator::KIND_EQ);
+  }
+  Object* listLt(Log& log, CallFrame& frame) {
+    return compare(log, frame, Operator::KIND_LT);
+  }
+  Object* listGt(Log& log, CallFrame& frame) {
+    return compare(log, frame, Operator::KIND_GT);
+  }
+
+  Object* listWhere(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::NewList(
+        listArg(frame, 0).where(listArg(frame, 1))));
+  }
+
+  Object* listSum(Log& log, CallFrame& frame) {
+    return result(log, frame, listArg(frame, 0).sum());
+  }
+
+  Object* listMin(Log& log, CallFrame& frame) {
+    return result(log, frame, listArg(frame, 0).min());
+  }
+
+  Object* listMax(Log& log, CallFrame& frame) {
+    return result(log, frame, listArg(frame, 0).max());
+  }
+
+  Object* listFind(Log& log, CallFrame& frame) {
+    return result(log, frame,
+                  Value::Int(listArg(frame, 0).find(arg(frame, 1))));
+  }
+
+  /* map */
+
+  const Map& mapArg(CallFrame& frame, size_t n) {
+    return arg(frame, n).getMap();
+  }
+
+  // The map argument, to change in place
+  Map& mutableMapArg(CallFrame& frame, size_t n) {
+    mapArg(frame, n);
+    return frame.getArg(n)->getMutableValue().getMutableMap();
+  }
+
+  Object* mapNew(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::NewMap(Map()));
+  }
+
+  Object* mapSize(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::Int(mapArg(frame, 0).size()));
+  }
+
+  Object* mapHas(Log& log, CallFrame& frame) {
+    return result(log, frame,
+                  Value::Int(mapArg(frame, 0).get(arg(frame, 1)) ? 1 : 0));
+  }
+
+  Object* mapGet(Log& log, CallFrame& frame) {
+    const Value* value = mapArg(frame, 0).get(arg(frame, 1));
+    if (!value) {
+      throw EvalError("map.get found no key " + arg(frame, 1).print());
+    } else if (Value::KIND_INT != value->kind()) {
+      throw EvalError("map.get found " + value->print() + ", which is not an int");
+    }
+    return result(log, frame, *value);
+  }
+
+  Object* mapSet(Log& log, CallFrame& frame) {
+    Map& map = mutableMapArg(frame, 0);
+    map.set(arg(frame, 1), arg(frame, 2));
+    return result(log, frame, Value::Int(map.size()));
+  }
+
+  // Adds to the count under a key, which starts at 0; returns the new count
+  Object* mapIncr(Log& log, CallFrame& frame) {
+    Map& map = mutableMapArg(frame, 0);
+    Value* count = map.get(arg(frame, 1));
+    Value total = Value::Int(arg(frame, 2).getInt() +
+                             (count ? count->getInt() : BigInt(0)));
+    if (count) {
+      *count = total;
+    } else {
+      map.set(arg(frame, 1), total);
+    }
+    return result(log, frame, total);
+  }
+
+  // Appends to the list under a key, which starts empty; returns its size
+  Object* mapAppend(Log& log, CallFrame& frame) {
+    Map& map = mutableMapArg(frame, 0);
+    Value* group = map.get(arg(frame, 1));
+    if (!group) {
+      map.set(arg(frame, 1), Value::NewList(List()));
+      group = map.get(arg(frame, 1));
+    }
+    List& list = group->getMutableList();
+    list.push(arg(frame, 2));
+    return result(log, frame, Value::Int(list.size()));
+  }
+
+  Object* mapGroup(Log& log, CallFrame& frame) {
+    const Value* group = mapArg(frame, 0).get(arg(frame, 1));
+    if (!group) {
+      return result(log, frame, Value::NewList(List()));
+    }
+    group->getList();
+    return result(log, frame, *group);   // shared until either side changes
+  }
+
+  Object* mapRemove(Log& log, CallFrame& frame) {
+    return result(log, frame,
+        Value::Int(mutableMapArg(frame, 0).remove(arg(frame, 1)) ? 1 : 0));
+  }
+
+  Object* mapKeys(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::NewList(mapArg(frame, 0).keys()));
+  }
+
+  Object* mapValues(Log& log, CallFrame& frame) {
+    return result(log, frame, Value::NewList(mapArg(frame, 0).values()));
+  }
+
+  /* path */
+
+  Object* pathJoin(Log& log, CallFrame& frame) {
+    const string& a = arg(frame, 0).getStr();
+    const string& b = arg(frame, 1).getStr();
+    string joined;
+    if (a.empty() || (!b.empty() && '/' == b[0])) {
+      joined = b;
+    } else if ('/' == a[a.size() - 1]) {
+      joined = a + b;
+    } else {
+      joined = a + "/" + b;
+    }
+    return result(log, frame, Value::Str(joined));
+  }
+
+  Object* pathBasename(Log& log, CallFrame& frame) {
+    const string& p = arg(frame, 0).getStr();
+    size_t slash = p.rfind('/');
+    return result(log, frame,
+                  Value::Str(string::npos == slash ? p : p.substr(slash + 1)));
+  }
+
+  Object* pathDirname(Log& log, CallFrame& frame) {
+    const string& p = arg(frame, 0).getStr();
+    size_t slash = p.rfind('/');
+    string dir;
+    if (0 == slash) {
+      dir = "/";
+    } else if (string::npos != slash) {
+      dir = p.substr(0, slash);
+    }
+    return result(log, frame, Value::Str(dir));
+  }
+
+  // The basename's suffix from its last '.', or "" (a leading '.' doesn't
+  // count: .bashrc has no extension)
+  Object* pathExtension(Log& log, CallFrame& frame) {
+    const string& p = arg(frame, 0).getStr();
+    size_t start = p.rfind('/');
+    start = string::npos == start ? 0 : start + 1;
+    size_t dot = p.rfind('.');
+    string ext;
+    if (string::npos != dot && dot > start) {
+      ext = p.substr(dot);
+    }
+    return result(log, frame, Value::Str(ext));
+  }
+
+  /* capture */
+
+  // The command's whole stdout, sharing the captured buffer
+  Object* captureRun(Log& log, CallFrame& frame) {
+    Capture capture(log, arg(frame, 0).getText());
+    return result(log, frame, Value::Str(capture.text()));
+  }
+
+  // The command's stdout split into lines, each sharing the captured buffer
+  Object* captureLines(Log& log, CallFrame& frame) {
+    Capture capture(log, arg(frame, 0).getText());
+    List lines;
+    Rope line;
+    while (capture.nextLine(line)) {
+      lines.push(Value::Str(line));
+    }
+    return result(log, frame, Value::NewList(lines));
+  }
+
+  /* env */
+
+  Object* envGet(Log& log, CallFrame& frame) {
+    const char* value = getenv(arg(frame, 0).getStr().c_str());
+    return result(log, frame, Value::Str(value ? value : ""));
+  }
+
+  Object* envHas(Log& log, CallFrame& frame) {
+    return result(log, frame,
+                  Value::Int(getenv(arg(frame, 0).getStr().c_str()) ? 1 : 0));
+  }
+};
+
+void Builtins::install() {
+  Object* str = m_scope.getObject("str");
+  if (!str) {
+    throw EvalError("Cannot install builtins before str is defined");
+  }
+  define(*str, "length", "str", "int", strLength);
+  define(*str, "upper", "str", "str", strUpper);
+  define(*str, "lower", "str", "str", strLower);
+  define(*str, "concat", "str", "str", "str", strConcat);
+  define(*str, "find", "str", "str", "int", strFind);
+
+  Object& math = m_scope.newObject("math", type("object"));
+  define(math, "abs", "int", "int", mathAbs);
+  define(math, "min", "int", "int", "int", mathMin);
+  define(math, "max", "int", "int", "int", mathMax);
+  define(math, "pow", "int", "int", "int", mathPow);
+
+  Object* list = m_scope.getObject("list");
+  if (!list) {
+    throw EvalError("Cannot install builtins before list is defined");
+  }
+  define(*list, "range", "int", "list", listRange);
+  define(*list, "of", "int", "list", listOf);
+  define(*list, "size", "list", "int", listSize);
+  define(*list, "at", "list", "int", "int", listAt);
+  define(*list, "push", "list", "int", "int", listPush);
+  define(*list, "add", "list", "list", "list", listAdd);
+  define(*list, "sub", "list", "list", "list", listSub);
+  define(*list, "mul", "list", "list", "list", listMul);
+  define(*list, "div", "list", "list", "list", listDiv);
+  define(*list, "eq", "list", "list", "list", listEq);
+  define(*list, "lt", "list", "list", "list", listLt);
+  define(*list, "gt", "list", "list", "list", listGt);
+  define(*list, "where", "list", "list", "list", listWhere);
+  define(*list, "sum", "list", "int", listSum);
+  define(*list, "min", "list", "int", listMin);
+  define(*list, "max", "list", "int", listMax);
+  define(*list, "find", "list", "int", "int", listFind);
+
+  Object* map = m_scope.getObject("map");
+  if (!map) {
+    throw EvalError("Cannot install builtins before map is defined");
+  }
+  define(*map, "new", argspec_list(), type("map"), mapNew);
+  define(*map, "size", "map", "int", mapSize);
+  define(*map, "has", "map", "object", "int", mapHas);
+  define(*map, "get", "map", "object", "int", mapGet);
+  define(*map, "set", "map", "object", "object", "int", mapSet);
+  define(*map, "incr", "map", "object", "int", "int", mapIncr);
+  define(*map, "append", "map", "object", "int", "int", mapAppend);
+  define(*map, "group", "map", "object", "list", mapGroup);
+  define(*map, "remove", "map", "object", "int", mapRemove);
+  define(*map, "keys", "map", "list", mapKeys);
+  define(*map, "values", "map", "list", mapValues);
+
+  Object& path = m_scope.newObject("path", type("object"));
+  define(path, "join", "str", "str", "str", pathJoin);
+  define(path, "basename", "str", "str", pathBasename);
+  define(path, "dirname", "str", "str", pathDirname);
+  define(path, "extension", "str", "str", pathExtension);
+
+  Object& capture = m_scope.newObject("capture", type("object"));
+  define(capture, "run", "str", "str", captureRun);
+  define(capture, "lines", "str", "list", captureLines);
+
+  Object& env = m_scope.newObject("env", type("object"));
+  define(env, "get", "str", "str", envGet);
+  define(env, "has", "str", "int", envHas);
+}
+
+Function& Builtins::define(Object& owner, const string& name,
+                           const argspec_list& args, TypeRef returnType,
+                           native_fn native) {
+  Signature signature(args, returnType, native);
+  size_t offset;
+  if (owner.getShape().lookup(Symbol::Intern(name), offset)) {
+    Function* function = dynamic_cast<Function*>(owner.getMemberAt(offset));
+    if (!function) {
+      throw EvalError("Cannot define builtin " + owner.print() + "." + name + "; it is not a function");
+    }
+    function->addSignature(signature);
+    return *function;
+  }
+  m_log.debug("Defining builtin " + owner.print() + "." + name);
+  Function* function = new Function(m_log, name, type("@"), signature);
+  owner.addMember(name, function);
+  return *function;
+}
+
+/* private */
+
+TypeRef Builtins::type(const string& name) const {
+  const Object* object = m_scope.getObject(name);
+  if (!object) {
+    throw EvalError("Cannot define builtins until " + name + " is defined");
+  }
+  return BasicType::Get(*object);
+}
+
+Function& Builtins::define(Object& owner, const string& name,
+                           const string& arg1, const string& returnType,
+                           native_fn native) {
+  argspec_list args;
+  args.push_back(ArgSpec("a", type(arg1), NULL));
+  return define(owner, name, args, type(returnType), native);
+}
+
+Function& Builtins::define(Object& owner, const string& name,
+                           const string& arg1, const string& arg2,
+                           const string& returnType, native_fn native) {
+  argspec_list args;
+  args.push_back(ArgSpec("a", type(arg1), NULL));
+  args.push_back(ArgSpec("b", type(arg2), NULL));
+  return define(owner, name, args, type(returnType), native);
+}
+
+Function& Builtins::define(Object& owner, const string& name,
+                           const string& arg1, const string& arg2,
+                           const string& arg3, const string& returnType,
+                           native_fn native) {
+  argspec_list args;
+  args.push_back(ArgSpec("a", type(arg1), NULL));
+  args.push_back(ArgSpec("b", type(arg2), NULL));
+  args.push_back(ArgSpec("c", type(arg3), NULL));
+  return define(owner, name, args, type(returnType), native);
+}
@@ -0,0 +1,76 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Builtins_h_
+#define _Builtins_h_
+
+/* Native builtin functions (the standard library)
+ *
+ * define() binds a C++ function (a native_fn) to a Function member of some
+ * stdlib object, under a typed Signature.  The Function is then checked and
+ * dispatched like any other, but its call() runs the C++ body directly on
+ * the caller's argument Objects, which the CallFrame holds by reference.
+ * Defining the same name again on the same object adds an overload.
+ *
+ * install() creates the standard library in the root scope:
+ *  - str:  length, upper, lower, concat, find (members of str itself, so
+ *          every str value inherits them)
+ *  - math: abs, min, max, pow
+ *  - list: range, of, size, at, push; elementwise add, sub, mul, div and
+ *          eq, lt, gt (which make masks for where); sum, min, max, find.
+ *          These are for lists of ints, which the List keeps packed.
+ *  - map:  new, size, has, get, set, remove, keys, values; incr for
+ *          counting and append/group for grouping.  Keys are strs or ints.
+ *  - path: join, basename, dirname, extension
+ *  - capture: run, lines.  Run a command line through the shell and return
+ *          its stdout as a str, or as a list of its lines; either way the
+ *          strs share the captured output rather than copying it.
+ *  - env:  get, has
+ */
+
+#include "Function.h"
+#include "Log.h"
+#include "Object.h"
+#include "Scope.h"
+#include "Signature.h"
+#include "Type.h"
+
+#include <string>
+
+namespace eval {
+
+class Builtins {
+public:
+  Builtins(Log& log, Scope& scope)
+    : m_log(log),
+      m_scope(scope) {}
+
+  // Needs object, @, int, str, list and map to already exist in the scope
+  void install();
+
+  Function& define(Object& owner, const std::string& name,
+                   const argspec_list& args, TypeRef returnType,
+                   native_fn native);
+
+private:
+  // The BasicType of a stdlib object, for signatures
+  TypeRef type(const std::string& name) const;
+  // Convenience for the common signature shapes
+  Function& define(Object& owner, const std::string& name,
+                   const std::string& arg1, const std::string& returnType,
+                   native_fn native);
+  Function& define(Object& owner, const std::string& name,
+                   const std::string& arg1, const std::string& arg2,
+                   const std::string& returnType, native_fn native);
+  Function& define(Object& owner, const std::string& name,
+                   const std::string& arg1, const std::string& arg2,
+                   const std::string& arg3, const std::string& returnType,
+                   native_fn native);
+
+  Log& m_log;
+  Scope& m_scope;
+};
+
+};
+
+#endif // _Builtins_h_
@@ -0,0 +1,108 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "CallStack.h"
+
+#include "EvalError.h"
+#include "Function.h"
+#include "Signature.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+/* CallStack */
+
+const size_t CallStack::MAX_DEPTH;
+const size_t CallStack::TYPICAL_ARGS;
+
+CallStack::CallStack() {
+  m_frames.reserve(MAX_DEPTH);
+  m_slots.reserve(MAX_DEPTH * TYPICAL_ARGS);
+}
+
+/* CallFrame */
+
+CallFrame::CallFrame(CallStack& stack, const Function& function,
+                     const Signature& signature)
+  : m_stack(stack),
+    m_index(stack.m_frames.size()),
+    m_tailCall(false) {
+  if (m_index >= CallStack::MAX_DEPTH) {
+    throw EvalError("Cannot call " + function.print() + "; exceeded the maximum call depth of " + boost::lexical_cast<string>(CallStack::MAX_DEPTH));
+  }
+  size_t base = stack.m_slots.size();
+  stack.m_slots.resize(base + signature.getArgs().size(), NULL);
+  stack.m_frames.push_back(CallStack::Frame(function, signature, base));
+}
+
+CallFrame::~CallFrame() {
+  releaseSlots(frame().base);
+  m_stack.m_frames.pop_back();
+}
+
+size_t CallFrame::argc() const {
+  return frame().signature->getArgs().size();
+}
+
+void CallFrame::setArg(size_t n, Object* arg) {
+  if (n >= argc()) {
+    throw EvalError("Function " + function().print() + " does not take " + boost::lexical_cast<string>(n + 1) + " arguments");
+  }
+  Object*& slot = m_stack.m_slots[frame().base + n];
+  if (arg) arg->retain();
+  if (slot) slot->release();
+  slot = arg;
+}
+
+Object* CallFrame::getArg(size_t n) const {
+  if (n >= argc()) {
+    throw EvalError("Function " + function().print() + " does not take " + boost::lexical_cast<string>(n + 1) + " arguments");
+  }
+  return m_stack.m_slots[frame().base + n];
+}
+
+Object* CallFrame::getArg(const string& name) const {
+  const argspec_list& args = signature().getArgs();
+  for (size_t n = 0; n < args.size(); ++n) {
+    if (args[n].getName() == name) {
+      return m_stack.m_slots[frame().base + n];
+    }
+  }
+  return NULL;
+}
+
+void CallFrame::tailCall(const Function& function,
+                         const Signature& signature) {
+  if (m_index + 1 != m_stack.m_frames.size()) {
+    throw EvalError("Cannot tail-call " + function.print() + " from a frame that is not innermost");
+  }
+  CallStack::Frame& f = frame();
+  size_t top = f.base + signature.getArgs().size();
+  if (top < m_stack.m_slots.size()) {
+    releaseSlots(top);
+  } else {
+    m_stack.m_slots.resize(top, NULL);
+  }
+  f.function = &function;
+  f.signature = &signature;
+  m_tailCall = true;
+}
+
+bool CallFrame::takeTailCall() {
+  bool tailCall = m_tailCall;
+  m_tailCall = false;
+  return tailCall;
+}
+
+/* private */
+
+void CallFrame::releaseSlots(size_t first) {
+  for (size_t n = first; n < m_stack.m_slots.size(); ++n) {
+    if (m_stack.m_slots[n]) m_stack.m_slots[n]->release();
+  }
+  m_stack.m_slots.resize(first);
+}
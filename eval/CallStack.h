@@ -0,0 +1,99 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _CallStack_h_
+#define _CallStack_h_
+
+/* Call stack
+ *
+ * One contiguous vector of argument slots shared by every call, and the
+ * frames that index into it.  Both are reserved up front for MAX_DEPTH frames
+ * of a typical size, so pushing and popping a call does not touch the heap
+ * (only a deep stack of unusually wide calls would ever grow the slots).  A
+ * frame's slots are in the order of its Signature's ArgSpecs.
+ *
+ * Each slot holds a reference to its Object, so a callee can pass a
+ * temporary it made as an argument.
+ *
+ * A call in tail position does not nest: tailCall() retargets the innermost
+ * frame at the new function and signature, reusing its slots, and the
+ * trampoline in Function::call() runs it once the current body returns.  So
+ * a recursion that iterates runs in one frame, in constant C++ stack and
+ * constant call-stack memory.
+ *
+ * Nesting more than MAX_DEPTH calls is an EvalError, not a crash.
+ */
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class Function;
+class Object;
+class Signature;
+
+class CallStack {
+public:
+  static const size_t MAX_DEPTH = 1024;
+  // Argument slots reserved per frame
+  static const size_t TYPICAL_ARGS = 4;
+
+  CallStack();
+
+  size_t depth() const { return m_frames.size(); }
+
+private:
+  friend class CallFrame;
+
+  struct Frame {
+    Frame(const Function& function, const Signature& signature, size_t base)
+      : function(&function), signature(&signature), base(base) {}
+    const Function* function;
+    const Signature* signature;
+    size_t base;    // index of the first argument slot
+  };
+
+  std::vector<Frame> m_frames;
+  std::vector<Object*> m_slots;
+};
+
+// A call in progress.  Pushes its frame on construction and pops it on
+// destruction, so an error thrown out of the callee unwinds the CallStack too.
+class CallFrame {
+public:
+  CallFrame(CallStack& stack, const Function& function,
+            const Signature& signature);
+  ~CallFrame();
+
+  const Function& function() const { return *frame().function; }
+  const Signature& signature() const { return *frame().signature; }
+  size_t argc() const;
+  void setArg(size_t n, Object* arg);
+  Object* getArg(size_t n) const;
+  // The argument for the ArgSpec of this name, or NULL
+  Object* getArg(const std::string& name) const;
+
+  // Replace this call with a call of function, in place.  The slots are
+  // resized for signature; the arguments still in range are kept, and the
+  // rest are up to the caller to setArg().  Only the innermost frame can do
+  // this, and the current body should return right after.
+  void tailCall(const Function& function, const Signature& signature);
+  // Is a tail call pending?  Clears it, for the trampoline.
+  bool takeTailCall();
+
+private:
+  CallStack::Frame& frame() { return m_stack.m_frames[m_index]; }
+  const CallStack::Frame& frame() const { return m_stack.m_frames[m_index]; }
+  // Release the slots from index first to the top of the stack
+  void releaseSlots(size_t first);
+
+  CallStack& m_stack;
+  size_t m_index;
+  bool m_tailCall;
+};
+
+};
+
+#endif // _CallStack_h_
@@ -0,0 +1,89 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Capture.h"
+
+#include "Buffer.h"
+#include "EvalError.h"
+#include "Log.h"
+#include "Rope.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <iostream>
+#include <string.h>
+#include <string>
+#include <unistd.h>
+using std::string;
+
+using namespace eval;
+
+Capture::Capture(Log& log, const Rope& cmd)
+  : m_log(log),
+    m_returnCode(-1),
+    m_pos(0) {
+  string cmdLine = cmd.str();
+  // The command goes to the shell as one line
+  if (string::npos != cmdLine.find('\n')) {
+    throw EvalError("Cannot capture a command line that contains a newline");
+  }
+  m_log.info("CAPTURING CMD: <" + cmdLine + ">");
+  std::cout << "CAPTURE:";
+  cmd.write(std::cout);
+  std::cout << std::endl;
+
+  // "<return code> <path>"
+  string line;
+  std::getline(std::cin, line);
+  size_t space = line.find(' ');
+  // The file is ours to remove as soon as we have its name, whatever else is
+  // wrong with the reply.  Our descriptor (and then the mapping) keeps the
+  // contents around.
+  int fd = -1;
+  int openErrno = 0;
+  string path;
+  if (string::npos != space) {
+    path = line.substr(space + 1);
+    fd = open(path.c_str(), O_RDONLY);
+    openErrno = errno;
+    unlink(path.c_str());
+  }
+  try {
+    try {
+      m_returnCode = boost::lexical_cast<int>(line.substr(0, space));
+    } catch (boost::bad_lexical_cast&) {
+      throw EvalError("Bad reply from the shell to a capture: " + line);
+    }
+    m_log.info("RETURN CODE: " + boost::lexical_cast<string>(m_returnCode));
+    if (string::npos == space) {
+      throw EvalError("The shell could not capture the output of " + cmdLine);
+    } else if (-1 == fd) {
+      throw EvalError("Cannot open captured output " + path + ": " +
+                      strerror(openErrno));
+    }
+    m_buffer = Buffer::Read(fd);
+  } catch (EvalError&) {
+    if (-1 != fd) close(fd);
+    throw;
+  }
+  close(fd);
+}
+
+Rope Capture::text() const {
+  return Rope(m_buffer, m_buffer->data(), m_buffer->size());
+}
+
+bool Capture::nextLine(Rope& line) {
+  size_t size = m_buffer->size();
+  if (m_pos >= size) {
+    return false;
+  }
+  const char* start = m_buffer->data() + m_pos;
+  const char* end = (const char*)memchr(start, '\n', size - m_pos);
+  size_t length = end ? end - start : size - m_pos;
+  line = Rope(m_buffer, start, length);
+  m_pos += length + 1;
+  return true;
+}
@@ -0,0 +1,55 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Capture_h_
+#define _Capture_h_
+
+/* Capture
+ *
+ * Runs a command line through the shell and keeps its standard output.
+ *
+ * Like a Command, this asks the shell to run it: the evaluator prints
+ * "CAPTURE:<cmd>", and the shell replies with the return code and the path of
+ * a temporary file, which the command's stdout went straight into.  We open
+ * and unlink the file and map it into a Buffer.  So the output crosses no
+ * pipe, is copied by the kernel once as the command writes it, and never by
+ * us.  The command must fit on the one CAPTURE: line, so one that contains a
+ * newline is an EvalError.
+ *
+ * The temporary file is unlinked as soon as the reply names it, even if the
+ * rest of the reply is bad or the file cannot be read, so it never outlives
+ * the capture.
+ *
+ * text() is the whole output as one Rope that refers to the Buffer.
+ * nextLine() walks it a line at a time, each line also a slice of the Buffer,
+ * for output too large to want as one str.
+ */
+
+#include "Buffer.h"
+#include "Log.h"
+#include "Rope.h"
+
+#include <boost/shared_ptr.hpp>
+
+namespace eval {
+
+class Capture {
+public:
+  Capture(Log& log, const Rope& cmd);
+
+  int returnCode() const { return m_returnCode; }
+  Rope text() const;
+  // The next line, without its '\n', or false at the end of the output.  A
+  // last line with no '\n' still counts.
+  bool nextLine(Rope& line);
+
+private:
+  Log& m_log;
+  int m_returnCode;
+  boost::shared_ptr<const Buffer> m_buffer;
+  size_t m_pos;     // start of the next line
+};
+
+};
+
+#endif // _Capture_h_
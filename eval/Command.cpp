@@ -7,6 +7,7 @@
 #include "CommandFragment.h"
 #include "EvalError.h"
 #include "Node.h"
+#include "Rope.h"
 
 #include <boost/lexical_cast.hpp>
 
@@ -21,8 +22,10 @@ using namespace eval;
 void Command::setup() {
 }
 
+// The command line is built up as a Rope, and written out a chunk at a time,
+// so its pieces are not recopied as it grows.
 void Command::evaluate() {
-  string cmd;
+  Rope cmd;
   for (Node::child_iter i = children.begin(); i != children.end(); ++i) {
     const Block* block = dynamic_cast<const Block*>(*i);
     // Code blocks aren't commands; don't run them
@@ -36,8 +39,10 @@ void Command::evaluate() {
       throw EvalError("Command has an unsupported child: " + string(**i));
     }
   }
-  log.info("RUNNING CMD: <" + cmd + ">");
-  std::cout << "CMD:" << cmd << std::endl;
+  log.info("RUNNING CMD: <" + cmd.str() + ">");
+  std::cout << "CMD:";
+  cmd.write(std::cout);
+  std::cout << std::endl;
   string line;
   std::getline(std::cin, line);
   int returnCode = boost::lexical_cast<int>(line);
@@ -23,6 +23,7 @@ public:
     : Brace(log, root, token, true) {}
   virtual void setup();
   virtual void evaluate();
+  virtual evaluator_fn evaluator() const { return &EvaluateDirect<Command>; }
 };
 
 };
@@ -16,6 +16,6 @@ void CommandFragment::setup() {
 void CommandFragment::evaluate() {
 }
 
-string CommandFragment::cmdText() const {
+Rope CommandFragment::cmdText() const {
   return value;
 }
@@ -9,6 +9,7 @@
 #include "Log.h"
 #include "Node.h"
 #include "RootNode.h"
+#include "Rope.h"
 #include "Token.h"
 
 #include <string>
@@ -21,7 +22,7 @@ public:
     : Node(log, root, token) {}
   virtual void setup();
   virtual void evaluate();
-  virtual std::string cmdText() const;
+  virtual Rope cmdText() const;
 };
 
 };
@@ -4,18 +4,20 @@
 #include "Expression.h"
 
 #include "EvalError.h"
+#include "Object.h"
 #include "Operator.h"
+#include "ProcCall.h"
 #include "Variable.h"
 
-#include <boost/lexical_cast.hpp>
-
 #include <string>
-#include <vector>
 using std::string;
-using std::vector;
 
 using namespace eval;
 
+Expression::~Expression() {
+  if (m_object) m_object->release();
+}
+
 void Expression::setup() {
   if (children.size() != 1) {
     throw EvalError("Expression " + print() + " must have exactly one child");
@@ -27,13 +29,39 @@ void Expression::setup() {
 void Expression::evaluate() {
 }
 
-string Expression::cmdText() const {
+Rope Expression::cmdText() const {
   if (!isEvaluated) {
     throw EvalError("Cannot get cmdText of unevaluated Expression");
   }
-  // TODO: call the resulting object's ->str.escape() (*UNIMPL*)
-  //return children.front()->cmdText();
-  return "Expression__cmdText unimplemented";
+  // TODO: call the resulting object's ->str.escape() once objects have one
+  const Value& value = getValue();
+  if (value.isNumeric()) {
+    return Rope(value.print());
+  } else if (Value::KIND_STR != value.kind()) {
+    throw EvalError("Cannot use " + value.print() + " as command text");
+  }
+  // Single quotes, as the shell splits a command line: each ' in the str is
+  // '\'', and since \ escapes even within quotes, each \ is \\.  A newline is
+  // \n, so that the command stays on its one CMD: or CAPTURE: line.
+  const Rope& text = value.getText();
+  const char* s = text.data();
+  Rope quoted("'");
+  size_t start = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char* escape;
+    switch (s[i]) {
+      case '\'': escape = "'\\''"; break;
+      case '\\': escape = "\\\\"; break;
+      case '\n': escape = "\\n"; break;
+      default: continue;
+    }
+    quoted.append(s + start, i - start);
+    quoted += escape;
+    start = i + 1;
+  }
+  quoted.append(s + start, text.size() - start);
+  quoted += "'";
+  return quoted;
 }
 
 Object& Expression::getObject() const {
@@ -44,65 +72,33 @@ Object& Expression::getObject() const {
   if (var) {
     return var->getObject();
   }
-  // TODO: Operator
-  // TODO: Object
-  // TODO: Function
-  throw EvalError("Expression " + print() + " cannot retrieve Object from unsupported child type " + children.at(0)->print());
-}
-
-Node* Expression::makeOperatorTree(child_vec& nodes, Operator::op_priority p) {
-  if (0 == nodes.size()) {
-    return NULL;
+  ProcCall* call = dynamic_cast<ProcCall*>(children.at(0));
+  if (call) {
+    return call->getObject();
   }
-  // prefix
-  Node* top = nodes.front();
-  nodes.pop_front();
-  Variable* var = dynamic_cast<Variable*>(top);
-  Operator* op = dynamic_cast<Operator*>(top);
-  if (var) {
-    log.debug(" = prefix var " + var->print());
-  } else if (op && Operator::CouldBeUnary(op->name)) {
-    log.debug(" = prefix op " + op->print());
-    op->setUnary();
-    Node* operand = makeOperatorTree(nodes, op->precedence().priority);
-    if (!operand) { throw EvalError("a"); }
-    log.debug(" = prefix operand " + operand->print());
-    operand->parent = op;
-    op->addChild(operand);
-    op->setUnary();
-  } else { throw EvalError("b"); }
-  if (0 == nodes.size()) {
-    log.debug(" unary outta nodes!");
-    return top;
+  // A literal or an operator only has a value, so give the caller an Object
+  // holding a copy of it.  A callee that still holds our last one (e.g. an
+  // outer call of a recursion) keeps it, and we make another.
+  if (!m_object || m_object->refs() > 1) {
+    Object* object = new Object(log, print(), m_type);
+    object->retain();
+    if (m_object) m_object->release();
+    m_object = object;
   }
-  // lookahead
-  Node* second = nodes.front();
-  Operator* op2 = dynamic_cast<Operator*>(second);
-  // infix
-  while (op2 && Operator::CouldBeBinary(op2->name)) {
-    log.debug(" = infix op " + op2->print());
-    op2->setBinary();
-    Operator::op_prec infix_prec = op2->precedence();
-    if (p >= infix_prec.priority) {
-      log.debug(" = -> above priority; skipping");
-      break;
-    }
-    log.debug(" = -> below priority");
-    nodes.pop_front();
-    op2->addChild(top);
-    Node* operand = makeOperatorTree(nodes, infix_prec.priority - (int)infix_prec.assoc);
-    log.debug(" = infix op " + op2->print()  + " operand " + operand->print());
-    if (!operand) { throw EvalError("c"); }
-    op2->addChild(operand);
-    top = op2;
-    if (0 == nodes.size()) {
-      log.debug(" infix op " + op2->print() + " outta nodes!");
-      break;
-    }
-    second = nodes.front();
-    op2 = dynamic_cast<Operator*>(second);
+  m_object->setValue(getValue());
+  return *m_object;
+}
+
+const Value& Expression::getValue() const {
+  TypedNode* child = dynamic_cast<TypedNode*>(children.at(0));
+  if (!child) {
+    throw EvalError("Expression " + print() + " has no typed child to get a value from");
   }
-  return top;
+  return child->getValue();
+}
+
+ProcCall* Expression::getProcCall() const {
+  return dynamic_cast<ProcCall*>(children.at(0));
 }
 
 void Expression::computeType() {
@@ -10,9 +10,9 @@
  * name, etc.) or the top operator of an expression tree.
  *
  * The operators are given to us by the AST (parser) in a ridiculous and
- * flattened ordering, so at setup() time we must arrange our children into a
- * tree and then reorder them for operator precedence.  Then we validate the
- * operators bottom-up.
+ * flattened ordering, so as an OperatorParser we arrange them into a tree as
+ * they arrive, for operator precedence, validating each operator bottom-up as
+ * soon as it has its operands.  The finished tree is our one child.
  *
  * This single expression may be owned by an expression block, in which case
  * the expression is meant to evaluate to an object on which we'll call
@@ -25,6 +25,7 @@
 #include "Operator.h"
 #include "OperatorParser.h"
 #include "RootNode.h"
+#include "Rope.h"
 #include "Token.h"
 #include "Type.h"
 #include "TypedNode.h"
@@ -33,23 +34,36 @@
 
 namespace eval {
 
+class ProcCall;
+
 class Expression : public TypedNode, public OperatorParser {
 public:
   Expression(Log& log, RootNode*const root, const Token& token)
     : TypedNode(log, root, token),
-      OperatorParser(log) {}
+      OperatorParser(log),
+      m_object(NULL) {}
+  ~Expression();
   virtual void setup();
   virtual void evaluate();
-  virtual std::string cmdText() const;
+  // The value as text for a command line: a str quoted for the shell, or
+  // a number as it prints
+  virtual Rope cmdText() const;
 
   // Get the resulting Object after this Expression has been evaluated.
   // Note that this Object& will not stick around for long!  It has not been
-  // saved to a scope.
+  // saved to a scope.  For a literal or an operator, it's a temporary that
+  // holds a copy of the value; retain it to keep it past our next call.
   Object& getObject() const;
+  // The Value of our (typed) child
+  virtual const Value& getValue() const;
+  // The call that is our whole expression, or NULL
+  ProcCall* getProcCall() const;
 
 private:
   // from TypedNode
   virtual void computeType();
+  // The temporary from getObject(), reused until someone else holds it
+  mutable Object* m_object;   // we hold a reference
 };
 
 };
@@ -5,15 +5,40 @@
 
 #include <memory>
 #include <string>
-using std::auto_ptr;
 using std::string;
 
 using namespace eval;
 
-Function::Function(Log& log, const string& name, auto_ptr<Type> type,
+Function::Function(Log& log, const string& name, TypeRef type,
                    Signature initialSignature)
-  : Object(log, name, type) {
-  m_signatures.push_back(initialSignature);
+  : Object(log, name, type),
+    m_generation(0) {
+  addSignature(initialSignature);
+}
+
+Function::~Function() {
+  deleteBodies();
+}
+
+void Function::references(HeapRefs& refs) const {
+  Object::references(refs);
+  for (signature_iter i = m_signatures.begin(); i != m_signatures.end(); ++i) {
+    for (argspec_iter j = i->getArgs().begin(); j != i->getArgs().end(); ++j) {
+      if (j->getType().get()) refs.types.push_back(j->getType().get());
+    }
+    if (i->getReturnType().get()) {
+      refs.types.push_back(i->getReturnType().get());
+    }
+  }
+}
+
+void Function::dropReferences() {
+  deleteBodies();
+  ++m_generation;
+  m_signatures.clear();
+  m_byArgc.clear();
+  m_dispatch.clear();
+  Object::dropReferences();
 }
 
 void Function::addSignature(Signature signature) {
@@ -24,82 +49,83 @@ void Function::addSignature(Signature signature) {
       throw EvalError("Cannot (yet) overload function signature with same number of arguments");
     }
   }
+  size_t argc = signature.getArgs().size();
+  if (argc >= m_byArgc.size()) {
+    m_byArgc.resize(argc + 1, -1);
+  }
+  m_byArgc[argc] = m_signatures.size();
   m_signatures.push_back(signature);
+  m_dispatch.clear();
+  ++m_generation;
 }
 
 bool Function::takesArgs(const type_list& args) const {
-  for (signature_iter i = m_signatures.begin(); i != m_signatures.end(); ++i) {
-    if (i->areArgsCompatible(args)) {
-      return true;
-    }
-  }
-  return false;
+  return getSignature(args) != NULL;
 }
 
-auto_ptr<Type> Function::getPossibleReturnTypes(const type_list& args) const {
-  if (!takesArgs(args)) {
+TypeRef Function::getPossibleReturnTypes(const type_list& args) const {
+  const Signature* signature = getSignature(args);
+  if (!signature) {
     throw EvalError("Function " + print() + " does not take these args");
   }
-  auto_ptr<Type> returnTypes(NULL);
-  for (signature_iter i = m_signatures.begin(); i != m_signatures.end(); ++i) {
-    if (i->areArgsCompatible(args)) {
-      returnTypes.reset(i->getReturnType());
-      return returnTypes;
-      /*
-      if (!returnTypes.get()) {
-        returnTypes.reset(i->getReturnType()->duplicate());
-      } else {
-        Type* rt = i->getReturnType(); //...  void??  uhhh...
-        if (!rt) {
-          throw EvalError("Void-returning functions not yet supported");
-        }
-        returnTypes.reset(OrUnion(*returnTypes.get(), *i->getReturnType()));
-      }
-      */
-    }
-  }
-  return returnTypes;
+  return signature->getReturnType();
 }
 
-auto_ptr<Object> Function::call(const object_list& args) const {
-  // TODO
-  return auto_ptr<Object>(NULL);
+const Signature* Function::getSignature(const type_list& args) const {
+  const Signature* signature = getSignature(args.size());
+  if (!signature || args.empty()) return signature;
+  std::vector<uint32_t> key;
+  key.reserve(args.size());
+  for (type_iter i = args.begin(); i != args.end(); ++i) {
+    key.push_back((*i)->id());
+  }
+  dispatch_map::const_iterator found = m_dispatch.find(key);
+  if (m_dispatch.end() != found) {
+    return -1 == found->second ? NULL : &m_signatures[found->second];
+  }
+  bool compatible = signature->areArgsCompatible(args);
+  m_dispatch.insert(dispatch_map::value_type(key,
+      compatible ? m_byArgc[args.size()] : -1));
+  return compatible ? signature : NULL;
 }
 
+const Signature* Function::getSignature(size_t argc) const {
+  if (argc >= m_byArgc.size() || -1 == m_byArgc[argc]) return NULL;
+  return &m_signatures[m_byArgc[argc]];
+}
 
-/*
-const Signature* Function::getSignature(const argtype_list& args) const {
-  if (m_signatures.size() < 1) {
-    throw EvalError("Function must have at least one signature");
+Object* Function::call(CallFrame& frame) const {
+  if (&frame.function() != this) {
+    throw EvalError("Function " + print() + " cannot run the frame of " + frame.function().print());
   }
-  // For now, just pick the signature with the matching # arguments
-  for (signature_iter i = m_signatures.begin(); i != m_signatures.end(); ++i) {
-    if (i->areArgsCompatible(args)) {
-      return &*i;
+  // Trampoline: a body that makes a tail call has retargeted the frame, and
+  // we run the new callee here instead of nesting another call
+  for (;;) {
+    Object* result;
+    native_fn native = frame.signature().getNative();
+    Block* body = frame.signature().getBody();
+    if (native) {
+      result = native(m_log, frame);
+    } else if (body) {
+      result = body->call(frame);
+    } else {
+      throw EvalError("Function " + print() + " has a signature with no body");
+    }
+    if (!frame.takeTailCall()) {
+      return result;
+    }
+    if (result) {
+      // Nobody wants the result of a call that was replaced
+      result->retain();
+      result->release();
     }
   }
-  return NULL;
-*/
+}
+
+/* private */
 
-  /*
-  const Signature* bestSignature = NULL;
-  SignatureScore bestScore;
+void Function::deleteBodies() {
   for (signature_iter i = m_signatures.begin(); i != m_signatures.end(); ++i) {
-    if (i->areArgsCompatible(args)) {
-      if (!bestSignature) {
-        bestSignature = &*i;
-        bestScore = i->compatibilityScore(args);
-      } else {
-        SignatureScore score = i->compatibilityScore(args);
-        if (score.isBetterThan(bestScore)) {
-          bestSignature = &*i;
-          bestScore = score;
-        }
-      }
-    }
+    delete i->getBody();
   }
-  return bestSignature;
-  */
-/*
 }
-*/
@@ -22,38 +22,47 @@
  * or different return types.
  *
  * The function does not take ownership of any Type* or Object* it is given as
- * part of an Arg.  These must and will outlive the Function.
+ * part of an Arg.  These must and will outlive the Function.  It does own the
+ * body of each signature defined in shok.  A call to a function from within
+ * its own body holds a reference to it, so a recursive function is never
+ * freed; it lives as long as the scope that declared it anyway.
  *
  * Note that a function that "returns void" does not leave its returntype NULL,
  * it actually should have a void object that presently does not exist...
  */
 
+#include "Block.h"
+#include "CallStack.h"
 #include "Log.h"
 #include "Signature.h"
 #include "Type.h"
 #include "Variable.h"
 
+#include <deque>
+#include <map>
 #include <memory>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace eval {
 
-class Block;
-
 class Function : public Object {
 public:
   // What is the function's type?  something like @(A)->B  ?  or just @->B?  or
   // just @?
   // Answer:  @(A) & @->B which both have type @
-  Function(Log& log, const std::string& name, std::auto_ptr<Type> type,
+  Function(Log& log, const std::string& name, TypeRef type,
            Signature initialSignature);
+  virtual ~Function();
 
   void addSignature(Signature signature);
 
   bool takesArgs(const type_list& args) const;
 
   // Returns the best-match signature for the given arg-type list, or NULL if
-  // it doesn't match
+  // it doesn't match.  Call sites with fixed argument types should keep the
+  // result rather than asking again.
   // Who wants to call this and why??  We should give them what they actually
   // want, which I doubt is a Signature...  for now it's just Operator wants
   // the possible return type(s) for the best matching signature.
@@ -62,17 +71,44 @@ public:
   // @()->A|B), then we may not have a single best signature.  If the possible
   // return types are requested, then we'll need to find all the possible
   // best-matching signatures and get their return-type OR-union.
-  //const Signature* getSignature(const type_list& args) const;
-  std::auto_ptr<Type> getPossibleReturnTypes(const type_list& args) const;
+  const Signature* getSignature(const type_list& args) const;
+  TypeRef getPossibleReturnTypes(const type_list& args) const;
+
+  // The signature that takes argc arguments, or NULL.  No two signatures take
+  // the same number of arguments.
+  const Signature* getSignature(size_t argc) const;
+
+  // Changes whenever our signatures do.  A call site that keeps a Signature*
+  // from getSignature() must look it up again when this has changed.
+  unsigned int generation() const { return m_generation; }
 
-  std::auto_ptr<Object> call(const object_list& args) const;
+  // Run the function on the arguments in frame, which must be one of ours.
+  // Returns the result, which the caller should retain(), or NULL if there
+  // is none.  Tail calls made through the frame run here, in a loop.
+  Object* call(CallFrame& frame) const;
+
+  // Our signatures' Types are references too
+  virtual void references(HeapRefs& refs) const;
+  virtual void dropReferences();
 
 private:
-  typedef std::vector<Signature> signature_list;
+  void deleteBodies();
+
+  // A deque, so that adding a signature does not move the others: call sites
+  // and CallFrames point at them
+  typedef std::deque<Signature> signature_list;
   typedef signature_list::const_iterator signature_iter;
 
   signature_list m_signatures;
-  Block* m_body;  // ownership of this?? nah make it a legit member!
+  unsigned int m_generation;
+  // Dispatch structure, rebuilt by addSignature(): the index in m_signatures
+  // of the signature for each argument count (-1 for none), and the
+  // memoized choice for each tuple of canonical argument Type ids seen so far
+  // (-1 for no match).
+  typedef std::vector<int> argc_vec;
+  typedef std::map<std::vector<uint32_t>, int> dispatch_map;
+  argc_vec m_byArgc;
+  mutable dispatch_map m_dispatch;
 };
 
 };
@@ -0,0 +1,108 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "FunctionDef.h"
+
+#include "Brace.h"
+#include "EvalError.h"
+#include "Expression.h"
+#include "NewInit.h"
+#include "Optimizer.h"
+#include "Parameter.h"
+#include "Signature.h"
+#include "TypeSpec.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+FunctionDef::~FunctionDef() {
+  // The body belongs to the Function, even if it was never taken out of our
+  // children
+  for (child_mod_iter i = children.begin(); i != children.end(); ++i) {
+    if (*i == m_body) {
+      children.erase(i);
+      break;
+    }
+  }
+  if (m_function) m_function->release();
+}
+
+void FunctionDef::setup() {
+  if (!m_function || children.empty() || children.back() != m_body) {
+    throw EvalError("Function " + print() + " must end with its body");
+  }
+  children.pop_back();
+  m_body->parent = NULL;
+  // The body missed the optimization of the statement it was part of
+  Optimizer(log).optimize(*m_body);
+}
+
+// Nothing to do: the Function was made when our body started
+void FunctionDef::evaluate() {
+}
+
+/* protected */
+
+void FunctionDef::addChild(Node* child) {
+  Block* body = dynamic_cast<Block*>(child);
+  if (!body) {
+    Node::addChild(child);
+    return;
+  }
+  if (m_function) {
+    throw EvalError("Function " + print() + " already has a body");
+  }
+  argspec_list args;
+  TypeRef returnType;
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    Parameter* parameter = dynamic_cast<Parameter*>(*i);
+    TypeSpec* typeSpec = dynamic_cast<TypeSpec*>(*i);
+    if (parameter && !returnType.get()) {
+      args.push_back(ArgSpec(parameter->getName(), parameter->getType(),
+                             NULL));
+    } else if (typeSpec && !returnType.get()) {
+      returnType = typeSpec->getType();
+    } else {
+      throw EvalError("Function " + print() + " must have its parameters, then its return type, then its body");
+    }
+  }
+  computeType();
+  NewInit* init = declaringInit();
+  Node::addChild(body);
+  m_body = body;
+  m_function = new Function(log, init ? init->getVarname() : "func", m_type,
+                            Signature(args, returnType, *body));
+  m_function->retain();
+  body->declareParameters(*m_function->getSignature(args.size()));
+  if (init) {
+    init->declareFunction(*m_function);
+  }
+}
+
+/* private */
+
+void FunctionDef::computeType() {
+  // TODO: get this directly from the global scope
+  const Object* function = parentScope->getObject("@");
+  if (!function) {
+    throw EvalError("Cannot define a function until @ is defined");
+  }
+  m_type = BasicType::Get(*function);
+}
+
+// Our parent is a paren, or an Expression, or the paren around that; past
+// those may be the NewInit
+NewInit* FunctionDef::declaringInit() const {
+  Node* node = parent;
+  while (node) {
+    Brace* brace = dynamic_cast<Brace*>(node);
+    if ((brace && brace->isIrrelevant()) || dynamic_cast<Expression*>(node)) {
+      node = node->parent;
+    } else {
+      return dynamic_cast<NewInit*>(node);
+    }
+  }
+  return NULL;
+}
@@ -0,0 +1,63 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _FunctionDef_h_
+#define _FunctionDef_h_
+
+/* Function definition
+ *
+ * A function literal: its Parameters, then an optional return TypeSpec, then
+ * its body, a code Block:
+ *    (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {...})
+ *
+ * The Function is made as soon as the body starts, before the body's
+ * statements arrive, so that its parameters are in the body's scope.  If we
+ * are the initial value of a NewInit ("new f = func ..."), it declares the
+ * function right then too, so that the body can call f.
+ *
+ * At setup() the body is taken out of the AST: it belongs to the Function,
+ * and runs only when the function is called.  We hold a reference to the
+ * Function.
+ */
+
+#include "Block.h"
+#include "Function.h"
+#include "Log.h"
+#include "RootNode.h"
+#include "Token.h"
+#include "TypedNode.h"
+
+#include <string>
+
+namespace eval {
+
+class NewInit;
+
+class FunctionDef : public TypedNode {
+public:
+  FunctionDef(Log& log, RootNode*const root, const Token& token)
+    : TypedNode(log, root, token),
+      m_function(NULL),
+      m_body(NULL) {}
+  ~FunctionDef();
+
+  virtual void setup();
+  virtual void evaluate();
+
+protected:
+  // Our body is the last child; make the Function when it arrives
+  virtual void addChild(Node* child);
+
+private:
+  // from TypedNode
+  virtual void computeType();
+  // The NewInit that we are the initial value of, or NULL
+  NewInit* declaringInit() const;
+
+  Function* m_function;
+  Block* m_body;    // owned by m_function
+};
+
+};
+
+#endif // _FunctionDef_h_
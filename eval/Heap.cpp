@@ -0,0 +1,159 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Heap.h"
+
+#include "Object.h"
+#include "Type.h"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+Heap::Stats Heap::s_stats;
+size_t Heap::s_sinceCollect = 0;
+vector<const Object*> Heap::s_objects;
+
+void Heap::Allocated(const Object& object) {
+  if (object.id() >= s_objects.size()) {
+    s_objects.resize(object.id() + 1, NULL);
+  }
+  s_objects[object.id()] = &object;
+  ++s_stats.live;
+  ++s_stats.allocated;
+  ++s_sinceCollect;
+  if (s_stats.live > s_stats.peak) {
+    s_stats.peak = s_stats.live;
+  }
+}
+
+void Heap::Freed(const Object& object) {
+  if (object.id() < s_objects.size()) {
+    s_objects[object.id()] = NULL;
+  }
+  --s_stats.live;
+  ++s_stats.freed;
+}
+
+bool Heap::ShouldCollect() {
+  return s_sinceCollect >= COLLECT_INTERVAL;
+}
+
+size_t Heap::Collect(Log& log) {
+  s_sinceCollect = 0;
+  ++s_stats.collections;
+
+  // Number every live Object and Type as a node of the heap graph
+  vector<const Object*> objects;
+  for (vector<const Object*>::const_iterator i = s_objects.begin();
+       i != s_objects.end(); ++i) {
+    if (*i) objects.push_back(*i);
+  }
+  vector<const Type*> types;
+  Type::GetInterned(types);
+  typedef boost::unordered_map<const void*, size_t> index_map;
+  index_map index;
+  for (size_t n = 0; n < objects.size(); ++n) {
+    index[objects[n]] = n;
+  }
+  for (size_t n = 0; n < types.size(); ++n) {
+    index[types[n]] = objects.size() + n;
+  }
+  size_t count = objects.size() + types.size();
+
+  // Find each node's references to the others, and subtract them from the
+  // reference counts; what's left over comes from outside the heap
+  vector<vector<size_t> > edges(count);
+  vector<long> external(count);
+  for (size_t n = 0; n < count; ++n) {
+    HeapRefs refs;
+    if (n < objects.size()) {
+      external[n] += objects[n]->refs();
+      objects[n]->references(refs);
+    } else {
+      external[n] += types[n - objects.size()]->refs();
+      types[n - objects.size()]->references(refs);
+    }
+    for (vector<const Object*>::const_iterator i = refs.objects.begin();
+         i != refs.objects.end(); ++i) {
+      index_map::const_iterator target = index.find(*i);
+      if (index.end() == target) continue;
+      edges[n].push_back(target->second);
+      --external[target->second];
+    }
+    for (vector<const Type*>::const_iterator i = refs.types.begin();
+         i != refs.types.end(); ++i) {
+      index_map::const_iterator target = index.find(*i);
+      if (index.end() == target) continue;
+      edges[n].push_back(target->second);
+      --external[target->second];
+    }
+  }
+
+  // Mark everything reachable from a node with outside references
+  vector<bool> marked(count, false);
+  vector<size_t> stack;
+  for (size_t n = 0; n < count; ++n) {
+    if (external[n] > 0) {
+      marked[n] = true;
+      stack.push_back(n);
+    }
+  }
+  while (!stack.empty()) {
+    size_t n = stack.back();
+    stack.pop_back();
+    for (vector<size_t>::const_iterator i = edges[n].begin();
+         i != edges[n].end(); ++i) {
+      if (!marked[*i]) {
+        marked[*i] = true;
+        stack.push_back(*i);
+      }
+    }
+  }
+
+  // Every cycle passes through an Object (Types only refer to Types built
+  // before them), so cutting the garbage Objects' references frees it all.
+  // Hold the garbage until every cut is made, so nothing is destroyed while
+  // we still have a pointer to it.
+  vector<Object*> garbage;
+  for (size_t n = 0; n < objects.size(); ++n) {
+    if (!marked[n]) {
+      garbage.push_back(const_cast<Object*>(objects[n]));
+    }
+  }
+  if (garbage.empty()) {
+    return 0;
+  }
+  log.debug("Collecting " + boost::lexical_cast<string>(garbage.size()) + " unreachable objects");
+  size_t freedBefore = s_stats.freed;
+  for (vector<Object*>::const_iterator i = garbage.begin();
+       i != garbage.end(); ++i) {
+    (*i)->retain();
+  }
+  for (vector<Object*>::const_iterator i = garbage.begin();
+       i != garbage.end(); ++i) {
+    (*i)->dropReferences();
+  }
+  for (vector<Object*>::const_iterator i = garbage.begin();
+       i != garbage.end(); ++i) {
+    (*i)->release();
+  }
+  size_t freed = s_stats.freed - freedBefore;
+  s_stats.collected += freed;
+  return freed;
+}
+
+string Heap::PrintStats() {
+  return boost::lexical_cast<string>(s_stats.live) + " live objects (peak " +
+         boost::lexical_cast<string>(s_stats.peak) + "), " +
+         boost::lexical_cast<string>(s_stats.allocated) + " allocated, " +
+         boost::lexical_cast<string>(s_stats.freed) + " freed, " +
+         boost::lexical_cast<string>(s_stats.collected) + " collected in " +
+         boost::lexical_cast<string>(s_stats.collections) + " collections";
+}
@@ -0,0 +1,87 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Heap_h_
+#define _Heap_h_
+
+/* Object lifetime management
+ *
+ * Objects are reference-counted.  An Object is retained by whatever owns it
+ * (an ObjectStore slot, or the Object it is a member of) and by its
+ * BasicType, so an Object always outlives every Type that refers to it, and
+ * deleting a variable just drops the store's reference.
+ *
+ * The AST must not hold an Object* across a collection without a reference.
+ * A ProcCall retains the Function it calls, so the Function (and the
+ * Signature the call site chose) lasts as long as the call site does.  A
+ * Variable keeps only the lexical address of its Object, and fetches it
+ * afresh.  NewInit's Object* is only used within its own statement, before
+ * the next collection, while its pending store entry holds the Object.
+ *
+ * Reference counting alone cannot free a cycle, e.g. a member whose Type
+ * refers back to the Object that holds it.  Collect() finds these by trial
+ * deletion over every live Object and interned Type: the references each one
+ * holds to the others are subtracted from their counts, and anything left
+ * with references from outside the heap (stores, AST nodes) is a root.
+ * Whatever is not reachable from a root is garbage; its Objects drop their
+ * references, and reference counting frees the rest.
+ *
+ * The Heap also keeps statistics, so that a long-running session can report
+ * how many objects are live and how many have been freed.
+ */
+
+#include "Log.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class Object;
+class Type;
+
+// The Objects and Types that an Object or Type holds a reference to
+struct HeapRefs {
+  std::vector<const Object*> objects;
+  std::vector<const Type*> types;
+};
+
+class Heap {
+public:
+  struct Stats {
+    Stats()
+      : live(0), peak(0), allocated(0), freed(0),
+        collections(0), collected(0) {}
+    size_t live;          // Objects alive now
+    size_t peak;          // most Objects alive at once
+    size_t allocated;     // Objects ever created
+    size_t freed;         // Objects ever destroyed
+    size_t collections;   // runs of Collect()
+    size_t collected;     // Objects freed by Collect() (i.e. in cycles)
+  };
+
+  // Objects created since the last Collect() before ShouldCollect() says yes
+  static const size_t COLLECT_INTERVAL = 1024;
+
+  // Called by the Object constructor and destructor
+  static void Allocated(const Object& object);
+  static void Freed(const Object& object);
+
+  static bool ShouldCollect();
+  // Free unreachable cycles; returns the number of Objects freed
+  static size_t Collect(Log& log);
+
+  static const Stats& GetStats() { return s_stats; }
+  static std::string PrintStats();
+
+private:
+  static Stats s_stats;
+  static size_t s_sinceCollect;
+  // Every live Object, by its id
+  static std::vector<const Object*> s_objects;
+};
+
+};
+
+#endif // _Heap_h_
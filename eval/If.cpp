@@ -0,0 +1,44 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "If.h"
+
+#include "EvalError.h"
+#include "Value.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+void If::setup() {
+  if (children.size() != 2) {
+    throw EvalError("If " + print() + " must have a condition and a statement");
+  }
+  m_condition = dynamic_cast<Expression*>(children.at(0));
+  if (!m_condition) {
+    throw EvalError("If's first child must be an Expression");
+  }
+  m_branch = children.at(1);
+}
+
+// Nothing to do here
+void If::evaluate() {
+}
+
+/* protected */
+
+void If::evaluateChildren() {
+  m_condition->evaluateNode();
+  const Value& value = m_condition->getValue();
+  bool holds;
+  switch (value.kind()) {
+    case Value::KIND_INT: holds = !value.getInt().isZero(); break;
+    case Value::KIND_FIXED: holds = !value.getFixed().isZero(); break;
+    default:
+      throw EvalError("Condition " + m_condition->print() + " is not a number");
+  }
+  if (holds) {
+    m_branch->evaluateNode();
+  }
+}
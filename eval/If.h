@@ -0,0 +1,45 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _If_h_
+#define _If_h_
+
+/* If statement
+ *
+ * A condition Expression, then the statement (usually a Block) that runs
+ * only if it holds:
+ *    (if (exp (var ID:'n')) {...})
+ * For now a condition is a number, which holds if it is not zero.
+ */
+
+#include "Expression.h"
+#include "Log.h"
+#include "Node.h"
+#include "RootNode.h"
+#include "Token.h"
+
+#include <string>
+
+namespace eval {
+
+class If : public Node {
+public:
+  If(Log& log, RootNode*const root, const Token& token)
+    : Node(log, root, token),
+      m_condition(NULL),
+      m_branch(NULL) {}
+  virtual void setup();
+  virtual void evaluate();
+
+protected:
+  // Evaluate the branch only if the condition holds
+  virtual void evaluateChildren();
+
+private:
+  Expression* m_condition;
+  Node* m_branch;
+};
+
+};
+
+#endif // _If_h_
@@ -0,0 +1,438 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "List.h"
+
+#include "Arithmetic.h"
+#include "EvalError.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::string;
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace eval;
+
+const size_t List::INLINE_LANES;
+const size_t List::MAX_RANGE;
+
+namespace {
+  /* Lane kernels.  A stride of 0 broadcasts the first lane. */
+
+  // out = a + b, or a - b, over n lanes.  Returns false if any lane
+  // overflowed: a signed sum overflows when its sign differs from both
+  // operands', and a difference when the operands' signs differ and the
+  // result's differs from a's.
+  bool addLanes(const int64_t* a, size_t aStride,
+                const int64_t* b, size_t bStride,
+                int64_t* out, size_t n, bool subtract) {
+    size_t i = 0;
+    uint64_t overflow = 0;
+#if defined(__SSE2__)
+    __m128i ovf = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+      __m128i x = aStride ? _mm_loadu_si128((const __m128i*)(a + i))
+                          : _mm_set1_epi64x(a[0]);
+      __m128i y = bStride ? _mm_loadu_si128((const __m128i*)(b + i))
+                          : _mm_set1_epi64x(b[0]);
+      __m128i r = subtract ? _mm_sub_epi64(x, y) : _mm_add_epi64(x, y);
+      __m128i other = subtract ? _mm_xor_si128(x, y) : _mm_xor_si128(y, r);
+      ovf = _mm_or_si128(ovf, _mm_and_si128(_mm_xor_si128(x, r), other));
+      _mm_storeu_si128((__m128i*)(out + i), r);
+    }
+    // The sign bit of each 64-bit lane
+    overflow = _mm_movemask_pd(_mm_castsi128_pd(ovf));
+#endif
+    for (; i < n; ++i) {
+      uint64_t x = a[aStride * i];
+      uint64_t y = b[bStride * i];
+      uint64_t r = subtract ? x - y : x + y;
+      overflow |= ((x ^ r) & (subtract ? x ^ y : y ^ r)) >> 63;
+      out[i] = (int64_t)r;
+    }
+    return !overflow;
+  }
+
+  bool mulLanes(const int64_t* a, size_t aStride,
+                const int64_t* b, size_t bStride,
+                int64_t* out, size_t n) {
+    bool ok = true;
+    for (size_t i = 0; i < n; ++i) {
+      ok &= Arithmetic::Mul(a[aStride * i], b[bStride * i], out[i]);
+    }
+    return ok;
+  }
+
+  // Returns false if the total overflows
+  bool sumLanes(const int64_t* a, size_t n, int64_t& total) {
+    size_t i = 0;
+    int64_t sum = 0;
+#if defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    __m128i ovf = _mm_setzero_si128();
+    for (; i + 2 <= n; i += 2) {
+      __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+      __m128i r = _mm_add_epi64(acc, x);
+      ovf = _mm_or_si128(ovf, _mm_and_si128(_mm_xor_si128(acc, r),
+                                            _mm_xor_si128(x, r)));
+      acc = r;
+    }
+    if (_mm_movemask_pd(_mm_castsi128_pd(ovf))) {
+      return false;
+    }
+    int64_t halves[2];
+    _mm_storeu_si128((__m128i*)halves, acc);
+    if (!Arithmetic::Add(halves[0], halves[1], sum)) {
+      return false;
+    }
+#endif
+    for (; i < n; ++i) {
+      if (!Arithmetic::Add(sum, a[i], sum)) {
+        return false;
+      }
+    }
+    total = sum;
+    return true;
+  }
+
+  int64_t findLane(const int64_t* a, size_t n, int64_t x) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    // SSE2 has no 64-bit compare: a lane is equal when both its 32-bit
+    // halves are
+    __m128i needle = _mm_set1_epi64x(x);
+    for (; i + 2 <= n; i += 2) {
+      __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(a + i)),
+                                   needle);
+      eq = _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+      int mask = _mm_movemask_pd(_mm_castsi128_pd(eq));
+      if (mask) {
+        return i + ((mask & 1) ? 0 : 1);
+      }
+    }
+#endif
+    for (; i < n; ++i) {
+      if (a[i] == x) return i;
+    }
+    return -1;
+  }
+
+  bool isComparison(Operator::KIND kind) {
+    switch (kind) {
+      case Operator::KIND_EQ: case Operator::KIND_NE:
+      case Operator::KIND_LT: case Operator::KIND_LE:
+      case Operator::KIND_GT: case Operator::KIND_GE:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  // c is <0, 0 or >0 as for BigInt::Compare
+  bool compared(Operator::KIND kind, int c) {
+    switch (kind) {
+      case Operator::KIND_EQ: return 0 == c;
+      case Operator::KIND_NE: return 0 != c;
+      case Operator::KIND_LT: return c < 0;
+      case Operator::KIND_LE: return c <= 0;
+      case Operator::KIND_GT: return c > 0;
+      case Operator::KIND_GE: return c >= 0;
+      default: throw EvalError("Not a comparison operator");
+    }
+  }
+
+  // Numbers compare by value, whatever their kind; strs only to strs
+  int compareValues(const Value& a, const Value& b) {
+    if (a.isNumeric() && b.isNumeric()) {
+      if (Value::KIND_INT == a.kind() && Value::KIND_INT == b.kind()) {
+        return BigInt::Compare(a.getInt(), b.getInt());
+      }
+      return BigInt::Compare(a.getFixed(), b.getFixed());
+    } else if (Value::KIND_STR == a.kind() && Value::KIND_STR == b.kind()) {
+      return a.getText().compare(b.getText());
+    }
+    throw EvalError("Cannot compare " + a.print() + " with " + b.print());
+  }
+};
+
+List::List()
+  : m_size(0),
+    m_packed(true),
+    m_laneKind(Value::KIND_NONE) {
+}
+
+List List::Range(int64_t n) {
+  if (n < 0) {
+    throw EvalError("Cannot make a list of negative length");
+  } else if ((uint64_t)n > MAX_RANGE) {
+    throw EvalError("Cannot make a range of " + boost::lexical_cast<string>(n) + " elements; the most is " + boost::lexical_cast<string>(MAX_RANGE));
+  }
+  List list(Value::KIND_INT, n);
+  int64_t* lanes = list.lanes();
+  for (int64_t i = 0; i < n; ++i) {
+    lanes[i] = i;
+  }
+  return list;
+}
+
+Value List::at(size_t i) const {
+  if (i >= m_size) {
+    throw EvalError("List index " + boost::lexical_cast<string>(i) + " is out of range for a list of " + boost::lexical_cast<string>(m_size));
+  }
+  return m_packed ? lane(lanes()[i]) : m_boxed[i];
+}
+
+void List::push(const Value& value) {
+  if (Value::KIND_NONE == value.kind()) {
+    throw EvalError("Cannot add a missing value to a list");
+  }
+  int64_t x;
+  if (m_packed && 0 == m_size && value.getSmallInt(x)) {
+    m_laneKind = Value::KIND_INT;
+  } else if (m_packed && 0 == m_size &&
+             Value::KIND_FIXED == value.kind() && value.getSmallFixed(x)) {
+    m_laneKind = Value::KIND_FIXED;
+  }
+  if (m_packed && fitsLane(value, x)) {
+    pushLane(x);
+    return;
+  }
+  box();
+  m_boxed.push_back(value);
+  ++m_size;
+}
+
+string List::print() const {
+  string s = "[";
+  for (size_t i = 0; i < m_size; ++i) {
+    if (i > 0) s += ", ";
+    s += at(i).print();
+  }
+  return s + "]";
+}
+
+/* Bulk operations */
+
+List List::Elementwise(Operator::KIND kind, const List& a, const List& b) {
+  size_t n = Broadcast(a, b);
+  size_t aStride = 1 == a.m_size ? 0 : 1;
+  size_t bStride = 1 == b.m_size ? 0 : 1;
+  // Lanes of ints or fixed units add and subtract alike; only an int
+  // product is a plain lane product
+  bool isAdd = Operator::KIND_PLUS == kind || Operator::KIND_MINUS == kind;
+  bool isMul = Operator::KIND_STAR == kind && Value::KIND_INT == a.m_laneKind;
+  if (a.m_packed && b.m_packed && a.m_laneKind == b.m_laneKind &&
+      (isAdd || isMul)) {
+    List result(a.m_laneKind, n);
+    bool ok = isAdd
+        ? addLanes(a.lanes(), aStride, b.lanes(), bStride, result.lanes(), n,
+                   Operator::KIND_MINUS == kind)
+        : mulLanes(a.lanes(), aStride, b.lanes(), bStride, result.lanes(), n);
+    if (ok) {
+      return result;
+    }
+  }
+  // Everything else, including lanes that overflowed, goes element by
+  // element through the Arithmetic kernels
+  List result;
+  Value out;
+  for (size_t i = 0; i < n; ++i) {
+    Value x = a.at(aStride * i);
+    Value y = b.at(bStride * i);
+    bool isFixed = Value::KIND_FIXED == x.kind() ||
+                   Value::KIND_FIXED == y.kind();
+    Arithmetic::kernel_fn kernel =
+        Arithmetic::Select(kind, Operator::INFIX, isFixed);
+    if (!kernel) {
+      throw EvalError("Lists only combine elementwise with arithmetic operators");
+    }
+    kernel(x, y, out);
+    result.push(out);
+  }
+  return result;
+}
+
+List List::Compare(Operator::KIND kind, const List& a, const List& b) {
+  if (!isComparison(kind)) {
+    throw EvalError("Lists only compare elementwise with comparison operators");
+  }
+  size_t n = Broadcast(a, b);
+  size_t aStride = 1 == a.m_size ? 0 : 1;
+  size_t bStride = 1 == b.m_size ? 0 : 1;
+  List mask(Value::KIND_INT, n);
+  int64_t* out = mask.lanes();
+  if (a.m_packed && b.m_packed && a.m_laneKind == b.m_laneKind) {
+    const int64_t* x = a.lanes();
+    const int64_t* y = b.lanes();
+    for (size_t i = 0; i < n; ++i) {
+      int64_t l = x[aStride * i];
+      int64_t r = y[bStride * i];
+      out[i] = compared(kind, (l > r) - (l < r));
+    }
+  } else {
+    for (size_t i = 0; i < n; ++i) {
+      out[i] = compared(kind, compareValues(a.at(aStride * i),
+                                            b.at(bStride * i)));
+    }
+  }
+  return mask;
+}
+
+List List::where(const List& mask) const {
+  if (mask.m_size != m_size) {
+    throw EvalError("Cannot apply a mask of " + boost::lexical_cast<string>(mask.m_size) + " to a list of " + boost::lexical_cast<string>(m_size));
+  }
+  if (!mask.m_packed || (m_size > 0 && Value::KIND_INT != mask.m_laneKind)) {
+    throw EvalError("A list mask must be a list of ints");
+  }
+  const int64_t* keep = mask.lanes();
+  if (!m_packed) {
+    List result;
+    for (size_t i = 0; i < m_size; ++i) {
+      if (keep[i]) result.push(m_boxed[i]);
+    }
+    return result;
+  }
+  size_t count = 0;
+  for (size_t i = 0; i < m_size; ++i) {
+    count += (0 != keep[i]);
+  }
+  // Branch-free compaction: every lane is written, but only kept lanes
+  // advance the output
+  List result(m_laneKind, count);
+  if (count > 0) {
+    const int64_t* in = lanes();
+    std::vector<int64_t> scratch(m_size);
+    size_t n = 0;
+    for (size_t i = 0; i < m_size; ++i) {
+      scratch[n] = in[i];
+      n += (0 != keep[i]);
+    }
+    std::copy(scratch.begin(), scratch.begin() + count, result.lanes());
+  }
+  return result;
+}
+
+Value List::sum() const {
+  int64_t total;
+  if (m_packed && sumLanes(lanes(), m_size, total)) {
+    return Value::KIND_FIXED == m_laneKind ? Value::Fixed(total)
+                                           : Value::Int(total);
+  }
+  // Overflowed, or boxed: BigInt arithmetic
+  Value acc = Value::Int(0);
+  for (size_t i = 0; i < m_size; ++i) {
+    Value x = at(i);
+    bool isFixed = Value::KIND_FIXED == acc.kind() ||
+                   Value::KIND_FIXED == x.kind();
+    Arithmetic::Select(Operator::KIND_PLUS, Operator::INFIX, isFixed)(acc, x,
+                                                                     acc);
+  }
+  return acc;
+}
+
+Value List::min() const {
+  return minMax(false);
+}
+
+Value List::max() const {
+  return minMax(true);
+}
+
+int64_t List::find(const Value& value) const {
+  int64_t x;
+  if (m_packed) {
+    return fitsLane(value, x) ? findLane(lanes(), m_size, x) : -1;
+  }
+  for (size_t i = 0; i < m_size; ++i) {
+    if (m_boxed[i].kind() == value.kind() ||
+        (m_boxed[i].isNumeric() && value.isNumeric())) {
+      if (0 == compareValues(m_boxed[i], value)) return i;
+    }
+  }
+  return -1;
+}
+
+/* private */
+
+List::List(Value::KIND laneKind, size_t size)
+  : m_size(size),
+    m_packed(true),
+    m_laneKind(size > 0 ? laneKind : Value::KIND_NONE) {
+  if (size > INLINE_LANES) {
+    m_heap.resize(size);
+  }
+}
+
+Value List::lane(int64_t x) const {
+  return Value::KIND_FIXED == m_laneKind ? Value::Fixed(x) : Value::Int(x);
+}
+
+bool List::fitsLane(const Value& value, int64_t& x) const {
+  if (Value::KIND_INT == m_laneKind) {
+    return value.getSmallInt(x);
+  } else if (Value::KIND_FIXED == m_laneKind) {
+    return Value::KIND_FIXED == value.kind() && value.getSmallFixed(x);
+  }
+  return false;
+}
+
+void List::pushLane(int64_t x) {
+  if (m_size < INLINE_LANES) {
+    m_inline[m_size] = x;
+  } else {
+    if (m_heap.empty()) {
+      m_heap.reserve(2 * INLINE_LANES);
+      m_heap.assign(m_inline, m_inline + m_size);
+    }
+    m_heap.push_back(x);
+  }
+  ++m_size;
+}
+
+void List::box() {
+  if (!m_packed) return;
+  m_boxed.reserve(m_size + 1);
+  for (size_t i = 0; i < m_size; ++i) {
+    m_boxed.push_back(lane(lanes()[i]));
+  }
+  m_heap.clear();
+  m_packed = false;
+  m_laneKind = Value::KIND_NONE;
+}
+
+size_t List::Broadcast(const List& a, const List& b) {
+  if (a.m_size == b.m_size || 1 == b.m_size) {
+    return a.m_size;
+  } else if (1 == a.m_size) {
+    return b.m_size;
+  }
+  throw EvalError("Cannot combine lists of " + boost::lexical_cast<string>(a.m_size) + " and " + boost::lexical_cast<string>(b.m_size) + " elements");
+}
+
+Value List::minMax(bool isMax) const {
+  if (0 == m_size) {
+    throw EvalError(string("Cannot take the ") + (isMax ? "max" : "min") + " of an empty list");
+  }
+  if (m_packed) {
+    const int64_t* in = lanes();
+    int64_t best = in[0];
+    for (size_t i = 1; i < m_size; ++i) {
+      best = (isMax ? in[i] > best : in[i] < best) ? in[i] : best;
+    }
+    return lane(best);
+  }
+  size_t best = 0;
+  for (size_t i = 1; i < m_size; ++i) {
+    int c = compareValues(m_boxed[i], m_boxed[best]);
+    if (isMax ? c > 0 : c < 0) best = i;
+  }
+  return m_boxed[best];
+}
@@ -0,0 +1,96 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _List_h_
+#define _List_h_
+
+/* List
+ *
+ * A list value: a contiguous sequence of Values.
+ *
+ * While every element is a number of one kind (all ints, or all fixeds) that
+ * fits in an int64, the list is "packed": its elements are kept unboxed, as
+ * an array of int64 lanes.  The first INLINE_LANES lanes live in the List
+ * itself, so short lists never allocate.  Pushing anything else (a str, a
+ * BigInt, a number of the other kind) boxes the whole list into a vector of
+ * Values, where it stays.
+ *
+ * The bulk operations are what scripts should use instead of loops.  On
+ * packed lists they run straight over the lanes, in SSE2 where it helps, and
+ * only drop to the general per-element Arithmetic kernels (and so BigInt)
+ * when a lane would overflow or the list is boxed.  Binary operations take
+ * lists of the same length, or broadcast a list of length one.
+ *
+ * A mask is a packed int list of 0s and 1s, as made by compare(); where()
+ * keeps the elements whose mask lane is non-zero.
+ */
+
+#include "Operator.h"
+#include "Value.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class List {
+public:
+  static const size_t INLINE_LANES = 8;
+  // Refuse to make a range longer than this
+  static const size_t MAX_RANGE = 1 << 24;
+
+  List();
+
+  // [0, 1, ..., n-1].  Throws if n is more than MAX_RANGE.
+  static List Range(int64_t n);
+
+  size_t size() const { return m_size; }
+  bool isPacked() const { return m_packed; }
+  // KIND_INT or KIND_FIXED for a non-empty packed list, else KIND_NONE
+  Value::KIND laneKind() const { return m_laneKind; }
+  Value at(size_t i) const;
+  void push(const Value& value);
+  std::string print() const;
+
+  /* Bulk operations */
+
+  // Elementwise a op b, for an arithmetic operator (+ - * / % ^)
+  static List Elementwise(Operator::KIND kind, const List& a, const List& b);
+  // Elementwise mask of a op b, for a comparison (== != < <= > >=)
+  static List Compare(Operator::KIND kind, const List& a, const List& b);
+  List where(const List& mask) const;
+  // Throw on an empty list; sum() of an empty list is 0
+  Value sum() const;
+  Value min() const;
+  Value max() const;
+  // Index of the first element equal to value, or -1
+  int64_t find(const Value& value) const;
+
+private:
+  int64_t* lanes() { return m_heap.empty() ? m_inline : &m_heap[0]; }
+  const int64_t* lanes() const {
+    return m_heap.empty() ? m_inline : &m_heap[0];
+  }
+  Value lane(int64_t x) const;
+  // Can value be stored as a lane of this list?
+  bool fitsLane(const Value& value, int64_t& x) const;
+  void pushLane(int64_t x);
+  void box();
+  // A list of size lanes of kind laneKind, for the bulk operations to fill
+  List(Value::KIND laneKind, size_t size);
+  // The length of a op b; throws unless the lengths match or one is 1
+  static size_t Broadcast(const List& a, const List& b);
+  Value minMax(bool isMax) const;
+
+  size_t m_size;
+  bool m_packed;
+  Value::KIND m_laneKind;
+  int64_t m_inline[INLINE_LANES];
+  std::vector<int64_t> m_heap;    // all lanes, once there are too many
+  std::vector<Value> m_boxed;     // all elements, once not packed
+};
+
+};
+
+#endif // _List_h_
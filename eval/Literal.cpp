@@ -0,0 +1,60 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Literal.h"
+
+#include "EvalError.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+Literal::Literal(Log& log, RootNode*const root, const Token& token)
+  : TypedNode(log, root, token) {
+  if ("INT" == token.name) {
+    m_kind = INT;
+  } else if ("FIXED" == token.name) {
+    m_kind = FIXED;
+  } else if ("STR" == token.name) {
+    m_kind = STR;
+  } else {
+    throw EvalError("Cannot make a Literal from token " + token.print());
+  }
+}
+
+void Literal::setup() {
+  if (children.size() != 0) {
+    throw EvalError("Literal " + print() + " cannot have children");
+  }
+  if (STR != m_kind && "" == value) {
+    throw EvalError("Numeric literal cannot have blank value");
+  }
+  switch (m_kind) {
+    case INT:   m_value = Value::ParseInt(value); break;
+    case FIXED: m_value = Value::ParseFixed(value); break;
+    case STR:   m_value = Value::Str(value); break;
+    default: throw EvalError("Literal " + print() + " has unknown kind");
+  }
+  computeType();
+}
+
+// Nothing to do
+void Literal::evaluate() {
+}
+
+void Literal::computeType() {
+  string typeName;
+  switch (m_kind) {
+    case INT:   typeName = "int"; break;
+    case FIXED: typeName = "fixed"; break;
+    case STR:   typeName = "str"; break;
+    default: throw EvalError("Literal " + print() + " has unknown kind");
+  }
+  // TODO: get this directly from the global scope
+  const Object* object = parentScope->getObject(typeName);
+  if (!object) {
+    throw EvalError("Cannot use a literal " + typeName + " until " + typeName + " is defined");
+  }
+  m_type = BasicType::Get(*object);
+}
@@ -0,0 +1,49 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Literal_h_
+#define _Literal_h_
+
+/* Literal
+ *
+ * An INT, FIXED or STR constant from the source.  Its Type is the matching
+ * stdlib object (int, fixed or str), and its text is kept verbatim as the
+ * Node's value.  Literals are the leaves that the Optimizer can fold
+ * operator subtrees down into.
+ */
+
+#include "Log.h"
+#include "RootNode.h"
+#include "Token.h"
+#include "TypedNode.h"
+
+#include <string>
+
+namespace eval {
+
+class Literal : public TypedNode {
+public:
+  enum KIND {
+    INT,
+    FIXED,
+    STR,
+  };
+
+  Literal(Log& log, RootNode*const root, const Token& token);
+  virtual void setup();
+  virtual void evaluate();
+
+  KIND kind() const { return m_kind; }
+  std::string text() const { return value; }
+  virtual const Value& getValue() const { return m_value; }
+
+private:
+  // from TypedNode
+  virtual void computeType();
+  KIND m_kind;
+  Value m_value;    // parsed at setup
+};
+
+};
+
+#endif // _Literal_h_
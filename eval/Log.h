@@ -4,7 +4,11 @@
 #ifndef _Log_h_
 #define _Log_h_
 
-/* Debug log */
+/* Debug log
+ *
+ * The default level is INFO.  Debug messages are built on hot paths (once
+ * per token, node and character), so callers guard them with isDebug().
+ */
 
 #include <fstream>
 #include <string>
@@ -21,7 +25,7 @@ public:
     WARNING = 30,
     ERROR = 40
   };
-  static const LEVEL DEFAULT_LEVEL = DEBUG;
+  static const LEVEL DEFAULT_LEVEL = INFO;
 
   Log();
   ~Log();
@@ -34,6 +38,10 @@ public:
   void info(const std::string& msg);
   void debug(const std::string& msg);
 
+  // Callers check this before building a debug message, so that the string
+  // work is skipped when it would be thrown away
+  bool isDebug() const { return m_level <= DEBUG; }
+
 private:
   std::ofstream m_log;
   LEVEL m_level;
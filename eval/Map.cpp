@@ -0,0 +1,248 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Map.h"
+
+#include "EvalError.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+using std::string;
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace eval;
+
+const size_t Map::GROUP_SIZE;
+
+namespace {
+  // Both have the high bit set, so that a group's free slots are exactly
+  // the sign bits of its control bytes
+  const int8_t EMPTY = -128;
+  const int8_t DELETED = -2;
+  const size_t npos = (size_t)-1;
+
+  uint64_t mix(uint64_t x) {
+    // splitmix64's finalizer
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  // FNV-1a
+  uint64_t hashStr(const char* s, size_t n, uint64_t seed) {
+    uint64_t h = 0xcbf29ce484222325ULL ^ seed;
+    for (size_t i = 0; i < n; ++i) {
+      h ^= (unsigned char)s[i];
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  uint64_t hashBig(const BigInt& i) {
+    string digits = i.print();
+    return hashStr(digits.data(), digits.size(), 1);
+  }
+
+  uint64_t H1(uint64_t hash) { return hash >> 7; }
+  int8_t H2(uint64_t hash) { return hash & 0x7F; }
+
+  // Bit i is set for each control byte i of the group equal to b
+  uint32_t matchByte(const int8_t* group, int8_t b) {
+#if defined(__SSE2__)
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(b)));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < Map::GROUP_SIZE; ++i) {
+      mask |= (uint32_t)(group[i] == b) << i;
+    }
+    return mask;
+#endif
+  }
+
+  // Bit i is set for each EMPTY or DELETED control byte i of the group
+  uint32_t matchFree(const int8_t* group) {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    uint32_t mask = 0;
+    for (size_t i = 0; i < Map::GROUP_SIZE; ++i) {
+      mask |= (uint32_t)(group[i] < 0) << i;
+    }
+    return mask;
+#endif
+  }
+
+  bool keysEqual(const Value& a, const Value& b) {
+    if (a.kind() != b.kind()) return false;
+    return Value::KIND_INT == a.kind() ? a.getInt() == b.getInt()
+                                       : a.getText() == b.getText();
+  }
+};
+
+Map::Map()
+  : m_live(0),
+    m_used(0) {
+}
+
+const Value* Map::get(const Value& key) const {
+  size_t slot = findSlot(key, Hash(key));
+  return npos == slot ? NULL : &m_entries[m_slots[slot]].value;
+}
+
+Value* Map::get(const Value& key) {
+  size_t slot = findSlot(key, Hash(key));
+  return npos == slot ? NULL : &m_entries[m_slots[slot]].value;
+}
+
+void Map::set(const Value& key, const Value& value) {
+  if (Value::KIND_NONE == value.kind()) {
+    throw EvalError("Cannot put a missing value in a map");
+  }
+  uint64_t hash = Hash(key);
+  size_t slot = findSlot(key, hash);
+  if (npos != slot) {
+    m_entries[m_slots[slot]].value = value;
+    return;
+  }
+  size_t capacity = m_ctrl.size();
+  if ((m_used + 1) * 8 > capacity * 7) {
+    // Grow, unless enough of the used slots are only DELETED
+    size_t newCapacity = capacity ? capacity : GROUP_SIZE;
+    while ((m_live + 1) * 2 > newCapacity) {
+      newCapacity *= 2;
+    }
+    rehash(newCapacity);
+  }
+  Entry entry;
+  entry.hash = hash;
+  entry.key = key;
+  entry.value = value;
+  entry.live = true;
+  m_entries.push_back(entry);
+  insertSlot(hash, m_entries.size() - 1);
+  ++m_live;
+}
+
+bool Map::remove(const Value& key) {
+  size_t slot = findSlot(key, Hash(key));
+  if (npos == slot) {
+    return false;
+  }
+  Entry& entry = m_entries[m_slots[slot]];
+  entry.live = false;
+  entry.key = Value();
+  entry.value = Value();
+  m_ctrl[slot] = DELETED;
+  --m_live;
+  return true;
+}
+
+List Map::keys() const {
+  List list;
+  for (entry_vec::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+    if (i->live) list.push(i->key);
+  }
+  return list;
+}
+
+List Map::values() const {
+  List list;
+  for (entry_vec::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+    if (i->live) list.push(i->value);
+  }
+  return list;
+}
+
+string Map::print() const {
+  string s = "{";
+  for (entry_vec::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+    if (!i->live) continue;
+    if (s.size() > 1) s += ", ";
+    s += i->key.print() + ": " + i->value.print();
+  }
+  return s + "}";
+}
+
+/* private */
+
+uint64_t Map::Hash(const Value& key) {
+  if (Value::KIND_STR == key.kind()) {
+    const Rope& text = key.getText();
+    return mix(hashStr(text.data(), text.size(), 0));
+  } else if (Value::KIND_INT == key.kind()) {
+    int64_t i;
+    // A BigInt is never equal to a small int, so may hash however it likes
+    return key.getSmallInt(i) ? mix((uint64_t)i)
+                              : mix(hashBig(key.getInt()));
+  }
+  throw EvalError("Map keys must be strs or ints, not " + key.print());
+}
+
+size_t Map::findSlot(const Value& key, uint64_t hash) const {
+  if (m_ctrl.empty()) {
+    return npos;
+  }
+  size_t groups = m_ctrl.size() / GROUP_SIZE;
+  size_t group = H1(hash) & (groups - 1);
+  int8_t h2 = H2(hash);
+  // Triangular probing, which visits every group of a power-of-two table
+  for (size_t probe = 1; probe <= groups; ++probe) {
+    const int8_t* ctrl = &m_ctrl[group * GROUP_SIZE];
+    for (uint32_t match = matchByte(ctrl, h2); match; match &= match - 1) {
+      size_t slot = group * GROUP_SIZE + __builtin_ctz(match);
+      const Entry& entry = m_entries[m_slots[slot]];
+      if (entry.hash == hash && keysEqual(entry.key, key)) {
+        return slot;
+      }
+    }
+    // An EMPTY slot ends the probe sequence: key would have gone there
+    if (matchByte(ctrl, EMPTY)) {
+      return npos;
+    }
+    group = (group + probe) & (groups - 1);
+  }
+  return npos;
+}
+
+void Map::insertSlot(uint64_t hash, uint32_t index) {
+  size_t groups = m_ctrl.size() / GROUP_SIZE;
+  size_t group = H1(hash) & (groups - 1);
+  for (size_t probe = 1; ; ++probe) {
+    uint32_t free = matchFree(&m_ctrl[group * GROUP_SIZE]);
+    if (free) {
+      size_t slot = group * GROUP_SIZE + __builtin_ctz(free);
+      if (EMPTY == m_ctrl[slot]) {
+        ++m_used;
+      }
+      m_ctrl[slot] = H2(hash);
+      m_slots[slot] = index;
+      return;
+    }
+    group = (group + probe) & (groups - 1);
+  }
+}
+
+void Map::rehash(size_t capacity) {
+  // Compact away removed entries, keeping insertion order
+  if (m_live != m_entries.size()) {
+    entry_vec entries;
+    entries.reserve(m_live + 1);
+    for (entry_vec::const_iterator i = m_entries.begin(); i != m_entries.end(); ++i) {
+      if (i->live) entries.push_back(*i);
+    }
+    m_entries.swap(entries);
+  }
+  m_ctrl.assign(capacity, EMPTY);
+  m_slots.assign(capacity, 0);
+  m_used = 0;
+  for (size_t i = 0; i < m_entries.size(); ++i) {
+    insertSlot(m_entries[i].hash, i);
+  }
+}
@@ -0,0 +1,80 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Map_h_
+#define _Map_h_
+
+/* Map
+ *
+ * A map value: from str or int keys to Values, iterated in insertion order.
+ *
+ * Entries are appended to a dense vector, which is what iteration walks.
+ * The hash table over them is SwissTable-style open addressing: an array of
+ * one-byte control words, and a parallel array of entry indices.  A control
+ * byte is EMPTY, DELETED, or the low 7 bits of its key's hash (H2).  The rest
+ * of the hash (H1) picks the group of GROUP_SIZE slots where probing starts.
+ * A lookup compares H2 against a whole group of control bytes at once (with
+ * SSE2 where available), and only looks at entries whose byte matched, so it
+ * almost always touches one group and one entry.
+ *
+ * The table is kept at most 7/8 full, counting DELETED slots, and rebuilt
+ * when it passes that: at double the capacity, or the same capacity if
+ * removals have made room.  So operations are amortized O(1).  Removing a key
+ * leaves a hole in the entry vector, which the next rebuild compacts.
+ */
+
+#include "List.h"
+#include "Value.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class Map {
+public:
+  static const size_t GROUP_SIZE = 16;
+
+  Map();
+
+  size_t size() const { return m_live; }
+  // The value for key, or NULL if there is none.  Throws if key is not a
+  // str or int.
+  const Value* get(const Value& key) const;
+  Value* get(const Value& key);
+  void set(const Value& key, const Value& value);
+  // False if there was no such key
+  bool remove(const Value& key);
+
+  // In insertion order
+  List keys() const;
+  List values() const;
+  std::string print() const;
+
+private:
+  struct Entry {
+    uint64_t hash;
+    Value key;
+    Value value;
+    bool live;
+  };
+  typedef std::vector<Entry> entry_vec;
+
+  static uint64_t Hash(const Value& key);
+  // The slot holding key, or npos
+  size_t findSlot(const Value& key, uint64_t hash) const;
+  // Claim a slot for entry number index, which must not already be present
+  void insertSlot(uint64_t hash, uint32_t index);
+  void rehash(size_t capacity);
+
+  std::vector<int8_t> m_ctrl;     // a control byte per slot
+  std::vector<uint32_t> m_slots;  // the entry index in each full slot
+  entry_vec m_entries;
+  size_t m_live;                  // entries that are live
+  size_t m_used;                  // slots that are not EMPTY
+};
+
+};
+
+#endif // _Map_h_
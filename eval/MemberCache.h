@@ -0,0 +1,50 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _MemberCache_h_
+#define _MemberCache_h_
+
+/* Inline cache for a member lookup
+ *
+ * A MemberCache is the per-site cache for looking up one member of an
+ * Object.  It remembers the Shape it last saw and the member's offset in it,
+ * so looking up the member on any Object of that Shape is a compare and an
+ * index.
+ */
+
+#include "Object.h"
+#include "Shape.h"
+#include "Symbol.h"
+
+#include <stddef.h>
+
+namespace eval {
+
+class MemberCache {
+public:
+  MemberCache()
+    : m_shape(NULL),
+      m_offset(0) {}
+
+  // Only an object's own members are cached; one inherited from a parent
+  // goes through Object::getMember() every time.
+  Object* lookup(const Object& object, symbol_id member) {
+    const Shape* shape = &object.getShape();
+    if (shape == m_shape) return object.getMemberAt(m_offset);
+    size_t offset;
+    if (shape->lookup(member, offset)) {
+      m_shape = shape;
+      m_offset = offset;
+      return object.getMemberAt(offset);
+    }
+    return object.getMember(member);
+  }
+
+private:
+  const Shape* m_shape;
+  size_t m_offset;
+};
+
+};
+
+#endif // _MemberCache_h_
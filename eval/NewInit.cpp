@@ -3,8 +3,10 @@
 
 #include "NewInit.h"
 
+#include "Activation.h"
 #include "Block.h"
 #include "EvalError.h"
+#include "Function.h"
 #include "Identifier.h"
 #include "Type.h"
 
@@ -17,7 +19,7 @@ NewInit::~NewInit() {
   // Revert our object if we've partially created it.
   // Be paranoid here since this is regarding error conditions.
   if (m_isPrepared && parentScope && m_varname != "" &&
-      parentScope->getObject(m_varname)) {
+      parentScope->isPending(m_varname)) {
     parentScope->revert(m_varname);
   }
 }
@@ -46,7 +48,7 @@ void NewInit::setup() {
       if (!object) {
         throw EvalError("Cannot find the object object.  Uhoh.");
       }
-      m_type.reset(new BasicType(*object));
+      m_type = BasicType::Get(*object);
       // leave m_typeSpec NULL
       // leave m_exp NULL
       break;
@@ -63,7 +65,7 @@ void NewInit::setup() {
         throw EvalError("NewInit " + print() + " somehow has child of both TypeSpec and Exp type");
       } else if (m_typeSpec) {
         m_type = m_typeSpec->getType();
-        if (!dynamic_cast<BasicType*>(m_type.get())) {
+        if (!dynamic_cast<const BasicType*>(m_type.get())) {
           throw EvalError("NewInit " + print() + " has aggregate type " + m_typeSpec->print() + " but no default value is provided");
         }
       } else if (m_exp) {
@@ -98,9 +100,14 @@ void NewInit::setup() {
     default:
       throw EvalError("NewInit node must have 1, 2, or 3 children");
   }
+  if (m_isDeclared && (2 != children.size() || !m_exp)) {
+    throw EvalError("Function " + m_varname + " must be declared as new " + m_varname + " = func ...");
+  }
 }
 
 void NewInit::prepare() {
+  // A function was made our object when its body started
+  if (m_isDeclared) return;
   if (!parentScope) {
     throw EvalError("Cannot prepare NewInit " + print() + " with no parent scope");
   } else if (parentScope->getObject(m_varname)) {
@@ -111,27 +118,66 @@ void NewInit::prepare() {
 
   // Construct the object in our parent scope.  We keep a reference to the
   // Object just so we don't have to look it up again in evaluate() when we may
-  // want to assign an initial value.  We pass along the auto_ptr to m_type; we
-  // don't need it anymore, and this saves a copy.
+  // want to assign an initial value.
   m_object = &parentScope->newObject(m_varname, m_type);
   m_isPrepared = true;
 }
 
-// Commit the new object to our enclosing scope, and assign its initial value
+string NewInit::getVarname() const {
+  Identifier* identifier = children.empty() ? NULL :
+      dynamic_cast<Identifier*>(children.front());
+  if (!identifier) {
+    throw EvalError("NewInit " + print() + " has no name");
+  }
+  return identifier->getName();
+}
+
+void NewInit::declareFunction(Function& function) {
+  if (!parentScope) {
+    throw EvalError("Cannot declare function in NewInit " + print() + " with no parent scope");
+  } else if (m_isPrepared) {
+    throw EvalError("NewInit " + print() + " has already been prepared");
+  }
+  m_varname = getVarname();
+  if (parentScope->getObject(m_varname)) {
+    throw EvalError("Variable " + m_varname + " already exists");
+  }
+  m_object = &parentScope->addObject(m_varname, &function);
+  m_isPrepared = true;
+  m_isDeclared = true;
+}
+
+// Commit the new object to our enclosing scope (the first time), and assign
+// its initial value
 void NewInit::evaluate() {
-  // TODO: remove this when we are confident it can't happen
-  if (!m_isPrepared) {
-    throw EvalError("Cannot evaluate NewInit node until it has been prepared");
-  } else if (!m_object) {
-    throw EvalError("Cannot evaluate NewInit with deficient Object");
+  if (!m_isCommitted) {
+    // TODO: remove this when we are confident it can't happen
+    if (!m_isPrepared) {
+      throw EvalError("Cannot evaluate NewInit node until it has been prepared");
+    } else if (!m_object) {
+      throw EvalError("Cannot evaluate NewInit with deficient Object");
+    }
+    parentScope->commit(m_varname);
+    m_isPrepared = false;
+    m_isCommitted = true;
   }
-  parentScope->commit(m_varname);
-  m_isPrepared = false;
   // TODO assign initial value
-  if (m_exp) {
+  if (m_exp && !m_isDeclared) {
+    // For now, just the primitive Value (if any) of the expression
+    m_object->setValue(m_exp->getValue());
     //m_object->assign(m_exp->getObject());
   } else {
     // TODO assign clone of default value of the object's type, or has this
     // already been done??
   }
 }
+
+/* protected */
+
+void NewInit::saveResult(Activation& activation) const {
+  if (m_object) activation.saveValue(m_object->getValue());
+}
+
+void NewInit::restoreResult(Activation& activation) {
+  if (m_object) m_object->setValue(activation.restoreValue());
+}
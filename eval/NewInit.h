@@ -11,6 +11,13 @@
  *    new x : y       equivalent to   new x : y = y
  *    new x = y       equivalent to   new x : typeof(y) = y
  *    new x : y = z   equivalent to   new x : y = z
+ *
+ * In "new f = func ...", the function is declared as soon as its body
+ * starts, by declareFunction(), so that the body can call it by name.  The
+ * Function itself is then f's object, rather than a copy of its value.
+ *
+ * In a function body, a NewInit runs on every call.  Its object is committed
+ * the first time; each time, it is given its initial value.
  */
 
 #include "Expression.h"
@@ -26,15 +33,19 @@
 
 namespace eval {
 
+class Function;
+
 class NewInit : public Node {
 public:
   NewInit(Log& log, RootNode*const root, const Token& token)
     : Node(log, root, token),
       m_isPrepared(false),
+      m_isDeclared(false),
+      m_isCommitted(false),
       m_identifier(NULL),
       m_exp(NULL),
       m_typeSpec(NULL),
-      m_type(NULL),
+      m_type(),
       m_object(NULL) {}
   ~NewInit();
 
@@ -47,11 +58,25 @@ public:
   // perform the object creation, but mark it as "pending" in the Scope until
   // evaluation() time finally marks it as commit().
   void prepare();
+  // The name of the new variable; available before setup
+  std::string getVarname() const;
+  // Make function our new object, right away (before setup).  Called by the
+  // FunctionDef of our initial value when its body starts.
+  void declareFunction(Function& function);
   // Commit the object to the Scope, and assign its initial value
   virtual void evaluate();
+  virtual evaluator_fn evaluator() const { return &EvaluateDirect<NewInit>; }
+
+protected:
+  // from Node: our object's value, which a re-entered function body sets
+  // aside
+  virtual void saveResult(Activation& activation) const;
+  virtual void restoreResult(Activation& activation);
 
 private:
   bool m_isPrepared;
+  bool m_isDeclared;    // by declareFunction()
+  bool m_isCommitted;
   std::string m_varname;
   // child 0: the identifier of the variable being created
   Identifier* m_identifier;
@@ -62,11 +87,11 @@ private:
   TypeSpec* m_typeSpec;
   // Type of the new variable.  Provided by m_typeSpec if it exists, otherwise
   // by the type of m_exp if it exists, otherwise stdlib::object.
-  std::auto_ptr<Type> m_type;
+  TypeRef m_type;
   // The new Object that was created.  Set by Scope::newObject(), and used to
   // perform the initial value assignment during evaluate().  We do not have
   // ownership, we just hang onto this so we don't have to look it up again.
-  const Object* m_object;
+  Object* m_object;
 };
 
 };
@@ -3,20 +3,27 @@
 
 #include "Node.h"
 
+#include "Activation.h"
 #include "Block.h"
 #include "Brace.h"
 #include "Command.h"
 #include "CommandFragment.h"
 #include "EvalError.h"
 #include "Expression.h"
+#include "FunctionDef.h"
 #include "Identifier.h"
+#include "If.h"
 #include "IsVar.h"
+#include "Literal.h"
 #include "Log.h"
 #include "New.h"
 #include "NewInit.h"
 #include "Operator.h"
 #include "OperatorParser.h"
+#include "Optimizer.h"
+#include "Parameter.h"
 #include "ProcCall.h"
+#include "Return.h"
 #include "RootNode.h"
 #include "TypeSpec.h"
 #include "Variable.h"
@@ -47,17 +54,14 @@ Node* Node::MakeNode(Log& log, RootNode*const root, const Token& t) {
     return new Identifier(log, root, t);
   if ("var" == t.name)
     return new Variable(log, root, t);
-  if ("PLUS" == t.name ||
-      "MINUS" == t.name ||
-      "STAR" == t.name ||
-      "SLASH" == t.name ||
-      "PERCENT" == t.name ||
-      "CARAT" == t.name ||
-      "PIPE" == t.name ||
-      "AMP" == t.name ||
-      "TILDE" == t.name ||
-      "DOUBLETILDE" == t.name)
-    return new Operator(log, root, t);
+  if ("INT" == t.name ||
+      "FIXED" == t.name ||
+      "STR" == t.name)
+    return new Literal(log, root, t);
+  // paren only groups a subexpression; it is not an Operator node
+  Operator::KIND kind;
+  if (Operator::Kind(t.name, kind) && Operator::KIND_PAREN != kind)
+    return new Operator(log, root, t, kind);
   if ("exp" == t.name)
     return new Expression(log, root, t);
   if ("new" == t.name)
@@ -70,6 +74,14 @@ Node* Node::MakeNode(Log& log, RootNode*const root, const Token& t) {
     return new ProcCall(log, root, t);
   if ("isvar" == t.name)
     return new IsVar(log, root, t);
+  if ("func" == t.name)
+    return new FunctionDef(log, root, t);
+  if ("arg" == t.name)
+    return new Parameter(log, root, t);
+  if ("return" == t.name)
+    return new Return(log, root, t);
+  if ("if" == t.name)
+    return new If(log, root, t);
   throw EvalError("Unsupported token " + t.print());
   return NULL;    // guard
 }
@@ -79,64 +91,29 @@ Node* Node::InsertNode(Log& log, Node* current, Node* n) {
     throw EvalError("NULL nodes provided to Node::InsertNode()");
   }
   Brace* brace = dynamic_cast<Brace*>(n);
+  Node* owner = Owner(current);
 
-  // Neither an open nor a closing brace; add as a child of current
+  // Neither an open nor a closing brace; add as a child of the owner.  The
+  // operands and operators of an Expression or TypeSpec instead go to its
+  // OperatorParser, which builds them into a tree as they arrive (Pratt
+  // parsing), setting each one up as soon as it can.
   if (!brace) {
     n->initScopeNode(current);
-    OperatorParser* oP = dynamic_cast<OperatorParser*>(current->children.at(0));
+    n->parent = owner;
+    OperatorParser* oP = dynamic_cast<OperatorParser*>(owner);
     if (oP) {
       oP->insertNode(n);
     } else {
-      n->parent = current;
-      current->addChild(n);
+      owner->addChild(n);
     }
-
-    // Some nodes employ Pratt parsing, which allows children nodes to be
-    // setup() before the parent is complete.  Check if that's the case here.
-
-    // If current's first child is an Expression or TypeSpec:
-    //  - don't insert the current node
-    //  - instead, call InsertExpressionNode() which we implement here on Node
-    //  - that uses a ... static stack.... uhhhhh..... sure?  and tracks all
-    //  the nodes and makes them a tree
-    //  - when we hit the closing brace of current, we FinalizeExpressionNode()
-    //  or some such.  This pulls out the tree, giving us the root, which
-    //  becomes the single child of the Expression (the first child of
-    //  current).
-
-    // That should juuuuust... work.
-
-    // Note that InsertNode will recurse into nodes (say, vars, and functions)
-    // that are alongside the Expression.  We need to be quite stateless about
-    // when we are PrattParsing something, and multiple of these PrattParsers
-    // can be on-the-go at the same time.
-
-    // Let's find a way to encapsulate the Expression's PrattParsingness and
-    // shove it onto that Exp/TypeSpec node.
-
-    // Within the Pratt parsing, anytime we finish up an operator, perform the
-    // operator's setupAsParent() or whatever.  Actually, BinaryOperators might
-    // have to be craaazy, with a setupLeft() and setupRight().  During
-    // setupLeft(), an operator (*ahem* like &) may determine something about
-    // its left branch that any random thing that happens on its right side
-    // might need to know.  So it can shove this info into the PrattParsingness
-    // object, and this data should get passed down the initNode() of
-    // everything we parse until we bubble up and finally call the setupRight()
-    // on this operator (followed by its own setupNode(), naturally!).
-
-    // wheeeeeee!
-
-    // What if we don't know about Exp/TS, we just notice when we find our
-    // first Operator at some level, whoah, Pratt parse this guy!  hmm..
-
     return current;   // stay
   }
 
-  // Open brace: descend into current; new nodes will be its children
+  // Open brace: descend into it; new nodes will be its children
   if (brace->isOpen()) {
-    n->parent = current;
-    current->addChild(n);
-    n->initScopeNode(current);
+    n->parent = owner;
+    n->initScopeNode(owner);
+    owner->addChild(n);
     return n;         // descend
   }
 
@@ -144,9 +121,9 @@ Node* Node::InsertNode(Log& log, Node* current, Node* n) {
   // ascend our focus up.  Perform static analysis on the new parent.
   //
   // When parentheses are matched, they will be eliminated from the AST since
-  // they represent nothing.  Instead, their first child (operator) will take
-  // over the "parent" spot; its children (operands) will remain as the
-  // operator's children.
+  // they represent nothing.  Instead, their first child (the node they
+  // opened, which has been collecting its own children) takes over the
+  // paren's spot in its parent.
   // current should be the open brace/paren to match against
   if (!current->parent) {
     throw EvalError("Cannot move above root node " + current->name);
@@ -161,41 +138,36 @@ Node* Node::InsertNode(Log& log, Node* current, Node* n) {
   }
   Node* parent = current->parent;
 
-  // Parentheses: these are now useless.  We promote the first child (there
-  // must be at least one child!) into the parent (paren) spot; it is the
-  // operator, its children are its operands.  Huzzah!
   if (open->isIrrelevant()) {
-    // Extract the first child of the open brace; it is the new "operator"
+    // Extract the first child of the open brace; it replaces the paren
     if (open->children.size() < 1) {
       throw EvalError("Empty parens in the AST are not allowed");
     }
-    Node* op = open->children.front();    // "operator" becomes the parent
+    Node* op = open->children.front();
     open->children.pop_front();
-    op->parent = open->parent;
-    // a '({' cannot appear in the input.  Note that actual parentheses in
-    // expressions are not given to us as a bare '(' brace.
-    if (op->children.size() != 0) {
-      throw EvalError("Cannot escalate child " + op->name + " that has " + boost::lexical_cast<string>(op->children.size()) + " > 0 children");
-    }
-    op->children = open->children;
-    open->children.clear();   // Clear open's children so they're not deleted
-    // Replace op's children's parent links from open to op
-    for (Node::child_iter i = op->children.begin();
-         i != op->children.end(); ++i) {
-      (*i)->parent = op;
-    }
-    // Replace parent's child of 'open' with 'op'
-    for (Node::child_mod_iter i = op->parent->children.begin();
-         i != op->parent->children.end(); ++i) {
-      if (*i == open) {
-        *i = op;
-        break;    // a node must only appear once in the AST
-      }
+    // Everything after the first child was given to it, not to the paren
+    if (open->children.size() != 0) {
+      throw EvalError("Paren around " + op->name + " has " + boost::lexical_cast<string>(open->children.size()) + " stray children");
     }
+    op->parent = parent;
+    parent->replaceChild(open, op);
     delete open;
     // Errors from setupAsParent are recoverable
     try {
       op->setupAsParent();
+      // An operand of an Expression or TypeSpec (say, a variable or a call)
+      // is complete; hand it to the parser
+      OperatorParser* oP = dynamic_cast<OperatorParser*>(parent);
+      if (oP) {
+        oP->insertNode(op);
+        for (child_mod_iter i = parent->children.begin();
+             i != parent->children.end(); ++i) {
+          if (*i == op) {
+            parent->children.erase(i);
+            break;
+          }
+        }
+      }
     } catch (EvalError& e) {
       RecoverFromError(e, op);
       throw EvalError(string("Failed to recover from error: ") + e.what());
@@ -210,9 +182,24 @@ Node* Node::InsertNode(Log& log, Node* current, Node* n) {
     }
   }
   delete n;   // always discard the closing brace/paren
+  // If parent is what a paren opened, the paren is where its own closing
+  // brace is expected
+  Node* grandparent = parent->parent;
+  if (grandparent && Owner(grandparent) == parent) {
+    return grandparent;   // ascend
+  }
   return parent;    // ascend
 }
 
+Node* Node::Owner(Node* current) {
+  Brace* paren = dynamic_cast<Brace*>(current);
+  if (paren && paren->isOpen() && paren->isIrrelevant() &&
+      !paren->children.empty()) {
+    return paren->children.front();
+  }
+  return current;
+}
+
 // Find the nearest enclosing block (ancestor) of the given node, and delete
 // the subtree from which it came, and (to be paranoid) any of the block's
 // children that follow it (there shouldn't be any).
@@ -231,7 +218,10 @@ void Node::RecoverFromError(EvalError& e, Node* problemNode) {
       }
       // Find current in the parentBlock's children.  Delete it and any
       // subsequent children.
-      parentBlock->removeChildrenStartingAt(current);
+      // (Called through a Node*, not the Block*: removeChildrenStartingAt()
+      // is protected, so we may only call it on a Node.  It is virtual, so
+      // the Block's override still runs and rolls back its scope too.)
+      current->parent->removeChildrenStartingAt(current);
       throw RecoveredError(e, parentBlock);
     }
   } catch (EvalError& x) {
@@ -256,11 +246,14 @@ Node::Node(Log& log, RootNode*const root, const Token& token)
     isAnalyzed(false),
     isEvaluated(false),
     parent(NULL),
-    parentScope(NULL) {
+    parentScope(NULL),
+    evaluateFn(NULL) {
 }
 
 Node::~Node() {
-  log.debug("Destroying node " + name);
+  if (log.isDebug()) {
+    log.debug("Destroying node " + name);
+  }
   for (child_iter i = children.begin(); i != children.end(); ++i) {
     delete *i;
   }
@@ -287,7 +280,7 @@ void Node::initScopeNode(Node* scopeParent) {
 }
 
 void Node::replaceChild(Node* oldChild, Node* newChild) {
-  string oldPrint = print();
+  string oldPrint = log.isDebug() ? print() : "";
   bool replaced = false;
   for (child_mod_iter i = children.begin(); i != children.end(); ++i) {
     if (*i == oldChild) {
@@ -299,36 +292,35 @@ void Node::replaceChild(Node* oldChild, Node* newChild) {
   if (!replaced) {
     throw EvalError("Failed to replace " + oldChild->print() + " with " + newChild->print() + " in " + print());
   }
-  log.debug("Replaced " + oldChild->print() + " in " + oldPrint + " with " + newChild->print() + " to become " + print());
+  if (log.isDebug()) {
+    log.debug("Replaced " + oldChild->print() + " in " + oldPrint + " with " + newChild->print() + " to become " + print());
+  }
 }
 
 // Called only on nodes that are understood to be parents.
 // We setupNode() the nodes children-first.
 void Node::setupAsParent() {
+  // An Expression or TypeSpec has been parsing its operators as they came;
+  // the finished tree becomes its child
+  OperatorParser* oP = dynamic_cast<OperatorParser*>(this);
+  if (oP) {
+    Node* tree = oP->finalizeParse();
+    tree->parent = this;
+    children.push_back(tree);
+  }
   // Note: the node's grandchildren should all already be setup.
   for (child_iter i = children.begin(); i != children.end(); ++i) {
     (*i)->setupNode();
   }
-  Expression* exp = dynamic_cast<Expression*>(this);
-  TypeSpec* typespec = dynamic_cast<TypeSpec*>(this);
-  if (exp || typespec) {
-    // hm, can we rethink what we're doing?  Maybe there's a more general class
-    // of things that don't want setup() to happen until they are done, that
-    // is, defer setting up the intermediaries.  *ahem* object literal *ahem*.
-    // What about function?  Maybe it really is a bad language design decision
-    // to not let functions be analyzed properly until the expression they're a
-    // part of is analyzed.  Humph...
-    //
-    // I wonder if we can know the precedence of & well enough that we actually
-    // can evaluate ObjLits and Functions as they are typed -- i.e. we can look
-    // back for anything that's already been declared (parent types we know)
-    // and just not allow YET anything whose parent type has not been, um,
-    // typed.
-    // PRATT PARSING TO THE RESCUE!! but we will add hax to detect where this
-    // might be needed, up in InsertNode()....
-  }
   setupNode();
-  log.debug("Setup node " + print());
+  if (log.isDebug()) {
+    log.debug("Setup node " + print());
+  }
+  // A top-level statement is complete once it's analyzed, so this is the one
+  // time to optimize it before it runs
+  if (root == parent && root != NULL) {
+    Optimizer(log).optimize(*this);
+  }
 }
 
 void Node::setupNode() {
@@ -339,10 +331,14 @@ void Node::setupNode() {
   if (!parent) {
     throw EvalError("Cannot setup Node " + print() + " with no parent");
   }
-  log.debug(" - setting up node " + print());
+  if (log.isDebug()) {
+    log.debug(" - setting up node " + print());
+  }
   setup();
   isSetup = true;
-  log.debug(" - analyzing node " + print());
+  if (log.isDebug()) {
+    log.debug(" - analyzing node " + print());
+  }
   analyzeNode();
   isAnalyzed = true;
 }
@@ -355,7 +351,9 @@ void Node::analyzeNode() {
 
   Statement* statement = dynamic_cast<Statement*>(this);
   if (statement) {
-    log.debug(" - - analyzing statement " + print());
+    if (log.isDebug()) {
+      log.debug(" - - analyzing statement " + print());
+    }
     statement->analyze();
   }
 }
@@ -370,14 +368,51 @@ void Node::evaluateNode() {
     throw EvalError("Node " + print() + " cannot be evaluated until init, setup, and analyzed");
   }
   // Evaluate nodes children-first
-  for (child_iter i = children.begin(); i != children.end(); ++i) {   
-    (*i)->evaluateNode();
+  evaluateChildren();
+  if (log.isDebug()) {
+    log.debug(" - evaluating node " + print());
   }
-  log.debug(" - evaluating node " + print());
-  evaluate();
+  if (!evaluateFn) {
+    evaluateFn = evaluator();
+  }
+  evaluateFn(this);
   isEvaluated = true;
 }
 
+void Node::resetEvaluated() {
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    (*i)->resetEvaluated();
+  }
+  isEvaluated = false;
+}
+
+// Preorder, so that restoreActivation() reads back in the same order
+void Node::saveActivation(Activation& activation) const {
+  activation.saveFlag(isEvaluated);
+  saveResult(activation);
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    (*i)->saveActivation(activation);
+  }
+}
+
+void Node::restoreActivation(Activation& activation) {
+  isEvaluated = activation.restoreFlag();
+  restoreResult(activation);
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    (*i)->restoreActivation(activation);
+  }
+}
+
+Block* Node::enclosingBody() const {
+  for (Node* node = parent; node; node = node->parent) {
+    Block* block = dynamic_cast<Block*>(node);
+    if (block && block->isBody()) {
+      return block;
+    }
+  }
+  return NULL;
+}
+
 string Node::print() const {
   string r = name;
   if (value.length() > 0) {
@@ -400,12 +435,20 @@ Node::operator std::string() const {
 
 /* protected */
 
+void Node::evaluateChildren() {
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    (*i)->evaluateNode();
+  }
+}
+
 void Node::addChild(Node* child) {
   children.push_back(child);
 }
 
 void Node::removeChildrenStartingAt(const Node* child) {
-  log.debug("Removing children from " + print() + " starting at " + child->print());
+  if (log.isDebug()) {
+    log.debug("Removing children from " + print() + " starting at " + child->print());
+  }
   int foundChildren = 0;
   for (child_iter i = children.begin(); i != children.end(); ++i) {
     if (child == *i || foundChildren > 0) {
@@ -31,6 +31,7 @@
 
 namespace eval {
 
+class Activation;
 class Block;
 class EvalError;
 class RootNode;
@@ -51,6 +52,9 @@ protected:
   // throws a RecoveredError with the cleaned-up block which the AST will catch
   // and use as the new current position.
   static void RecoverFromError(EvalError& e, Node* problemNode);
+  // The node that a node inserted at current belongs to.  Within an open
+  // paren that is the paren's first child (the node it opened), if any.
+  static Node* Owner(Node* current);
 
   // Creates an operator tree out of the provided node's flattened children.
   // We do this during setupNode(), before we setup() an Expression or TypeSpec.
@@ -63,6 +67,15 @@ public:
   void replaceChild(Node* oldChild, Node* newChild);
   // Evaluate the node!  Public because it's called by AST on the root node.
   void evaluateNode();
+  // Clear the evaluated flags of the node and its children, so that the
+  // subtree can be evaluated again (a function body, on each call)
+  void resetEvaluated();
+  // Set aside the evaluation state of the node and its subtree, so that a
+  // re-entered function body can run again and then carry on
+  void saveActivation(Activation& activation) const;
+  void restoreActivation(Activation& activation);
+  // The nearest enclosing function body, or NULL
+  Block* enclosingBody() const;
 
   std::string getName() const { return name; }
   std::string getValue() const { return value; }
@@ -73,6 +86,9 @@ public:
 
 protected:
   friend class Expression;
+  friend class FunctionDef;
+  friend class OperatorParser;
+  friend class Optimizer;
   Node(Log&, RootNode*const, const Token&);
 
   typedef std::deque<Node*> child_vec;
@@ -89,14 +105,38 @@ protected:
   void analyzeNode();
 
   // called by InsertNode()
-  void addChild(Node* child);
+  virtual void addChild(Node* child);
   // called rather scandalously by RecoverFromError()
-  void removeChildrenStartingAt(const Node* child);
+  virtual void removeChildrenStartingAt(const Node* child);
 
   virtual void initScope(Node* scopeParent) {}    // early scope init
   virtual void setup() = 0;             // child-first setup/analysis
   virtual void evaluate() = 0;          // child-first code execution
+  // Called by evaluateNode() before evaluate(); evaluates every child in
+  // order.  Control flow (a conditional, a return) overrides it.
+  virtual void evaluateChildren();
   virtual void cleanup(bool error) {}   // child-first cleanup
+
+  // Direct entry point to a node's evaluate(), resolved once by
+  // evaluateNode() the first time the node runs.  The default makes the
+  // usual virtual call; leaf classes return EvaluateDirect<Self> instead.
+  // EvaluateDirect<T> only compiles if T declares evaluate() itself, so a
+  // class cannot silently skip its own override by inheriting its parent's.
+  typedef void (*evaluator_fn)(Node*);
+  virtual evaluator_fn evaluator() const { return &EvaluateVirtual; }
+  static void EvaluateVirtual(Node* node) { node->evaluate(); }
+  template <class T>
+  static void EvaluateDirect(Node* node) {
+    (void)sizeof(SameClass<T, __typeof__(*DeclaringClass(&T::evaluate))>);
+    static_cast<T*>(node)->T::evaluate();
+  }
+  template <class A, class B> struct SameClass;
+  template <class A> struct SameClass<A, A> {};
+  // The class that declares the member function f
+  template <class C> static C* DeclaringClass(void (C::*f)());
+  // A node's own results, for saveActivation() and restoreActivation()
+  virtual void saveResult(Activation& activation) const {}
+  virtual void restoreResult(Activation& activation) {}
   virtual Scope* getScope() { return NULL; }              // local scope
   Scope* getParentScope() const { return parentScope; }   // enclosing scope
   void setParentScope(Scope* scope) { parentScope = scope; }
@@ -117,6 +157,8 @@ protected:
   child_vec children;
   // Set by initScope()
   Scope* parentScope;   // nearest enclosing scope (execution context)
+  // Set by evaluateNode() from evaluator()
+  evaluator_fn evaluateFn;
 };
 
 };
@@ -3,18 +3,49 @@
 
 #include "Object.h"
 
+#include "Symbol.h"
+
 #include <memory>
 #include <string>
-using std::auto_ptr;
 using std::string;
 
 using namespace eval;
 
-Object::Object(Log& log, const string& name, auto_ptr<Type> type)
+Object::Object(Log& log, const string& name, TypeRef type)
   : m_log(log),
-    m_objectStore(new ObjectStore(log)),
+    m_refs(0),
+    m_shape(&Shape::Empty()),
     m_name(name),
-    m_type(type) {
+    m_type(type),
+    m_id(ObjectSet::AllocateId()) {
+  Heap::Allocated(*this);
+}
+
+Object::~Object() {
+  for (std::vector<Object*>::const_iterator i = m_members.begin();
+       i != m_members.end(); ++i) {
+    (*i)->release();
+  }
+  Heap::Freed(*this);
+  ObjectSet::ReleaseId(m_id);
+}
+
+void Object::references(HeapRefs& refs) const {
+  refs.objects.insert(refs.objects.end(), m_members.begin(), m_members.end());
+  if (m_type.get()) {
+    refs.types.push_back(m_type.get());
+  }
+}
+
+void Object::dropReferences() {
+  std::vector<Object*> members;
+  members.swap(m_members);
+  m_shape = &Shape::Empty();
+  m_type = TypeRef();
+  for (std::vector<Object*>::const_iterator i = members.begin();
+       i != members.end(); ++i) {
+    (*i)->release();
+  }
 }
 
 Object* Object::getMember(const string& name) const {
@@ -25,22 +56,52 @@ Object* Object::getMember(const string& name) const {
   // Note: it's up to the caller to ensure that whatever action they take on
   // the result, it should be done in the context of the child object, and not
   // the Object* they get back on its own.
-  Object* o = m_objectStore->getObject(name);
+  symbol_id symbol;
+  Object* o = Symbol::Find(name, symbol) ? findOwnMember(symbol) : NULL;
   if (o) return o;
   return m_type->getMember(name);
 }
 
-auto_ptr<Type> Object::getMemberType(const string& name) const {
+Object* Object::getMember(symbol_id name) const {
+  if (!m_type.get()) {
+    throw EvalError("Cannot get member " + Symbol::Name(name) + " of Object " + print() + " that has no type");
+  }
+  Object* o = findOwnMember(name);
+  if (o) return o;
+  return m_type->getMember(Symbol::Name(name));
+}
+
+TypeRef Object::getMemberType(const string& name) const {
   if (!m_type.get()) {
     throw EvalError("Cannot get type of member " + name + " of Object " + print() + " that has no type");
   }
-  const Object* o = m_objectStore->getObject(name);
-  if (o) return auto_ptr<Type>(o->getType().duplicate());
+  symbol_id symbol;
+  const Object* o = Symbol::Find(name, symbol) ? findOwnMember(symbol) : NULL;
+  if (o) return TypeRef(&o->getType());
   return m_type->getMemberType(name);
 }
 
-Object& Object::newMember(const string& varname, auto_ptr<Type> type) {
-  return m_objectStore->newObject(varname, type);
+Object& Object::newMember(const string& varname, TypeRef type) {
+  return addMember(varname, new Object(m_log, varname, type));
+}
+
+Object& Object::addMember(const string& varname, Object* member) {
+  symbol_id symbol = Symbol::Intern(varname);
+  member->retain();
+  if (findOwnMember(symbol)) {
+    member->release();
+    throw EvalError("Cannot create member " + varname + " of Object " + print() + "; already exists");
+  }
+  m_log.info("Adding member " + varname + " to object " + print());
+  m_members.push_back(member);
+  m_shape = &m_shape->withMember(symbol);
+  return *member;
+}
+
+Object* Object::findOwnMember(symbol_id name) const {
+  size_t offset;
+  if (!m_shape->lookup(name, offset)) return NULL;
+  return m_members[offset];
 }
 
 /*
@@ -10,8 +10,11 @@
  * Type which refers to its parents.
  *
  * Object is not a Node; it's a thing created by ObjectStores, in blocks or
- * other Objects.  The Object owns its members by way of its own internal
- * ObjectStore.
+ * other Objects.  The Object owns its members, which it keeps in a plain
+ * vector; its Shape says which member is at which offset.
+ *
+ * Objects are reference-counted (see Heap): an Object is retained by its
+ * owner and by its BasicType, and deletes itself on its last release().
  *
  * An Object might be a function, meaning simply that it has at least one
  * member of type "function builtin".  So any object can *attempt* to be called
@@ -19,13 +22,18 @@
  * codeblock for the provided args.
  */
 
+#include "Heap.h"
 #include "Log.h"
+#include "ObjectSet.h"
 #include "ObjectStore.h"
+#include "Shape.h"
+#include "Symbol.h"
 #include "Type.h"
+#include "Value.h"
 
-#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace eval {
 
@@ -35,24 +43,48 @@ class Type;
 
 class Object {
 public:
-  Object(Log& log, const std::string& name, std::auto_ptr<Type> type);
+  Object(Log& log, const std::string& name, TypeRef type);
+
+  virtual ~Object();
 
-  virtual ~Object() {}
+  void retain() const { ++m_refs; }
+  void release() const {
+    if (0 == --m_refs) delete this;
+  }
+  unsigned int refs() const { return m_refs; }
+  // The Objects and Types we hold references to, for Heap::Collect()
+  virtual void references(HeapRefs& refs) const;
+  // Let go of those references, to break a garbage cycle
+  virtual void dropReferences();
 
   std::string print() const { return m_name; }
+  // Small dense id, unique among live Objects
+  ObjectSet::object_id id() const { return m_id; }
   const Type& getType() const {
     if (!m_type.get()) {
       throw EvalError("Object " + print() + " does not appear to have a Type");
     }
-    return *m_type.get();
+    return *m_type;
   }
 
   // Retrieve a member, deferring to the parent type(s) if it's not found.
   Object* getMember(const std::string& name) const;
-  std::auto_ptr<Type> getMemberType(const std::string& name) const;
+  Object* getMember(symbol_id name) const;
+  TypeRef getMemberType(const std::string& name) const;
+  // Our own member at an offset of our Shape; for inline caches
+  const Shape& getShape() const { return *m_shape; }
+  Object* getMemberAt(size_t offset) const { return m_members.at(offset); }
   // TODO should an initial value (object) be required?  by auto_ptr I guess?
   // Probably shouldn't allow creation of an OrType with no default value?
-  Object& newMember(const std::string& varname, std::auto_ptr<Type> type);
+  Object& newMember(const std::string& varname, TypeRef type);
+  // Add an already-constructed member (e.g. a Function); we take ownership
+  Object& addMember(const std::string& varname, Object* member);
+
+  // Primitive data, for numbers, strs and collections
+  const Value& getValue() const { return m_value; }
+  void setValue(const Value& value) { m_value = value; }
+  // For changing a list or map in place, without copying it
+  Value& getMutableValue() { return m_value; }
 
   //Function& newSignature(const argspec_list& args, Type* returnType, (void*) builtinCode);
 
@@ -68,12 +100,17 @@ public:
   //void assign(const std::string& name, Object* value);
 
 protected:
+  // Our own member (not a parent's), or NULL
+  Object* findOwnMember(symbol_id name) const;
+
   Log& m_log;
-  // This is an auto_ptr only to resolve a circular type dependency that
-  // prevents us from keeping it by value  :/
-  std::auto_ptr<ObjectStore> m_objectStore;
+  mutable unsigned int m_refs;
+  const Shape* m_shape;
+  std::vector<Object*> m_members;   // by offset in m_shape; we own these
   std::string m_name;
-  std::auto_ptr<Type> m_type;
+  TypeRef m_type;
+  Value m_value;
+  ObjectSet::object_id m_id;
 };
 
 };
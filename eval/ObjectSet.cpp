@@ -0,0 +1,100 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "ObjectSet.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+namespace {
+  ObjectSet::object_id g_nextId = 0;
+  vector<ObjectSet::object_id> g_freeIds;
+};
+
+ObjectSet::object_id ObjectSet::AllocateId() {
+  if (g_freeIds.empty()) return g_nextId++;
+  object_id id = g_freeIds.back();
+  g_freeIds.pop_back();
+  return id;
+}
+
+void ObjectSet::ReleaseId(object_id id) {
+  g_freeIds.push_back(id);
+}
+
+void ObjectSet::insert(object_id id) {
+  size_t w = id / WORD_BITS;
+  if (w >= m_words.size()) {
+    m_words.resize(w + 1, 0);
+  }
+  m_words[w] |= (word)1 << (id % WORD_BITS);
+}
+
+bool ObjectSet::contains(object_id id) const {
+  size_t w = id / WORD_BITS;
+  if (w >= m_words.size()) return false;
+  return 0 != (m_words[w] & ((word)1 << (id % WORD_BITS)));
+}
+
+void ObjectSet::merge(const ObjectSet& rhs) {
+  if (rhs.m_words.size() > m_words.size()) {
+    m_words.resize(rhs.m_words.size(), 0);
+  }
+  for (size_t i = 0; i < rhs.m_words.size(); ++i) {
+    m_words[i] |= rhs.m_words[i];
+  }
+}
+
+bool ObjectSet::intersects(const ObjectSet& rhs) const {
+  size_t n = std::min(m_words.size(), rhs.m_words.size());
+  const word* a = n ? &m_words[0] : NULL;
+  const word* b = n ? &rhs.m_words[0] : NULL;
+  size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 2 <= n; i += 2) {
+    __m128i both = _mm_and_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)),
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+    if (0xffff != _mm_movemask_epi8(_mm_cmpeq_epi8(both, zero))) {
+      return true;
+    }
+  }
+#endif
+  for (; i < n; ++i) {
+    if (a[i] & b[i]) return true;
+  }
+  return false;
+}
+
+bool ObjectSet::empty() const {
+  for (word_vec::const_iterator i = m_words.begin(); i != m_words.end(); ++i) {
+    if (*i) return false;
+  }
+  return true;
+}
+
+string ObjectSet::print() const {
+  string r = "{";
+  bool first = true;
+  for (size_t w = 0; w < m_words.size(); ++w) {
+    for (unsigned int b = 0; b < WORD_BITS; ++b) {
+      if (m_words[w] & ((word)1 << b)) {
+        if (!first) r += ",";
+        r += boost::lexical_cast<string>(w * WORD_BITS + b);
+        first = false;
+      }
+    }
+  }
+  return r + "}";
+}
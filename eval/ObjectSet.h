@@ -0,0 +1,52 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _ObjectSet_h_
+#define _ObjectSet_h_
+
+/* Set of Objects, as a bitset over their dense ids
+ *
+ * Used by the bitset Type backend, where a normalized Type is a handful of
+ * these.  Every live Object has a small dense id (see Object::id()), so a
+ * set over even a few hundred stdlib objects is only a few machine words, and
+ * the operations the Type backend needs -- union, and testing whether two
+ * sets intersect -- run a word (or, with SSE2, two words) at a time.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class ObjectSet {
+public:
+  typedef uint32_t object_id;
+
+  // Dense ids for Objects.  Ids are recycled once released, which keeps sets
+  // narrow; this is safe because an Object outlives every Type that refers
+  // to it.
+  static object_id AllocateId();
+  static void ReleaseId(object_id id);
+
+  void insert(object_id id);
+  bool contains(object_id id) const;
+  // Union rhs into this set
+  void merge(const ObjectSet& rhs);
+  // Do the two sets have any member in common?
+  bool intersects(const ObjectSet& rhs) const;
+  bool empty() const;
+
+  std::string print() const;
+
+private:
+  typedef uint64_t word;
+  static const unsigned int WORD_BITS = 64;
+  typedef std::vector<word> word_vec;
+
+  word_vec m_words;
+};
+
+};
+
+#endif // _ObjectSet_h_
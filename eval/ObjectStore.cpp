@@ -9,7 +9,6 @@
 
 #include <memory>
 #include <string>
-using std::auto_ptr;
 using std::string;
 
 using namespace eval;
@@ -18,79 +17,177 @@ ObjectStore::~ObjectStore() {
   reset();
 }
 
-// Clears all objects from the store
+// Clears all objects from the store.  The slots are kept, with their
+// generations, so that no earlier address can refer to a later object.
 void ObjectStore::reset() {
-  for (object_iter i = m_objects.begin(); i != m_objects.end(); ++i) {
-    delete i->second;
+  for (size_t slot = 0; slot < m_slots.size(); ++slot) {
+    if (m_slots[slot].object) freeSlot(slot);
   }
   m_objects.clear();
   m_pending.clear();
+  m_undoBase += m_undo.size();
+  m_undo.clear();
 }
 
 // Commit (confirm) a pending object into the store
 void ObjectStore::commit(const string& varname) {
-  if (m_pending.end() == m_pending.find(varname)) {
+  symbol_id symbol;
+  if (!Symbol::Find(varname, symbol)) {
     throw EvalError("Cannot commit " + varname + "; object missing");
   }
-  m_log.debug("Committing " + varname);
-  m_pending.erase(varname);
+  commit(symbol);
+}
+
+void ObjectStore::commit(symbol_id varname) {
+  if (!m_pending.find(varname)) {
+    throw EvalError("Cannot commit " + Symbol::Name(varname) + "; object missing");
+  }
+  if (m_log.isDebug()) {
+    m_log.debug("Committing " + Symbol::Name(varname));
+  }
+  retire(varname);
 }
 
 // Commit all pending-commit objects
 void ObjectStore::commitAll() {
   m_log.debug("Committing all variables");
-  for (object_iter i = m_pending.begin(); i != m_pending.end(); ++i) {
-    commit(i->first);
-  }
+  m_pending.clear();
+  m_undoBase += m_undo.size();
+  m_undo.clear();
 }
 
 // Revert a pending-commit object
 void ObjectStore::revert(const string& varname) {
-  object_iter o = m_objects.find(varname);
-  object_iter p = m_pending.find(varname);
-  if (m_objects.end() == o || m_pending.end() == p) {
+  symbol_id symbol;
+  if (!Symbol::Find(varname, symbol)) {
     throw EvalError("Cannot revert " + varname + "; object missing");
   }
-  m_log.info("Reverting " + varname);
-  delete o->second;
-  m_objects.erase(varname);
-  m_pending.erase(varname);
+  revert(symbol);
+}
+
+void ObjectStore::revert(symbol_id varname) {
+  if (!m_objects.find(varname) || !m_pending.find(varname)) {
+    throw EvalError("Cannot revert " + Symbol::Name(varname) + "; object missing");
+  }
+  m_log.info("Reverting " + Symbol::Name(varname));
+  retire(varname);
+  erase(varname);
 }
 
 // Revert all pending-commit objects
 void ObjectStore::revertAll() {
   m_log.info("Reverting all variables");
-  for (object_iter i = m_pending.begin(); i != m_pending.end(); ++i) {
-    revert(i->first);
+  rollback(0);
+}
+
+// Walk the log backwards to the savepoint, reverting what is still pending
+void ObjectStore::rollback(Savepoint savepoint) {
+  while (!m_undo.empty() && m_undoBase + m_undo.size() > savepoint) {
+    Change change = m_undo.back();
+    m_undo.pop_back();
+    if (!change.done) {
+      m_log.info("Reverting " + Symbol::Name(change.varname));
+      m_pending.erase(change.varname);
+      erase(change.varname);
+    }
   }
 }
 
+bool ObjectStore::isPending(const string& varname) const {
+  symbol_id symbol;
+  return Symbol::Find(varname, symbol) && m_pending.find(symbol);
+}
+
 Object* ObjectStore::getObject(const string& varname) const {
-  object_iter o = m_objects.find(varname);
-  if (o != m_objects.end()) return o->second;
-  return NULL;
+  symbol_id symbol;
+  if (!Symbol::Find(varname, symbol)) return NULL;
+  return getObject(symbol);
+}
+
+Object* ObjectStore::getObject(symbol_id varname) const {
+  const size_t* slot = m_objects.find(varname);
+  return slot ? m_slots[*slot].object : NULL;
 }
 
-Object& ObjectStore::newObject(const string& varname, auto_ptr<Type> type) {
+bool ObjectStore::findSlot(symbol_id varname, size_t& slot,
+                           Generation& generation) const {
+  const size_t* found = m_objects.find(varname);
+  if (!found) return false;
+  slot = *found;
+  generation = m_slots[slot].generation;
+  return true;
+}
+
+Object& ObjectStore::newObject(const string& varname, TypeRef type) {
+  return addObject(varname, new Object(m_log, varname, type));
+}
+
+Object& ObjectStore::addObject(const string& varname, Object* object) {
+  symbol_id symbol = Symbol::Intern(varname);
   // An object name collision should have already been detected, but repeat
   // this now until we're confident about that
-  if (getObject(varname)) {
+  object->retain();
+  if (getObject(symbol)) {
+    // Frees a new object that nobody else holds
+    object->release();
     throw EvalError("Cannot create variable " + varname + "; already exists, and should never have been created");
   }
   m_log.info("Adding (pending) object " + varname + " to an object store");
-  object_pair op(varname, new Object(m_log, varname, type));
-  m_objects.insert(op);
-  m_pending.insert(op);
-  return *(op.second);
+  size_t slot;
+  if (m_freeSlots.empty()) {
+    slot = m_slots.size();
+    m_slots.push_back(Slot());
+  } else {
+    slot = m_freeSlots.back();
+    m_freeSlots.pop_back();
+  }
+  m_slots[slot].object = object;
+  m_objects.insert(symbol, slot);
+  m_pending.insert(symbol, m_undo.size());
+  m_undo.push_back(Change(symbol));
+  return *object;
 }
 
 void ObjectStore::delObject(const string& varname) {
   m_log.info("Deleting object " + varname);
-  object_iter o = m_objects.find(varname);
-  if (m_objects.end() == o) {
+  symbol_id symbol;
+  if (!Symbol::Find(varname, symbol) || !m_objects.find(symbol)) {
     throw EvalError("Cannot delete variable " + varname + "; does not exist in this store");
   }
-  delete o->second;
+  if (m_pending.find(symbol)) {
+    retire(symbol);
+  }
+  erase(symbol);
+}
+
+/* private */
+
+void ObjectStore::erase(symbol_id varname) {
+  size_t* slot = m_objects.find(varname);
+  if (!slot) {
+    throw EvalError("Cannot erase " + Symbol::Name(varname) + "; object missing");
+  }
+  freeSlot(*slot);
   m_objects.erase(varname);
-  m_pending.erase(varname);   // if it's there
+}
+
+void ObjectStore::freeSlot(size_t slot) {
+  // The Object itself lives on while a Type still refers to it
+  m_slots[slot].object->release();
+  m_slots[slot].object = NULL;
+  ++m_slots[slot].generation;
+  m_freeSlots.push_back(slot);
+}
+
+void ObjectStore::retire(symbol_id varname) {
+  size_t* change = m_pending.find(varname);
+  if (!change) {
+    throw EvalError("Cannot retire " + Symbol::Name(varname) + "; not pending");
+  }
+  m_undo.at(*change).done = true;
+  m_pending.erase(varname);
+  if (m_pending.empty()) {
+    m_undoBase += m_undo.size();
+    m_undo.clear();
+  }
 }
@@ -10,53 +10,127 @@
  * Object members!  The ObjectStore just has a list of Objects that it owns,
  * and has commit/revert logic on new additions.  Scope and Object each have an
  * ObjectStore internally backing their members.
+ *
+ * Objects are keyed by their interned name (see Symbol), in a SymbolMap.  The
+ * string-named methods intern or look up the name and defer to the symbol_id
+ * ones, which callers that already have a symbol can use directly.
+ *
+ * Each object is also given a slot: an index into the store's slot array that
+ * stays the same for as long as the object exists.  Scope uses slots for
+ * lexical addressing.  A deleted or reverted object's slot goes on a free list
+ * and is reused by the next new object, so the array only grows as far as
+ * the most objects the store has held at once.  Each slot counts the objects
+ * it has held (its generation), so that a slot and generation found earlier
+ * refers to no object, rather than to whichever one has since taken the slot.
+ *
+ * Pending objects are recorded in an append-only undo log.  A savepoint is
+ * just a position in that log, so rolling back to one costs only the changes
+ * made since, and savepoints nest for free.  Committing marks a change as
+ * permanent; once nothing is pending the log is dropped, so committing a
+ * whole statement is O(1).  Positions count every change ever logged, so a
+ * savepoint stays meaningful after the log is dropped.
  */
 
 #include "Log.h"
 #include "Object.h"
+#include "Symbol.h"
+#include "SymbolMap.h"
 #include "Type.h"
 
-#include <map>
 #include <memory>
+#include <stdint.h>
 #include <string>
-#include <utility>
+#include <vector>
 
 namespace eval {
 
 class Object;
 class Type;
+class TypeRef;
 
 class ObjectStore {
 public:
+  typedef uint64_t Savepoint;
+  typedef uint32_t Generation;
+
   ObjectStore(Log& log)
-    : m_log(log) {}
+    : m_log(log),
+      m_undoBase(0) {}
   ~ObjectStore();
 
   void reset();
   void commit(const std::string& varname);
+  void commit(symbol_id varname);
   void commitAll();
   void revert(const std::string& varname);
+  void revert(symbol_id varname);
   void revertAll();
+  // Position in the undo log to which we can later rollback()
+  Savepoint savepoint() const { return m_undoBase + m_undo.size(); }
+  // Revert every object made pending since the savepoint
+  void rollback(Savepoint savepoint);
+  bool isPending(const std::string& varname) const;
 
   // Lookup an object, returning NULL if it is not here.
   Object* getObject(const std::string& varname) const;
+  Object* getObject(symbol_id varname) const;
+  // Slot of an object and its generation, for lexical addressing; false if
+  // it is not here
+  bool findSlot(symbol_id varname, size_t& slot, Generation& generation) const;
+  // Object in a slot, or NULL if the slot is empty or has been reused since
+  // the generation
+  Object* getSlot(size_t slot, Generation generation) const {
+    if (slot >= m_slots.size() || generation != m_slots[slot].generation) {
+      return NULL;
+    }
+    return m_slots[slot].object;
+  }
   // Construct a new object, as "pending" until it's either commit or revert
-  Object& newObject(const std::string& varname, std::auto_ptr<Type> type);
+  Object& newObject(const std::string& varname, TypeRef type);
+  // Add an already-constructed object (e.g. a Function) the same way.  We
+  // hold a reference to it.
+  Object& addObject(const std::string& varname, Object* object);
   void delObject(const std::string& varname);
 
   size_t size() const { return m_objects.size(); }
   size_t pendingSize() const { return m_pending.size(); }
 
 private:
-  typedef std::map<std::string,Object*> object_map;
-  typedef std::pair<std::string,Object*> object_pair;
-  typedef object_map::const_iterator object_iter;
-  typedef object_map::iterator object_mod_iter;
- 
+  typedef SymbolMap<size_t> slot_map;
+  struct Slot {
+    Slot()
+      : object(NULL), generation(0) {}
+    Object* object;
+    Generation generation;
+  };
+  typedef std::vector<Slot> slot_vec;
+
+  // An object was added; done once committed or reverted
+  struct Change {
+    Change(symbol_id varname)
+      : varname(varname), done(false) {}
+    symbol_id varname;
+    bool done;
+  };
+  typedef std::vector<Change> undo_log;
+
+  // Remove an object from the store entirely
+  void erase(symbol_id varname);
+  // Empty a slot, and free it for reuse
+  void freeSlot(size_t slot);
+  // Retire a pending object's change; drops the log if nothing is pending
+  void retire(symbol_id varname);
+
   Log& m_log;
-  object_map m_objects;
-  // Objects that are part of a not-yet-applied (not-yet-evaluated) changeset
-  object_map m_pending;
+  // Slot of each object, and the objects themselves by slot
+  slot_map m_objects;
+  slot_vec m_slots;
+  std::vector<size_t> m_freeSlots;
+  // Objects that are part of a not-yet-applied (not-yet-evaluated) changeset,
+  // with the index of their Change in m_undo
+  slot_map m_pending;
+  undo_log m_undo;
+  Savepoint m_undoBase;   // changes logged before m_undo[0]
 };
 
 };
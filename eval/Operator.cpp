@@ -3,10 +3,13 @@
 
 #include "Operator.h"
 
+#include "Activation.h"
+#include "Arithmetic.h"
 #include "EvalError.h"
 #include "Function.h"
 
 #include <boost/lexical_cast.hpp>
+#include <boost/unordered_map.hpp>
 
 #include <memory>
 #include <string>
@@ -16,58 +19,99 @@ using std::string;
 
 using namespace eval;
 
+namespace {
+  // ~ joins the text of its operands: a str as it is, anything else printed
+  void appendText(Rope& text, const Value& value) {
+    if (Value::KIND_STR == value.kind()) {
+      text += value.getText();
+    } else {
+      text += value.print();
+    }
+  }
+
+  void concat(const Value& left, const Value& right, Value& out) {
+    Rope text;
+    appendText(text, left);
+    appendText(text, right);
+    out = Value::Str(text);
+  }
+};
+
 /* statics */
 
-Operator::op_precedence Operator::Precedence(ARITY arity) {
-  if (UNKNOWN_ARITY == arity) {
-    throw EvalError("Cannot check unknown-arity precedence of " + print());
+const Operator::op_priority Operator::NO_PRIORITY;
+
+// Priorities: higher binds tighter.  Only ^ is right-associative.
+const Operator::Info Operator::Table[KIND_COUNT] = {
+  // token          prefix        infix         assoc        method
+  { "DOT",          NO_PRIORITY,  1,            LEFT_ASSOC,  NULL },
+  { "OR",           NO_PRIORITY,  2,            LEFT_ASSOC,  NULL },
+  { "NOR",          NO_PRIORITY,  2,            LEFT_ASSOC,  NULL },
+  { "XOR",          NO_PRIORITY,  2,            LEFT_ASSOC,  NULL },
+  { "XNOR",         NO_PRIORITY,  2,            LEFT_ASSOC,  NULL },
+  { "AND",          NO_PRIORITY,  3,            LEFT_ASSOC,  NULL },
+  { "EQ",           NO_PRIORITY,  4,            LEFT_ASSOC,  "operator==" },
+  { "NE",           NO_PRIORITY,  4,            LEFT_ASSOC,  "operator!=" },
+  { "LT",           NO_PRIORITY,  5,            LEFT_ASSOC,  "operator<" },
+  { "LE",           NO_PRIORITY,  5,            LEFT_ASSOC,  "operator<=" },
+  { "GT",           NO_PRIORITY,  5,            LEFT_ASSOC,  "operator>" },
+  { "GE",           NO_PRIORITY,  5,            LEFT_ASSOC,  "operator>=" },
+  { "USEROP",       NO_PRIORITY,  6,            LEFT_ASSOC,  NULL },
+  { "TILDE",        NO_PRIORITY,  7,            LEFT_ASSOC,  NULL },
+  { "DOUBLETILDE",  NO_PRIORITY,  7,            LEFT_ASSOC,  NULL },
+  { "PLUS",         12,           8,            LEFT_ASSOC,  "operator+" },
+  { "MINUS",        12,           8,            LEFT_ASSOC,  "operator-" },
+  { "STAR",         NO_PRIORITY,  9,            LEFT_ASSOC,  "operator*" },
+  { "SLASH",        NO_PRIORITY,  9,            LEFT_ASSOC,  "operator/" },
+  { "PERCENT",      NO_PRIORITY,  9,            LEFT_ASSOC,  "operator%" },
+  { "CARAT",        NO_PRIORITY,  10,           RIGHT_ASSOC, "operator^" },
+  { "NOT",          11,           NO_PRIORITY,  LEFT_ASSOC,  NULL },
+  { "PIPE",         NO_PRIORITY,  13,           LEFT_ASSOC,  NULL },
+  { "AMP",          NO_PRIORITY,  14,           LEFT_ASSOC,  NULL },
+  { "paren",        NO_PRIORITY,  15,           LEFT_ASSOC,  NULL },
+};
+
+bool Operator::Kind(const string& token, KIND& kind) {
+  typedef boost::unordered_map<string, KIND> kind_map;
+  static kind_map kinds;
+  if (kinds.empty()) {
+    for (int i = 0; i < KIND_COUNT; ++i) {
+      kinds[Table[i].token] = (KIND)i;
+    }
   }
+  kind_map::const_iterator k = kinds.find(token);
+  if (kinds.end() == k) {
+    return false;
+  }
+  kind = k->second;
+  return true;
+}
+
+/* public */
+
+Operator::op_precedence Operator::precedence(ARITY arity) const {
   op_precedence prec;
-  prec.priority = NO_PRIORITY;
-  prec.assoc = LEFT_ASSOC;
-  //if ("COMMA_AND" == name)
-  //  return 0;
-  if ("DOT" == name)
-    prec.priority = 1;
-  if ("OR" == name || "NOR" == name || "XOR" == name || "XNOR" == name)
-    prec.priority = 2;
-  if ("AND" == name)
-    prec.priority = 3;
-  if ("EQ" == name || "NE" == name)
-    prec.priority = 4;
-  if ("LT" == name || "LE" == name || "GT" == name || "GE" == name)
-    prec.priority = 5;
-  if ("USEROP" == name)
-    prec.priority = 6;
-  if ("TILDE" == name || "DOUBLETILDE" == name)
-    prec.priority = 7;
-  if ((INFIX == arity) && ("PLUS" == name || "MINUS" == name))
-    prec.priority = 8;
-  if ("STAR" == name || "SLASH" == name || "PERCENT" == name)
-    prec.priority = 9;
-  if ("CARAT" == name)
-    prec.priority = 10;
-    prec.assoc = RIGHT_ASSOC;
-  if ("NOT" == name)
-    prec.priority = 11;
-  if ((PREFIX == arity) && ("PLUS" == name || "MINUS" == name))
-    prec.priority = 12;
-  if ("PIPE" == name)
-    prec.priority = 13;
-  if ("AMP" == name)
-    prec.priority = 14;
-  if ("paren" == name)
-    prec.priority = 15;
+  switch (arity) {
+    case PREFIX:
+      prec.priority = Table[m_kind].prefix;
+      prec.assoc = LEFT_ASSOC;
+      break;
+    case INFIX:
+      prec.priority = Table[m_kind].infix;
+      prec.assoc = Table[m_kind].assoc;
+      break;
+    default:
+      throw EvalError("Cannot check unknown-arity precedence of " + print());
+  }
   if (NO_PRIORITY == prec.priority) {
-    throw EvalError("Failed to set Operator priority for " + print());
+    throw EvalError("Operator " + print() + " cannot have this arity");
   }
   return prec;
 }
 
-/* public */
-
 // OperatorParser will call this after each child has been setup with
-// setupLeft() and/or setupRight().
+// setupLeft() and/or setupRight().  Now that we have all our operands, we
+// can find our type.
 void Operator::setup() {
   switch (m_arity) {
     case PREFIX:
@@ -80,17 +124,12 @@ void Operator::setup() {
         throw EvalError("Infix Operator " + print() + " must have 2 children");
       }
       break;
-    default: throw EvalError("Cannot setup " + print() " + with unknown arity");
+    default: throw EvalError("Cannot setup " + print() + " with unknown arity");
   }
-}
-
-bool Operator::couldBePrefix() const {
-  if ("PLUS" == name || "MINUS" == name) return true;
-  return false;
-}
-
-bool Operator::couldBeInfix() const {
-  return true;
+  if (!m_left || (INFIX == m_arity && !m_right)) {
+    throw EvalError("Operator " + print() + " is missing an operand");
+  }
+  computeType();
 }
 
 void Operator::setPrefix() {
@@ -118,10 +157,12 @@ bool Operator::isInfix() const {
 void Operator::setupLeft() {
   if (ARITY_UNKNOWN == m_arity) {
     throw EvalError("Cannot call setupLeft() on unknown-arity " + print());
+  } else if (children.size() != 1) {
+    throw EvalError("setupLeft() on " + print() + " needs exactly one child");
   }
-  // ...
-  if (INFIX != m_arity) {
-    computeType();
+  m_left = dynamic_cast<TypedNode*>(children.at(0));
+  if (!m_left) {
+    throw EvalError("Operand of " + print() + " must have a type");
   }
 }
 
@@ -130,9 +171,13 @@ void Operator::setupRight() {
     throw EvalError("Cannot call setupRight() on unknown-arity " + print());
   } else if (m_arity != INFIX) {
     throw EvalError("Cannot call setupRight() on non-infix " + print());
+  } else if (children.size() != 2) {
+    throw EvalError("setupRight() on " + print() + " needs exactly two children");
+  }
+  m_right = dynamic_cast<TypedNode*>(children.at(1));
+  if (!m_right) {
+    throw EvalError("Right-hand side of " + print() + " must have a type");
   }
-  // ...
-  computeType();
 }
 
 void Operator::evaluate() {
@@ -140,47 +185,42 @@ void Operator::evaluate() {
   if (!isSetup || (ARITY_UNKNOWN == m_arity)) {
     throw EvalError("Cannot evaluate operator '" + name + "' which has not been setup");
   }
-  throw EvalError("Operator '" + name + "' not yet supported for evaluation");
+  if (!m_kernel) {
+    throw EvalError("Operator '" + name + "' not yet supported for evaluation");
+  }
+  m_kernel(m_left->getValue(), m_right ? m_right->getValue() : m_left->getValue(), m_value);
 }
 
 string Operator::methodName() const {
-  if ("EQ" == name)
-    return "operator==";
-  if ("NE" == name)
-    return "operator!=";
-  if ("LT" == name)
-    return "operator<";
-  if ("LE" == name)
-    return "operator<=";
-  if ("GT" == name)
-    return "operator>";
-  if ("GE" == name)
-    return "operator>=";
-  if ("USEROP" == name)
+  if (KIND_USEROP == m_kind) {
     return "operator`" + value + "`";
-  if ("PLUS" == name)
-    return "operator+";
-  if ("MINUS" == name)
-    return "operator-";
-  if ("STAR" == name)
-    return "operator*";
-  if ("SLASH" == name)
-    return "operator/";
-  if ("PERCENT" == name)
-    return "operator%";
-  if ("CARAT" == name)
-    return "operator^";
-  return "";
+  }
+  return Table[m_kind].method ? Table[m_kind].method : "";
 }
 
 
 /* private */
 
+void Operator::saveResult(Activation& activation) const {
+  activation.saveValue(m_value);
+}
+
+void Operator::restoreResult(Activation& activation) {
+  m_value = activation.restoreValue();
+}
+
+void Operator::EvaluateKernel(Node* node) {
+  Operator* op = static_cast<Operator*>(node);
+  const Value& left = op->m_left->getValue();
+  op->m_kernel(left, op->m_right ? op->m_right->getValue() : left,
+               op->m_value);
+}
+
 // This is responsible for setting m_type.  This is ok to be an OrType of the
 // possible return types of the overloads of the method that will be called.
 void Operator::computeType() {
-  if (!isSetup || (ARITY_UNKNOWN == m_arity)) {
-    throw EvalError("Cannot compute type of Operator " + print() + " before it is setup and validated");
+  if (ARITY_UNKNOWN == m_arity) {
+    throw EvalError("Cannot compute type of Operator " + print() + " before its arity is known");
   }
 
   // For overloadable operators, see if the operand has implemented a method
@@ -190,28 +230,32 @@ void Operator::computeType() {
   // implement all operator logic right here.
   // Note that some operators require specific types of their operands, or
   // other special evaluations (e.g. ~ performs a ->str on its operands).
-  if ("PIPE" == name) {
-    if (!isBinary) {
+  if (KIND_PIPE == m_kind) {
+    if (!isInfix()) {
       throw EvalError("| must be a binary operator");
     }
-    m_type.reset(new OrType(*m_left->getType(), *m_right->getType()));
-  } else if ("AMP" == name) {
-    if (!isBinary) {
+    m_type = OrType::Get(m_left->getType(), m_right->getType());
+  } else if (KIND_AMP == m_kind) {
+    if (!isInfix()) {
       throw EvalError("& must be a binary operator");
     }
-    m_type.reset(new AndType(*m_left->getType(), *m_right->getType()));
-  } else if ("TILDE" == name || "DOUBLETILDE" == name) {
-    if (!isBinary) {
-      throw EvalError("| must be a binary operator");
+    m_type = AndType::Get(m_left->getType(), m_right->getType());
+  } else if (KIND_TILDE == m_kind || KIND_DOUBLETILDE == m_kind) {
+    if (!isInfix()) {
+      throw EvalError("~ and ~~ must be binary operators");
     }
     // TODO: get this directly from the global scope
     const Object* str = parentScope->getObject("str");
     if (!str) {
       throw EvalError("Cannot use ~ or ~~ operator until str is defined");
     }
-    m_type.reset(new BasicType(*str));
+    m_type = BasicType::Get(*str);
+    if (KIND_TILDE == m_kind) {
+      m_kernel = concat;
+    }
     // TODO more custom ~ and ~~ logic goes here or above
-    throw EvalError("~ and ~~ operators are not yet implemented");
+  } else if (computeNumericType()) {
+    // stdlib number arithmetic does not go through an operator method
   } else {
     // Lookup the operator as a member of our first (or only) child's type.  If
     // it's there (and in the binary case, if it accepts the second child's
@@ -230,25 +274,27 @@ void Operator::computeType() {
       throw EvalError("Somehow, " + method_name + " is a non-function member of " + m_left->print());
     }
 
-    if (isUnary) {
+    if (isPrefix()) {
       type_list args; // Leave empty (no args)
-      if (!method->takesArgs(args)) {
+      const Signature* signature = method->getSignature(args);
+      if (!signature) {
         throw EvalError(m_left->print() + "." + method_name + " is not defined to take 0 arguments");
       }
-      m_type = method->getPossibleReturnTypes(args);
+      m_type = signature->getReturnType();
       if (!m_type.get()) {
         throw EvalError(m_left->print() + "." + method_name + " somehow has no return type");
       }
-    } else if (isBinary) {
+    } else if (isInfix()) {
       if (!m_right) {
         throw EvalError("Right-hand side of binary " + name + " operator must have a type");
       }
       type_list args;
       args.push_back(&m_right->type());
-      if (!method->takesArgs(args)) {
+      const Signature* signature = method->getSignature(args);
+      if (!signature) {
         throw EvalError(m_left->print() + "." + method_name + " is not defined to take right-hand side " + m_right->print() + " of type " + args.at(0)->print());
       }
-      m_type = method->getPossibleReturnTypes(args);
+      m_type = signature->getReturnType();
       if (!m_type.get()) {
         throw EvalError(m_left->print() + "." + method_name + " with argument " + m_right->print() + " somehow has no return type");
       }
@@ -257,3 +303,52 @@ void Operator::computeType() {
     }
   }
 }
+
+// Arithmetic between stdlib numbers is built in, rather than looked up as an
+// operator method on the left operand.  int-op-int is an int; if either
+// operand is a fixed, so is the result.  A fixed may only be raised to an
+// int power.  Picks the kernel that evaluate() will run.
+bool Operator::computeNumericType() {
+  switch (m_kind) {
+    case KIND_PLUS: case KIND_MINUS: case KIND_STAR:
+    case KIND_SLASH: case KIND_PERCENT: case KIND_CARAT:
+      break;
+    default:
+      return false;
+  }
+  // TODO: get these directly from the global scope
+  const Object* intObject = parentScope->getObject("int");
+  const Object* fixedObject = parentScope->getObject("fixed");
+  if (!intObject || !fixedObject) {
+    return false;
+  }
+  TypeRef intType(BasicType::Get(*intObject));
+  TypeRef fixedType(BasicType::Get(*fixedObject));
+  bool isFixed = false;
+  for (child_iter i = children.begin(); i != children.end(); ++i) {
+    TypedNode* operand = dynamic_cast<TypedNode*>(*i);
+    if (!operand) {
+      return false;
+    }
+    if (fixedType->isCompatible(operand->type())) {
+      if (KIND_CARAT == m_kind && operand == m_right) {
+        return false;
+      }
+      isFixed = true;
+    } else if (!intType->isCompatible(operand->type())) {
+      return false;
+    }
+  }
+  m_kernel = Arithmetic::Select(m_kind, m_arity, isFixed);
+  if (!m_kernel) {
+    return false;
+  }
+  m_type = isFixed ? fixedType : intType;
+  return true;
+}
+
+void Operator::replaceOperand(TypedNode* oldOperand, TypedNode* newOperand) {
+  replaceChild(oldOperand, newOperand);
+  if (m_left == oldOperand) m_left = newOperand;
+  if (m_right == oldOperand) m_right = newOperand;
+}
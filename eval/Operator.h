@@ -6,13 +6,17 @@
 
 /* Operators
  *
- * Expression trees are given to us by the parser in a wonky ordering.
- * Consequently at setup() time, we won't have any children.
- * Expression::setup() rearranges us into an Operator tree, then will call
- * analyzeTree() at the root, which will do a top-down reordering of the
- * operators (for operator precedence) followed by a top-down validate() step
- * where all our "real" setup()-type static analysis (read: error checking)
- * will happen.
+ * Expression trees are given to us by the parser in a wonky (flattened)
+ * ordering.  The OperatorParser of the enclosing Expression or TypeSpec
+ * arranges us into a tree as we arrive, for operator precedence, binding our
+ * operands with setupLeft() and setupRight().  Once we have them all, our
+ * setup() does the real static analysis (read: error checking) and works out
+ * our type.
+ *
+ * MakeNode() resolves an operator token to its KIND once, with a hash lookup,
+ * and hands it to the constructor.  From then on the Operator's precedence,
+ * associativity and overload method come from a static table indexed by KIND
+ * and arity, with no string compares.
  *
  * We should split off some of the specific Operators into subclasses of this.
  * But for now it's all here until we're sure of the interface and
@@ -31,22 +35,52 @@
 
 namespace eval {
 
+class Optimizer;
 class OperatorParser;
 
 class Operator : public TypedNode {
 public:
+  friend class Optimizer;
   friend class OperatorParser;
 
-  static op_precedence Precedence(ARITY arity);
-
   enum ARITY {
     ARITY_UNKNOWN,
     PREFIX,
     INFIX,
   };
 
+  // Operator tokens, in the same order as the Info table
+  enum KIND {
+    KIND_DOT,
+    KIND_OR,
+    KIND_NOR,
+    KIND_XOR,
+    KIND_XNOR,
+    KIND_AND,
+    KIND_EQ,
+    KIND_NE,
+    KIND_LT,
+    KIND_LE,
+    KIND_GT,
+    KIND_GE,
+    KIND_USEROP,
+    KIND_TILDE,
+    KIND_DOUBLETILDE,
+    KIND_PLUS,
+    KIND_MINUS,
+    KIND_STAR,
+    KIND_SLASH,
+    KIND_PERCENT,
+    KIND_CARAT,
+    KIND_NOT,
+    KIND_PIPE,
+    KIND_AMP,
+    KIND_PAREN,
+    KIND_COUNT,
+  };
+
   typedef int op_priority;
-  static const NO_PRIORITY = -1;
+  static const op_priority NO_PRIORITY = -1;
   enum ASSOC {
     LEFT_ASSOC = 0,
     RIGHT_ASSOC = 1,
@@ -56,18 +90,35 @@ public:
     ASSOC assoc;
   } op_precedence;
 
-  Operator(Log& log, RootNode*const root, const Token& token)
+  // Everything the parser and analysis need about an operator token.  A
+  // priority of NO_PRIORITY means the operator cannot have that arity.
+  struct Info {
+    const char* token;
+    op_priority prefix;
+    op_priority infix;
+    ASSOC assoc;          // of the infix form
+    const char* method;   // overload method name, or NULL
+  };
+
+  // Returns the KIND of an operator token name via kind, or false if the
+  // name is not an operator
+  static bool Kind(const std::string& token, KIND& kind);
+
+  Operator(Log& log, RootNode*const root, const Token& token, KIND kind)
     : TypedNode(log, root, token),
-      isOrderSet(false),
-      isValidated(false),
+      m_kind(kind),
       m_arity(ARITY_UNKNOWN),
       m_left(NULL),
-      m_right(NULL) {}
+      m_right(NULL),
+      m_kernel(NULL) {}
+
+  KIND kind() const { return m_kind; }
+  op_precedence precedence(ARITY arity) const;
 
   virtual void setup();
 
-  bool couldBePrefix() const;
-  bool couldBeInfix() const;
+  bool couldBePrefix() const { return NO_PRIORITY != Table[m_kind].prefix; }
+  bool couldBeInfix() const { return NO_PRIORITY != Table[m_kind].infix; }
   void setPrefix();
   void setInfix();
   bool isPrefix() const;
@@ -77,22 +128,47 @@ public:
   void setupRight();
 
   virtual void evaluate();
+  // Built-in arithmetic skips evaluate() and its checks, which setup has
+  // already made, and runs its kernel directly
+  virtual evaluator_fn evaluator() const {
+    return m_kernel ? &EvaluateKernel : &EvaluateDirect<Operator>;
+  }
+  // The result of built-in arithmetic, once evaluated
+  virtual const Value& getValue() const { return m_value; }
 
   // Returns the internal method name for this operator, e.g. operator+
   // Returns "" if the operator is not overloadable
   std::string methodName() const;
 
 protected:
+  const KIND m_kind;
   ARITY m_arity;    // set by setPrefix() or setInfix()
 
 private:
+  // Indexed by KIND; built at compile time
+  static const Info Table[KIND_COUNT];
+
   // from TypedNode
   virtual void computeType();
+  // from Node: our result, which a re-entered function body sets aside
+  virtual void saveResult(Activation& activation) const;
+  virtual void restoreResult(Activation& activation);
+  // Built-in arithmetic on stdlib numbers; returns false if not applicable.
+  // Picks m_kernel.
+  bool computeNumericType();
+  static void EvaluateKernel(Node* node);
+  // Swap an operand for a replacement node (e.g. a folded constant)
+  void replaceOperand(TypedNode* oldOperand, TypedNode* newOperand);
 
   // Pointers into children; set by OperatorParser before setup().  These
   // should never be freed.
   TypedNode* m_left;
   TypedNode* m_right;
+
+  // Built-in arithmetic kernel chosen at analysis (an Arithmetic::kernel_fn),
+  // and its result
+  void (*m_kernel)(const Value&, const Value&, Value&);
+  Value m_value;
 };
 
 };
@@ -11,6 +11,7 @@
 #include <utility>
 #include <vector>
 using std::make_pair;
+using std::pair;
 using std::string;
 using std::vector;
 
@@ -18,6 +19,13 @@ using namespace eval;
 
 /* public */
 
+// Anything left on the stack was never made part of a tree
+OperatorParser::~OperatorParser() {
+  for (size_t i = 0; i < m_stack.size(); ++i) {
+    delete m_stack[i].first;
+  }
+}
+
 // Pratt (TDOP: Top-Down Operator Precedence) parser, accepting nodes
 // one-at-a-time and manipulating an explicit stack.
 void OperatorParser::insertNode(Node* node) {
@@ -29,7 +37,7 @@ void OperatorParser::insertNode(Node* node) {
     pair<Node*,Operator::op_priority> top = m_stack.back();   // peek, don't pop
     stackTop = top.first;
     if (!stackTop) {
-      throw EvalError("Found deficient stack top while parsing " + print());
+      throw EvalError("Found deficient stack top while parsing operators");
     }
     topPriority = top.second;
   }
@@ -37,26 +45,26 @@ void OperatorParser::insertNode(Node* node) {
 
   // If we're looking for an infix operator, and that's what we've found
   if (m_infixing && op && op->couldBeInfix()) {
-    Operator::op_precedence opPrecedence = op->Precedence(Operator::INFIX);
+    Operator::op_precedence opPrecedence = op->precedence(Operator::INFIX);
     op->setInfix();
 
     // Top of stack is a free non-operator.  Everything above it is an operator.
     if (stackOp || !stackTop || topPriority != Operator::NO_PRIORITY) {
-      throw EvalError(print() + " beginning infix parse, yet top of stack is an operator");
+      throw EvalError("Beginning infix parse of " + op->print() + ", yet top of stack is an operator");
     }
     Node* tmp = stackTop;
-    m_stack.pop();
+    m_stack.pop_back();
     // Fight over tmp against any higher-priority operators up the stack
     while (!m_stack.empty()) {
       pair<Node*,Operator::op_priority> top = m_stack.back(); // peek, don't pop
       stackTop = top.first;
       if (!stackTop) {
-        throw EvalError("Found deficient stack top while parsing " + print());
+        throw EvalError("Found deficient stack top while parsing operators");
       }
       topPriority = top.second;
       stackOp = dynamic_cast<Operator*>(stackTop);
       if (!stackOp || Operator::NO_PRIORITY == topPriority) {
-`       throw EvalError("ab");
+        throw EvalError("Found a non-operator beneath the top of the operator stack");
       }
       if (opPrecedence.priority > topPriority) break;
       // stackOp consumes tmp, then becomes tmp, and we bubble up the stack.
@@ -69,9 +77,9 @@ void OperatorParser::insertNode(Node* node) {
       } else {
         throw EvalError("bad arity");
       }
-      stackOp->setup();
+      stackOp->setupNode();
       tmp = stackOp;
-      m_stack.pop();
+      m_stack.pop_back();
     }
 
     // op consumes tmp
@@ -79,38 +87,59 @@ void OperatorParser::insertNode(Node* node) {
     tmp->parent = op;
     op->setupLeft();
 
-    // Finally, push our op onto the stack and return.
-    m_stack.push_back(op, opPrecedence.priority + (int)opPrecedence.assoc);
+    // Finally, push our op onto the stack and return.  A right-associative
+    // op sits one below its priority, so that a following op of the same
+    // priority does not take its right operand away from it.
+    m_stack.push_back(make_pair(static_cast<Node*>(op),
+        opPrecedence.priority - (int)opPrecedence.assoc));
     m_infixing = false;
     return;
   }
 
   if (op && op->couldBePrefix()) {
     op->setPrefix();
-    m_stack.push_back(make_pair(node, op->Precedence(Operator::PREFIX)));
+    m_stack.push_back(make_pair(node,
+        op->precedence(Operator::PREFIX).priority));
     // Prefix operator short-circuits the infixing: leave m_infixing==false
     return;
   }
-  // Non-operator symbol: set m_infixing=true to check for right-side ops
+  // Non-operator symbol: set m_infixing=true to check for right-side ops.
+  // An operand is complete as it arrives, so it can be set up right away.
+  node->setupNode();
   m_stack.push_back(make_pair(node, Operator::NO_PRIORITY));
   m_infixing = true;
 }
 
 Node* OperatorParser::finalizeParse() {
   if (m_stack.empty()) {
-    throw EvalError("Finalizing parse of empty OperatorParser " + print());
+    throw EvalError("Finalizing parse of empty operator expression");
   }
   // Ensure we were not left with a dangling operator
-  Node* stackTop = m_stack.back();
+  Node* stackTop = m_stack.back().first;
   Operator* stackOp = dynamic_cast<Operator*>(stackTop);
   if (stackOp) {
-    throw EvalError("Finalizing parse of " + print() + " was left with dangling operator " + stackOp->print());
+    throw EvalError("Finalizing parse of operators was left with dangling operator " + stackOp->print());
   }
   // The top of the stack fills a void in the operator above it, and so on up
   // the stack.
   Node* tmp = stackTop;
+  m_stack.pop_back();
   while (!m_stack.empty()) {
-    
+    stackOp = dynamic_cast<Operator*>(m_stack.back().first);
+    if (!stackOp) {
+      throw EvalError("Found a non-operator beneath the top of the operator stack");
+    }
+    stackOp->addChild(tmp);
+    tmp->parent = stackOp;
+    if (stackOp->isPrefix()) {
+      stackOp->setupLeft();
+    } else {
+      stackOp->setupRight();
+    }
+    stackOp->setupNode();
+    tmp = stackOp;
+    m_stack.pop_back();
   }
-  return NULL;
+  m_infixing = false;
+  return tmp;
 }
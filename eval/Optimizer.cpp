@@ -0,0 +1,97 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Optimizer.h"
+
+#include "EvalError.h"
+#include "Literal.h"
+#include "Node.h"
+#include "Operator.h"
+#include "Value.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+void Optimizer::optimize(Node& statement) {
+  if (!statement.isAnalyzed || statement.isEvaluated) {
+    throw EvalError("Optimizer needs an analyzed, unevaluated statement");
+  }
+  optimizeNode(&statement);
+  if (m_rewrites > 0 && m_log.isDebug()) {
+    m_log.debug("Optimizer made " + boost::lexical_cast<string>(m_rewrites) + " rewrites");
+  }
+}
+
+/* private */
+
+// Children-first, so that operands are folded before their operators.
+void Optimizer::optimizeNode(Node* node) {
+  // Children may be replaced as we go, so index rather than iterate
+  for (size_t i = 0; i < node->children.size(); ++i) {
+    optimizeNode(node->children.at(i));
+  }
+  Operator* op = dynamic_cast<Operator*>(node);
+  if (!op) return;
+  Literal* literal = fold(op);
+  if (!literal) return;
+
+  // Bring the replacement up to the same state as the node it replaces
+  // before swapping it into the tree.
+  Node* parent = op->parent;
+  literal->parent = parent;
+  try {
+    literal->initScopeNode(parent);
+    literal->setupNode();
+    Operator* parentOp = dynamic_cast<Operator*>(parent);
+    if (parentOp) {
+      parentOp->replaceOperand(op, literal);
+    } else {
+      parent->replaceChild(op, literal);
+    }
+  } catch (EvalError&) {
+    delete literal;
+    throw;
+  }
+  if (m_log.isDebug()) {
+    m_log.debug("Optimizer folded " + op->print() + " into " + literal->print());
+  }
+  delete op;
+  ++m_rewrites;
+}
+
+Literal* Optimizer::fold(Operator* op) {
+  if (!op->isAnalyzed || op->children.empty()) return NULL;
+  Literal* left = dynamic_cast<Literal*>(op->children.at(0));
+  Literal* right = NULL;
+  if (!left) return NULL;
+  if (op->isInfix()) {
+    if (op->children.size() != 2) return NULL;
+    right = dynamic_cast<Literal*>(op->children.at(1));
+    if (!right) return NULL;
+  }
+
+  // Run the kernel that analysis picked, so the folded constant is exactly
+  // what evaluate() would have computed
+  if (!op->m_kernel) return NULL;
+  Value result;
+  try {
+    op->m_kernel(left->getValue(), right ? right->getValue() : left->getValue(),
+                 result);
+  } catch (EvalError&) {
+    return NULL;    // leave the error for runtime
+  }
+  switch (result.kind()) {
+    case Value::KIND_INT:
+      return new Literal(m_log, op->root, Token("INT", result.print()));
+    case Value::KIND_FIXED:
+      return new Literal(m_log, op->root, Token("FIXED", result.print()));
+    case Value::KIND_STR:
+      return new Literal(m_log, op->root, Token("STR", result.getText().str()));
+    default:
+      return NULL;
+  }
+}
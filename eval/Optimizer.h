@@ -0,0 +1,52 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Optimizer_h_
+#define _Optimizer_h_
+
+/* Static optimization pass
+ *
+ * Runs once over each top-level statement, as soon as Node::setupAsParent()
+ * has analyzed it and before it is evaluated, rewriting the AST into
+ * something equivalent but cheaper to run.  Every rewrite is reported at
+ * debug log level.
+ *
+ * Presently it folds constant operator subtrees: an Operator whose operands
+ * are all Literals is replaced by the Literal it would evaluate to.  Folding
+ * works bottom-up, so a whole constant expression collapses into one Literal.
+ * Arithmetic that would fail, such as a division by zero or a negative int
+ * power, is left alone to be dealt with at runtime.
+ */
+
+#include "Log.h"
+
+#include <string>
+
+namespace eval {
+
+class Literal;
+class Node;
+class Operator;
+
+class Optimizer {
+public:
+  Optimizer(Log& log)
+    : m_log(log),
+      m_rewrites(0) {}
+
+  // Optimize an analyzed, not yet evaluated statement and its subtree
+  void optimize(Node& statement);
+  int rewrites() const { return m_rewrites; }
+
+private:
+  void optimizeNode(Node* node);
+  // Returns a new Literal equivalent to op, or NULL if op can't be folded
+  Literal* fold(Operator* op);
+
+  Log& m_log;
+  int m_rewrites;
+};
+
+};
+
+#endif // _Optimizer_h_
@@ -0,0 +1,43 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Parameter.h"
+
+#include "EvalError.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+void Parameter::setup() {
+  if (children.size() != 2) {
+    throw EvalError("Parameter " + print() + " must have a name and a type");
+  }
+  m_identifier = dynamic_cast<Identifier*>(children.at(0));
+  if (!m_identifier) {
+    throw EvalError("Parameter's first child must be an identifier");
+  }
+  m_typeSpec = dynamic_cast<TypeSpec*>(children.at(1));
+  if (!m_typeSpec) {
+    throw EvalError("Parameter's second child must be a type specifier");
+  }
+}
+
+// Nothing to do
+void Parameter::evaluate() {
+}
+
+string Parameter::getName() const {
+  if (!m_identifier) {
+    throw EvalError("Cannot get the name of Parameter " + print() + " before it is setup");
+  }
+  return m_identifier->getName();
+}
+
+TypeRef Parameter::getType() const {
+  if (!m_typeSpec) {
+    throw EvalError("Cannot get the type of Parameter " + print() + " before it is setup");
+  }
+  return m_typeSpec->getType();
+}
@@ -0,0 +1,45 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Parameter_h_
+#define _Parameter_h_
+
+/* Function parameter
+ *
+ * One named, typed parameter in a function definition:
+ *    (arg ID:'n' (type (var ID:'int')))
+ * The FunctionDef collects its Parameters into the function's signature.
+ */
+
+#include "Identifier.h"
+#include "Log.h"
+#include "Node.h"
+#include "RootNode.h"
+#include "Token.h"
+#include "Type.h"
+#include "TypeSpec.h"
+
+#include <string>
+
+namespace eval {
+
+class Parameter : public Node {
+public:
+  Parameter(Log& log, RootNode*const root, const Token& token)
+    : Node(log, root, token),
+      m_identifier(NULL),
+      m_typeSpec(NULL) {}
+  virtual void setup();
+  virtual void evaluate();
+
+  std::string getName() const;
+  TypeRef getType() const;
+
+private:
+  Identifier* m_identifier;
+  TypeSpec* m_typeSpec;
+};
+
+};
+
+#endif // _Parameter_h_
@@ -3,19 +3,25 @@
 
 #include "ProcCall.h"
 
+#include "Activation.h"
 #include "Expression.h"
 #include "EvalError.h"
 #include "Function.h"
+#include "RootNode.h"
 
 #include <memory>
 #include <string>
 #include <vector>
-using std::auto_ptr;
 using std::string;
 using std::vector;
 
 using namespace eval;
 
+ProcCall::~ProcCall() {
+  if (m_result) m_result->release();
+  if (m_function) m_function->release();
+}
+
 void ProcCall::setup() {
   if (children.size() < 1) {
     throw EvalError("ProcCall must have >= 1 children");
@@ -25,10 +31,15 @@ void ProcCall::setup() {
     throw EvalError("ProcCall first child must be a Variable");
   }
   Object& object = var->getObject();
-  m_function = dynamic_cast<Function*>(&object);
-  if (!m_function) {
+  Function* function = dynamic_cast<Function*>(&object);
+  if (!function) {
     throw EvalError("ProcCall cannot call a non-function");
   }
+  // Our reference keeps the Function, and so m_signature, from being
+  // collected while we can still call it
+  function->retain();
+  if (m_function) m_function->release();
+  m_function = function;
   for (child_iter i = children.begin()+1; i != children.end(); ++i) {
     Expression* exp = dynamic_cast<Expression*>(*i);
     if (!exp) {
@@ -37,24 +48,85 @@ void ProcCall::setup() {
     m_argexps.push_back(exp);
     m_argtypes.push_back(&exp->type());
   }
-  // Verify that the function has a signature for these arg types
-  if (!m_function->takesArgs(m_argtypes)) {
-    throw EvalError("Function " + m_function->print() + " does not accept the provided arguments");
-  }
+  // The arg types are fixed, so this is our dispatch for every call, until
+  // the function's signatures change
+  resolveSignature();
+  computeType();
 }
 
 void ProcCall::evaluate() {
+  // m_signature may be gone if the function's signatures have changed
+  if (m_function->generation() != m_generation) {
+    resolveSignature();
+    if (m_signature->getReturnType().get() != m_type.get()) {
+      throw EvalError("Function " + m_function->print() + " no longer returns the type it was called for");
+    }
+  }
   // The expressions of m_argexps have all been evaluated.  Call the
   // function on their resulting objects.
-  object_list args;
-  for (vector<Expression*>::const_iterator i = m_argexps.begin();
-       i != m_argexps.end(); ++i) {
-    args.push_back(&(*i)->getObject());
+  if (m_tailBody) {
+    tailCall();
+    return;
+  }
+  CallFrame frame(root->getCallStack(), *m_function, *m_signature);
+  for (size_t n = 0; n < m_argexps.size(); ++n) {
+    frame.setArg(n, &m_argexps[n]->getObject());
+  }
+  Object* result = m_function->call(frame);
+  if (result) result->retain();
+  if (m_result) m_result->release();
+  m_result = result;
+}
+
+Object& ProcCall::getObject() const {
+  if (!m_result) {
+    throw EvalError("Function " + m_function->print() + " returned no object");
+  }
+  return *m_result;
+}
+
+/* protected */
+
+void ProcCall::saveResult(Activation& activation) const {
+  activation.saveObject(m_result);
+}
+
+void ProcCall::restoreResult(Activation& activation) {
+  Object* result = activation.restoreObject();
+  if (m_result) m_result->release();
+  m_result = result;
+}
+
+/* private */
+
+void ProcCall::resolveSignature() {
+  m_signature = m_function->getSignature(m_argtypes);
+  m_generation = m_function->generation();
+  if (!m_signature) {
+    throw EvalError("Function " + m_function->print() + " does not accept the provided arguments");
+  }
+}
+
+void ProcCall::tailCall() {
+  // Take the arguments first: one may be in a slot the retarget releases
+  vector<Object*> args;
+  args.reserve(m_argexps.size());
+  for (size_t n = 0; n < m_argexps.size(); ++n) {
+    Object* arg = &m_argexps[n]->getObject();
+    arg->retain();
+    args.push_back(arg);
+  }
+  CallFrame& frame = m_tailBody->currentFrame();
+  frame.tailCall(*m_function, *m_signature);
+  for (size_t n = 0; n < args.size(); ++n) {
+    frame.setArg(n, args[n]);
+    args[n]->release();
   }
-  auto_ptr<Object> ret = m_function->call(args);
+  if (m_result) m_result->release();
+  m_result = NULL;
 }
 
 void ProcCall::computeType() {
   // ProcCall type is the return type of the function
-  m_type = m_function->getPossibleReturnTypes(m_argtypes);
+  m_type = m_signature->getReturnType();
 }
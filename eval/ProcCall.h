@@ -4,7 +4,12 @@
 #ifndef _ProcCall_h_
 #define _ProcCall_h_
 
-/* ProcCall (the calling of a function/procedure/method) */
+/* ProcCall (the calling of a function/procedure/method)
+ *
+ * A call that a return statement returns directly is a tail call: instead of
+ * pushing a frame of its own, it retargets the frame of the body it is in,
+ * and has no result of its own.
+ */
 
 #include "Function.h"
 #include "Log.h"
@@ -19,14 +24,40 @@ namespace eval {
 class ProcCall : public TypedNode {
 public:
   ProcCall(Log& log, RootNode*const root, const Token& token)
-    : TypedNode(log, root, token) {}
+    : TypedNode(log, root, token),
+      m_function(NULL),
+      m_signature(NULL),
+      m_generation(0),
+      m_tailBody(NULL),
+      m_result(NULL) {}
+  ~ProcCall();
   virtual void setup();
   virtual void evaluate();
+  // Make this a tail call from body, which it must be in
+  void setTailCall(Block& body) { m_tailBody = &body; }
+
+  // The function's result, once evaluated
+  Object& getObject() const;
+  virtual const Value& getValue() const { return getObject().getValue(); }
+  virtual evaluator_fn evaluator() const { return &EvaluateDirect<ProcCall>; }
+
+protected:
+  // from Node: our result, which a re-entered function body sets aside
+  virtual void saveResult(Activation& activation) const;
+  virtual void restoreResult(Activation& activation);
 
 private:
   // from TypedNode
   virtual void computeType();
-  Function* m_function;
+  // Find the function's signature for our argument types
+  void resolveSignature();
+  // Retarget m_tailBody's frame at our function and arguments
+  void tailCall();
+  Function* m_function;   // we hold a reference
+  const Signature* m_signature;
+  unsigned int m_generation;    // of m_function, when we found m_signature
+  Block* m_tailBody;  // the body we tail-call from, or NULL
+  Object* m_result;   // we hold a reference
   std::vector<Expression*> m_argexps;
   type_list m_argtypes;
 };
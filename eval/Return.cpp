@@ -0,0 +1,54 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Return.h"
+
+#include "EvalError.h"
+#include "Object.h"
+#include "Type.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+void Return::setup() {
+  if (children.size() > 1) {
+    throw EvalError("Return " + print() + " can have at most one child");
+  }
+  m_body = enclosingBody();
+  if (!m_body) {
+    throw EvalError("Cannot return outside a function");
+  }
+  if (1 == children.size()) {
+    m_exp = dynamic_cast<Expression*>(children.front());
+    if (!m_exp) {
+      throw EvalError("Return " + print() + " must return an Expression");
+    }
+  }
+  TypeRef returnType = m_body->getReturnType();
+  if (!returnType.get()) {
+    if (m_exp) {
+      throw EvalError("Cannot return a value from a function that has no return type");
+    }
+  } else if (!m_exp) {
+    throw EvalError("Function must return a value of type " + returnType->print());
+  } else if (!returnType->isCompatible(m_exp->type())) {
+    throw EvalError("Cannot return " + m_exp->print() + " of type " + m_exp->type().print() + " from a function that returns " + returnType->print());
+  }
+  if (m_exp) {
+    m_tailCall = m_exp->getProcCall();
+    if (m_tailCall) {
+      m_tailCall->setTailCall(*m_body);
+    }
+  }
+}
+
+void Return::evaluate() {
+  Object* result = NULL;
+  if (m_exp && !m_tailCall) {
+    result = new Object(log, "return", m_exp->getType());
+    result->setValue(m_exp->getValue());
+  }
+  m_body->returnWith(result);
+}
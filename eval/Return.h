@@ -0,0 +1,51 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Return_h_
+#define _Return_h_
+
+/* Return statement
+ *
+ * Finishes the call of the function body that it is in, with the value of
+ * its Expression as the result, or with no result:
+ *    (return (exp (var ID:'x')))
+ *    (return)
+ * The result is a new Object holding a copy of the value, so that it stays
+ * the same whatever the body does on its next call.  At setup() we check it
+ * against the function's return type.
+ *
+ * Returning a call, as in "return f(x)", is a tail call (see ProcCall): the
+ * body finishes with no result, and the callee runs in the body's frame.
+ */
+
+#include "Block.h"
+#include "Expression.h"
+#include "Log.h"
+#include "Node.h"
+#include "ProcCall.h"
+#include "RootNode.h"
+#include "Token.h"
+
+#include <string>
+
+namespace eval {
+
+class Return : public Node {
+public:
+  Return(Log& log, RootNode*const root, const Token& token)
+    : Node(log, root, token),
+      m_body(NULL),
+      m_exp(NULL),
+      m_tailCall(NULL) {}
+  virtual void setup();
+  virtual void evaluate();
+
+private:
+  Block* m_body;
+  Expression* m_exp;    // NULL for no result
+  ProcCall* m_tailCall;   // m_exp's call, if that is all it is
+};
+
+};
+
+#endif // _Return_h_
@@ -3,22 +3,19 @@
 
 #include "RootNode.h"
 
+#include "Builtins.h"
 #include "Log.h"
 #include "EvalError.h"
+#include "Heap.h"
 #include "Token.h"
 
 #include <iostream>
 #include <memory>
-using std::auto_ptr;
 
 using namespace eval;
 
 /* public */
 
-void builtinFoo() {
-  std::cout << "PRINT:WAAAAA" << std::endl;
-}
-
 RootNode::RootNode(Log& log)
   : Node(log, NULL, Token(":ROOT:")),
     m_scope(log) {
@@ -27,28 +24,17 @@ RootNode::RootNode(Log& log)
   isAnalyzed = true;
 
   // Insert default objects (standard library)
-  Object& object = m_scope.newObject("object", auto_ptr<Type>(new NullType()));
-  //object.newMember("foo", std::auto_ptr<Type>(new BasicType(object))); // test
-  Object& func = m_scope.newObject("@", auto_ptr<Type>(new BasicType(object)));
-  // Test: member function
-  Object& foo = object.newMember("foo", std::auto_ptr<Type>(new BasicType(func)));
-  // It's too tricky to make a code-block for a function that is done exactly
-  // as if it were given by a user.  At least before that mechanism wholly
-  // exists so we can just include it as stdlib code without any builtin
-  // hackery.  Let's have two mechanisms: built-in functions that have actual
-  // C++ code bodies, and non-builtins.
-  //
-  // NO screw that.  Either you're a real function or you're a different
-  // element of the AST, i.e. a new kind of Node.
-  //
-  // A builtin codeblock is a function that returns void, and accepts an
-  // Object& (the Object it's ultimately acting on, i.e. self), and an
-  // object_list of the actually provided arguments.
-  /*
-  argspec_list args;
-  (void*) builtinCode = builtinFoo;
-  Function& foo = foo.newSignature(args, NULL, builtinCode);
-  */
+  Object& object = m_scope.newObject("object", NullType::Get());
+  m_scope.newObject("@", BasicType::Get(object));
+  // Literal types
+  m_scope.newObject("int", BasicType::Get(object));
+  m_scope.newObject("fixed", BasicType::Get(object));
+  m_scope.newObject("str", BasicType::Get(object));
+  // Collections
+  m_scope.newObject("list", BasicType::Get(object));
+  m_scope.newObject("map", BasicType::Get(object));
+  // Functions with C++ bodies
+  Builtins(log, m_scope).install();
 
   m_scope.commitAll();
 }
@@ -76,6 +62,11 @@ void RootNode::setup() {
 void RootNode::evaluate() {
   // Children were evaluated successfully.  Clear them away.
   clearChildren(true);
+  // Between statements is a safe point to free unreachable cycles
+  if (Heap::ShouldCollect()) {
+    Heap::Collect(log);
+    log.debug("Heap: " + Heap::PrintStats());
+  }
 }
 
 void RootNode::clearChildren(bool onlyEvaluatedChildren) {
@@ -6,6 +6,7 @@
 
 /* Root node of the AST */
 
+#include "CallStack.h"
 #include "Log.h"
 #include "Node.h"
 #include "Scope.h"
@@ -23,6 +24,9 @@ public:
   // Prepare the RootNode for another evaluation
   void prepare();
 
+  // Shared by every function call made while evaluating
+  CallStack& getCallStack() { return m_callStack; }
+
 protected:
   virtual void setup();
   virtual void evaluate();
@@ -31,6 +35,7 @@ protected:
 private:
   void clearChildren(bool onlyEvaluatedChildren = false);
   Scope m_scope;
+  CallStack m_callStack;
 };
 
 };
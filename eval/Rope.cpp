@@ -0,0 +1,121 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Rope.h"
+
+#include <algorithm>
+#include <ostream>
+#include <string.h>
+#include <string>
+using std::string;
+
+using namespace eval;
+
+const size_t Rope::INLINE_SIZE;
+const size_t Rope::CHUNK_SIZE;
+
+Rope::Rope(const boost::shared_ptr<const Buffer>& buffer,
+           const char* s, size_t n)
+  : m_size(0) {
+  if (n <= INLINE_SIZE) {
+    append(s, n);
+  } else {
+    m_chunks.push_back(Chunk(buffer, s, n));
+    m_size = n;
+  }
+}
+
+void Rope::append(const char* s, size_t n) {
+  if (0 == n) {
+    return;
+  }
+  if (isInline() && m_size + n <= INLINE_SIZE) {
+    memcpy(m_inline + m_size, s, n);
+    m_size += n;
+    return;
+  }
+  if (isInline()) {
+    // Spill to a chunk with room to grow.  s may point into m_inline.
+    chunk_ptr chunk(new string());
+    chunk->reserve(std::max(CHUNK_SIZE, m_size + n));
+    chunk->append(m_inline, m_size);
+    chunk->append(s, n);
+    m_chunks.push_back(Chunk(chunk));
+  } else if (n < CHUNK_SIZE && m_chunks.back().text &&
+             m_chunks.back().text.unique()) {
+    m_chunks.back().text->append(s, n);
+  } else {
+    chunk_ptr chunk(new string());
+    chunk->reserve(std::max(CHUNK_SIZE, n));
+    chunk->append(s, n);
+    m_chunks.push_back(Chunk(chunk));
+  }
+  m_size += n;
+}
+
+Rope& Rope::operator+=(const Rope& rope) {
+  if (rope.isInline()) {
+    append(rope.m_inline, rope.m_size);
+    return *this;
+  }
+  // Copy the vector first, in case rope is *this
+  chunk_vec chunks(rope.m_chunks);
+  for (chunk_vec::const_iterator i = chunks.begin(); i != chunks.end(); ++i) {
+    if (i->size() < CHUNK_SIZE) {
+      append(i->data(), i->size());
+    } else {
+      if (isInline() && m_size > 0) {
+        // Keep our text ahead of the shared chunk
+        chunk_ptr chunk(new string(m_inline, m_size));
+        m_chunks.push_back(Chunk(chunk));
+      }
+      m_chunks.push_back(*i);
+      m_size += i->size();
+    }
+  }
+  return *this;
+}
+
+const char* Rope::data() const {
+  if (isInline()) {
+    return m_inline;
+  }
+  if (m_chunks.size() > 1) {
+    chunk_ptr merged(new string());
+    merged->reserve(m_size);
+    for (chunk_vec::const_iterator i = m_chunks.begin(); i != m_chunks.end(); ++i) {
+      merged->append(i->data(), i->size());
+    }
+    m_chunks.assign(1, Chunk(merged));
+  }
+  return m_chunks[0].data();
+}
+
+string Rope::str() const {
+  if (isInline()) {
+    return string(m_inline, m_size);
+  }
+  string s;
+  s.reserve(m_size);
+  for (chunk_vec::const_iterator i = m_chunks.begin(); i != m_chunks.end(); ++i) {
+    s.append(i->data(), i->size());
+  }
+  return s;
+}
+
+void Rope::write(std::ostream& out) const {
+  if (isInline()) {
+    out.write(m_inline, m_size);
+    return;
+  }
+  for (chunk_vec::const_iterator i = m_chunks.begin(); i != m_chunks.end(); ++i) {
+    out.write(i->data(), i->size());
+  }
+}
+
+int Rope::compare(const Rope& rope) const {
+  size_t n = std::min(m_size, rope.m_size);
+  int c = n ? memcmp(data(), rope.data(), n) : 0;
+  if (c != 0) return c;
+  return m_size < rope.m_size ? -1 : (m_size > rope.m_size ? 1 : 0);
+}
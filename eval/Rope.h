@@ -0,0 +1,111 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Rope_h_
+#define _Rope_h_
+
+/* Rope
+ *
+ * Text that is cheap to build up: the representation of str values, command
+ * lines and captured output.
+ *
+ * Text of up to INLINE_SIZE bytes is stored in the Rope itself and never
+ * allocates.  Anything longer is a sequence of shared, immutable-once-shared
+ * chunks.  Appending a short piece copies it onto the last chunk if this
+ * Rope is that chunk's only owner (amortized, like std::string), and
+ * otherwise starts a new chunk; appending a long Rope shares its chunks
+ * without copying them.  So a line built up from many pieces, or output
+ * accumulated a block at a time, is copied a constant number of times
+ * rather than once per append.
+ *
+ * A Rope can also be a slice of a Buffer, such as captured command output,
+ * which it then shares rather than copies.  Slices are never appended to in
+ * place.
+ *
+ * write() streams the chunks as they are.  data() needs the text to be
+ * contiguous, so merges the chunks into one the first time it is called.
+ */
+
+#include <boost/shared_ptr.hpp>
+
+#include <ostream>
+#include <string.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class Buffer;
+
+class Rope {
+public:
+  static const size_t INLINE_SIZE = 22;
+  // Pieces shorter than this are copied rather than shared
+  static const size_t CHUNK_SIZE = 4096;
+
+  Rope()
+    : m_size(0) {}
+  Rope(const std::string& s)
+    : m_size(0) { append(s.data(), s.size()); }
+  Rope(const char* s)
+    : m_size(0) { append(s, strlen(s)); }
+  Rope(const char* s, size_t n)
+    : m_size(0) { append(s, n); }
+  // The n bytes at s, which lie within buffer.  Short text is copied; longer
+  // text keeps buffer alive and refers to it.
+  Rope(const boost::shared_ptr<const Buffer>& buffer, const char* s, size_t n);
+
+  size_t size() const { return m_size; }
+  bool empty() const { return 0 == m_size; }
+
+  void append(const char* s, size_t n);
+  Rope& operator+=(const char* s) {
+    append(s, strlen(s));
+    return *this;
+  }
+  Rope& operator+=(const std::string& s) {
+    append(s.data(), s.size());
+    return *this;
+  }
+  Rope& operator+=(const Rope& rope);
+
+  // The text, contiguous but not NUL-terminated
+  const char* data() const;
+  std::string str() const;
+  void write(std::ostream& out) const;
+
+  // <0, 0 or >0, as for std::string::compare
+  int compare(const Rope& rope) const;
+  bool operator==(const Rope& rope) const {
+    return m_size == rope.m_size && 0 == compare(rope);
+  }
+
+private:
+  typedef boost::shared_ptr<std::string> chunk_ptr;
+  // Owned text, or a slice of a Buffer
+  struct Chunk {
+    Chunk(const chunk_ptr& text)
+      : text(text), slice(NULL), sliceSize(0) {}
+    Chunk(const boost::shared_ptr<const Buffer>& buffer,
+          const char* slice, size_t sliceSize)
+      : buffer(buffer), slice(slice), sliceSize(sliceSize) {}
+    const char* data() const { return text ? text->data() : slice; }
+    size_t size() const { return text ? text->size() : sliceSize; }
+
+    chunk_ptr text;
+    boost::shared_ptr<const Buffer> buffer;
+    const char* slice;
+    size_t sliceSize;
+  };
+  typedef std::vector<Chunk> chunk_vec;
+
+  bool isInline() const { return m_chunks.empty(); }
+
+  size_t m_size;
+  char m_inline[INLINE_SIZE];
+  mutable chunk_vec m_chunks;   // data() merges these
+};
+
+};
+
+#endif // _Rope_h_
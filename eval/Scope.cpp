@@ -9,7 +9,6 @@
 
 #include <string>
 #include <string>
-using std::auto_ptr;
 using std::string;
 
 using namespace eval;
@@ -26,6 +25,13 @@ void Scope::init(Scope* parentScope) {
   }
   m_parentScope = parentScope;
   m_depth = parentScope->m_depth + 1;
+  m_display = parentScope->m_display;
+  // Depth 1 holds nothing, so skip over it to the root; nothing indexes it
+  if (1 == parentScope->m_depth) {
+    m_parentScope = parentScope->m_parentScope;
+    m_display.back() = NULL;
+  }
+  m_display.push_back(this);
   m_log.debug("Init scope at depth " + boost::lexical_cast<string>(m_depth));
 }
 
@@ -76,14 +82,70 @@ void Scope::revertAll() {
   m_objectStore.revertAll();
 }
 
+Scope::Savepoint Scope::savepoint() const {
+  // depth of 1 is fake; it just defers up to the root scope
+  if (1 == m_depth) {
+    if (!m_parentScope) { throw EvalError("Scope at depth 1 has no parent"); }
+    return m_parentScope->savepoint();
+  }
+  return m_objectStore.savepoint();
+}
+
+// Revert everything made pending since the savepoint
+void Scope::rollback(Savepoint savepoint) {
+  // depth of 1 is fake; it just defers up to the root scope
+  if (1 == m_depth) {
+    if (!m_parentScope) { throw EvalError("Scope at depth 1 has no parent"); }
+    return m_parentScope->rollback(savepoint);
+  }
+  m_objectStore.rollback(savepoint);
+}
+
+bool Scope::isPending(const string& varname) const {
+  // depth of 1 is fake; it just defers up to the root scope
+  if (1 == m_depth) {
+    if (!m_parentScope) { throw EvalError("Scope at depth 1 has no parent"); }
+    return m_parentScope->isPending(varname);
+  }
+  return m_objectStore.isPending(varname);
+}
+
+// The name is looked up as a symbol once, rather than at every level
 Object* Scope::getObject(const string& varname) const {
+  symbol_id symbol;
+  if (!Symbol::Find(varname, symbol)) return NULL;
+  return getObject(symbol);
+}
+
+Object* Scope::getObject(symbol_id varname) const {
   Object* o = m_objectStore.getObject(varname);
   if (o) return o;
   if (!m_parentScope) return NULL;
   return m_parentScope->getObject(varname);
 }
 
-Object& Scope::newObject(const string& varname, auto_ptr<Type> type) {
+// A scope at depth 1 has an empty store, so a walk from there finds the
+// root's objects at depth 0 without any special-casing.
+bool Scope::resolve(symbol_id varname, Address& address) const {
+  for (const Scope* scope = this; scope; scope = scope->m_parentScope) {
+    if (scope->m_objectStore.findSlot(varname, address.slot,
+                                      address.generation)) {
+      address.depth = scope->m_depth;
+      return true;
+    }
+  }
+  return false;
+}
+
+Object* Scope::getObject(const Address& address) const {
+  if (!address.isValid() || address.depth > m_depth) {
+    throw EvalError("Scope at depth " + boost::lexical_cast<string>(m_depth) + " cannot look up an object at depth " + boost::lexical_cast<string>(address.depth));
+  }
+  return m_display[address.depth]->m_objectStore.getSlot(address.slot,
+                                                       address.generation);
+}
+
+Object& Scope::newObject(const string& varname, TypeRef type) {
   // depth of 1 is fake; it just defers up to the root scope
   if (1 == m_depth) {
     if (!m_parentScope) { throw EvalError("Scope at depth 1 has no parent"); }
@@ -92,6 +154,15 @@ Object& Scope::newObject(const string& varname, auto_ptr<Type> type) {
   return m_objectStore.newObject(varname, type);
 }
 
+Object& Scope::addObject(const string& varname, Object* object) {
+  // depth of 1 is fake; it just defers up to the root scope
+  if (1 == m_depth) {
+    if (!m_parentScope) { throw EvalError("Scope at depth 1 has no parent"); }
+    return m_parentScope->addObject(varname, object);
+  }
+  return m_objectStore.addObject(varname, object);
+}
+
 void Scope::delObject(const string& varname) {
   // depth of 1 is fake; it just defers up to the root scope
   if (1 == m_depth) {
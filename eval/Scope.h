@@ -11,7 +11,10 @@
  * global scope (held by RootNode).  A scope depth of 1 is fake, for silly
  * implementation reasons relating to how a '{' flips you from command-mode
  * into the global scope.  Thus scope depth 1 just defers down to the global
- * scope, and depth 2 really represents the first nested scope level.
+ * scope, and depth 2 really represents the first nested scope level.  A
+ * depth-1 scope lasts only as long as its command line, so a scope nested in
+ * it takes the global scope as its parent, and can outlive it (a function
+ * body does).
  *
  * A Scope is backed by an ObjectStore, and merely implements the parent-scope
  * and scope-depth logic on top of it.  An ObjectStore only knows what's in its
@@ -21,28 +24,47 @@
  * newObject() creates a new Object in the scope, but it is marked as "pending"
  * until it is finally either commit() or revert().  This allows any
  * setup/analysis stages to track the Object and its Type but lets us abort in
- * case of error.  All of this is handled by the underlying ObjectStore.
+ * case of error.  All of this is handled by the underlying ObjectStore, which
+ * also provides savepoints to roll back everything made pending since.
+ *
+ * Names can also be resolved statically, during setup(), to an Address: the
+ * depth of the scope that holds the object, and its slot (and the slot's
+ * generation) in that scope's store.  Each Scope keeps a display -- the
+ * scopes enclosing it, indexed by depth -- so fetching the object at an
+ * Address later is two array loads, however deeply nested we are.
  */
 
 #include "Log.h"
 #include "Object.h"
 #include "ObjectStore.h"
+#include "Symbol.h"
 #include "Type.h"
 
-#include <map>
 #include <memory>
 #include <string>
-#include <utility>
+#include <vector>
 
 namespace eval {
 
 class Scope {
 public:
+  // Lexical address of a name: where resolve() found it
+  struct Address {
+    Address()
+      : depth(-1), slot(0), generation(0) {}
+    bool isValid() const { return depth >= 0; }
+    int depth;
+    size_t slot;
+    ObjectStore::Generation generation;
+  };
+
   Scope(Log& log)
     : m_log(log),
       m_objectStore(log),
       m_parentScope(NULL),
-      m_depth(0) {}
+      m_depth(0) {
+    m_display.push_back(this);
+  }
   ~Scope();
 
   void init(Scope* parentScope);
@@ -51,12 +73,25 @@ public:
   void commitAll();
   void revert(const std::string& varname);
   void revertAll();
+  typedef ObjectStore::Savepoint Savepoint;
+  Savepoint savepoint() const;
+  void rollback(Savepoint savepoint);
+  // Is the object pending in this scope (not its parents)?
+  bool isPending(const std::string& varname) const;
 
   // Lookup an object, deferring up the tree if it's not found locally.
   // Returns NULL if it does not exist anywhere.
   Object* getObject(const std::string& varname) const;
+  Object* getObject(symbol_id varname) const;
+  // Resolve a name to its lexical address; false if it does not exist
+  bool resolve(symbol_id varname, Address& address) const;
+  // Object at an address resolve()d from this scope, or NULL if it is gone,
+  // even if another object has since taken its slot
+  Object* getObject(const Address& address) const;
   // Insert a new object, as "pending" until it's either commit or revert
-  Object& newObject(const std::string& varname, std::auto_ptr<Type> type);
+  Object& newObject(const std::string& varname, TypeRef type);
+  // Insert an already-constructed object, the same way
+  Object& addObject(const std::string& varname, Object* object);
   void delObject(const std::string& varname);
 
 private:
@@ -64,6 +99,8 @@ private:
   ObjectStore m_objectStore;
   Scope* m_parentScope;   // NULL for the root scope (held by RootNode)
   int m_depth;            // 0 at root (global).  1 is special: defers to root
+  // Enclosing scopes by depth, ending with this one
+  std::vector<const Scope*> m_display;
 };
 
 };
@@ -0,0 +1,45 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Shape.h"
+
+using namespace eval;
+
+const Shape& Shape::Empty() {
+  static Shape empty;
+  return empty;
+}
+
+Shape::Shape(const Shape& parent, symbol_id member)
+  : m_size(parent.m_size + 1) {
+  if (parent.m_offsets->size() == parent.m_size) {
+    // Nothing has extended the parent yet; carry on its table
+    m_offsets = parent.m_offsets;
+  } else {
+    // A sibling already did; take a copy of just the parent's own entries
+    m_offsets.reset(new offset_map());
+    const offset_map& offsets = *parent.m_offsets;
+    for (size_t s = 0; s < offsets.slots(); ++s) {
+      if (offsets.isUsed(s) && offsets.valueAt(s) < parent.m_size) {
+        m_offsets->insert(offsets.keyAt(s), offsets.valueAt(s));
+      }
+    }
+  }
+  m_offsets->insert(member, parent.m_size);
+}
+
+Shape::~Shape() {
+  for (size_t s = 0; s < m_transitions.slots(); ++s) {
+    if (m_transitions.isUsed(s)) {
+      delete m_transitions.valueAt(s);
+    }
+  }
+}
+
+const Shape& Shape::withMember(symbol_id member) const {
+  Shape** next = m_transitions.find(member);
+  if (next) return **next;
+  Shape* shape = new Shape(*this, member);
+  m_transitions.insert(member, shape);
+  return *shape;
+}
@@ -0,0 +1,73 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Shape_h_
+#define _Shape_h_
+
+/* Shape (hidden class) of an Object's members
+ *
+ * An Object does not keep its own name-to-member table.  Instead it points at
+ * a Shape, which maps each member name to an offset into the Object's member
+ * vector.  Shapes form a tree rooted at the empty shape: adding a member
+ * follows (or creates) a transition to the shape with that member appended.
+ * So every Object that had the same members added in the same order shares
+ * one Shape, and a member of such Objects is always at the same offset --
+ * which is what lets an inline cache remember (shape, offset) for a site.
+ *
+ * Offsets are assigned in order, so a Shape's members are exactly the entries
+ * of its offset table below its size.  That lets a chain of Shapes share one
+ * table: the first child of a Shape appends its member to the parent's table
+ * rather than copying it, and only a second child, branching off, copies the
+ * parent's entries into a table of its own.  Building an Object member by
+ * member thus costs O(1) per member, not a copy of every member before it.
+ *
+ * Shapes are immutable once created, and live for the rest of the program.
+ */
+
+#include "Symbol.h"
+#include "SymbolMap.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <stddef.h>
+
+namespace eval {
+
+class Shape {
+public:
+  // The shape with no members
+  static const Shape& Empty();
+
+  // The shape with member appended; created on first use
+  const Shape& withMember(symbol_id member) const;
+
+  // Offset of a member via offset; false if we have no such member
+  bool lookup(symbol_id member, size_t& offset) const {
+    const size_t* found = m_offsets->find(member);
+    if (!found || *found >= m_size) return false;
+    offset = *found;
+    return true;
+  }
+
+  size_t size() const { return m_size; }
+
+private:
+  typedef SymbolMap<size_t> offset_map;
+  typedef SymbolMap<Shape*> transition_map;
+
+  Shape()
+    : m_offsets(new offset_map()),
+      m_size(0) {}
+  Shape(const Shape& parent, symbol_id member);
+  ~Shape();
+
+  // Shared with our ancestors and descendants along one chain; may hold
+  // entries past m_size, which are our descendants' members
+  boost::shared_ptr<offset_map> m_offsets;
+  size_t m_size;
+  mutable transition_map m_transitions;
+};
+
+};
+
+#endif // _Shape_h_
@@ -48,8 +48,6 @@ bool Signature::areArgsIdentical(const Signature& rhs) const {
 // function signature.  Note that m_args is an argspec_list while rhs_args is a
 // type_list.
 bool Signature::areArgsCompatible(const type_list& rhs_args) const {
-  return m_args.size() == rhs_args.size();
-  /*
   if (m_args.size() != rhs_args.size()) return false;
   for (size_t i=0; i < m_args.size(); ++i) {
     if (!m_args.at(i).isTypeCompatible(rhs_args.at(i))) {
@@ -57,7 +55,6 @@ bool Signature::areArgsCompatible(const type_list& rhs_args) const {
     }
   }
   return true;
-  */
 }
 
 /*
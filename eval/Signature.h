@@ -19,12 +19,15 @@
 
 namespace eval {
 
+class Block;
+class CallFrame;
+
 // The specification of a function argument; part of a function signature
 // definition.
 class ArgSpec {
 public:
   ArgSpec(std::string name,
-          Type* type,
+          TypeRef type,
           Object* defaultValue,
           bool optional = false)
     : m_name(name),
@@ -32,13 +35,16 @@ public:
       //m_defaultValue(defaultValue),
       //m_optional(optional) {}
 
+  const std::string& getName() const { return m_name; }
+  TypeRef getType() const { return m_type; }
+
+  bool isTypeCompatible(const Type* rhs) const {
+    return m_type->isCompatible(*rhs);
+  }
   /*
   bool isTypeIdentical(const ArgSpec& rhs) const {
     return rhs.m_type == m_type;
   }
-  bool isTypeCompatible(const Type* rhs) const {
-    return m_type->isCompatible(rhs);
-  }
   TypeScore compatibilityScore(const Type* rhs) const {
     return m_type->compatibilityScore(rhs);
   }
@@ -46,7 +52,7 @@ public:
 
 private:
   std::string m_name;
-  Type* m_type;
+  TypeRef m_type;
   //Object* m_defaultValue;
   //bool m_optional;
 };
@@ -76,12 +82,26 @@ private:
 };
 */
 
+// C++ body of a native builtin signature.  The frame's argument slots hold
+// the caller's Objects; returns a new (or existing) Object as the result, or
+// NULL for none.
+typedef Object* (*native_fn)(Log& log, CallFrame& frame);
+
 class Signature {
 public:
-  Signature(argspec_list args, Type* returnType)
-    : m_args(args), m_returnType(returnType) {}
-
-  Type* getReturnType() const { return m_returnType; }
+  Signature(argspec_list args, TypeRef returnType, native_fn native = NULL)
+    : m_args(args), m_returnType(returnType), m_native(native), m_body(NULL) {}
+  // A function defined in shok.  The body is taken out of the AST that
+  // defined it; the Function deletes it.
+  Signature(argspec_list args, TypeRef returnType, Block& body)
+    : m_args(args), m_returnType(returnType), m_native(NULL), m_body(&body) {}
+
+  const argspec_list& getArgs() const { return m_args; }
+  TypeRef getReturnType() const { return m_returnType; }
+  // The C++ body, for a native builtin; otherwise NULL
+  native_fn getNative() const { return m_native; }
+  // The shok body, for a function defined in shok; otherwise NULL
+  Block* getBody() const { return m_body; }
 
   bool isEquivalentTo(const Signature& rhs) const;
   //bool areArgsIdentical(const Signature& rhs) const;
@@ -90,7 +110,9 @@ public:
 
 private:
   argspec_list m_args;
-  Type* m_returnType;
+  TypeRef m_returnType;
+  native_fn m_native;
+  Block* m_body;
 };
 
 };
@@ -0,0 +1,90 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "StringTable.h"
+
+#include "EvalError.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+namespace {
+  const size_t INITIAL_SLOTS = 64;
+};
+
+const StringTable::str_id StringTable::NO_ID;
+
+StringTable::StringTable()
+  : m_slots(INITIAL_SLOTS, NO_ID) {
+}
+
+StringTable::str_id StringTable::intern(const string& s) {
+  size_t slot = probe(s);
+  if (NO_ID != m_slots[slot]) return m_slots[slot];
+  str_id id = m_strings.size();
+  m_strings.push_back(s);
+  m_slots[slot] = id;
+  // Keep the load factor at most 1/2
+  if (2 * m_strings.size() > m_slots.size()) {
+    grow();
+  }
+  return id;
+}
+
+bool StringTable::find(const string& s, str_id& found) const {
+  size_t slot = probe(s);
+  if (NO_ID == m_slots[slot]) return false;
+  found = m_slots[slot];
+  return true;
+}
+
+const string& StringTable::lookup(str_id id) const {
+  if (id >= m_strings.size()) {
+    throw EvalError("String id " + boost::lexical_cast<string>(id) + " is not in the table");
+  }
+  return m_strings[id];
+}
+
+size_t StringTable::memoryUsage() const {
+  size_t bytes = m_strings.capacity() * sizeof(string) +
+                 m_slots.capacity() * sizeof(str_id);
+  for (vector<string>::const_iterator i = m_strings.begin();
+       i != m_strings.end(); ++i) {
+    bytes += i->capacity();
+  }
+  return bytes;
+}
+
+// 32-bit FNV-1a
+uint32_t StringTable::hash(const string& s) {
+  uint32_t h = 2166136261u;
+  for (string::const_iterator i = s.begin(); i != s.end(); ++i) {
+    h ^= (unsigned char)*i;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+// Linear probing
+size_t StringTable::probe(const string& s) const {
+  size_t mask = m_slots.size() - 1;
+  for (size_t slot = hash(s) & mask; ; slot = (slot + 1) & mask) {
+    if (NO_ID == m_slots[slot] || m_strings[m_slots[slot]] == s) {
+      return slot;
+    }
+  }
+}
+
+void StringTable::grow() {
+  vector<str_id> slots(m_slots.size() * 2, NO_ID);
+  m_slots.swap(slots);
+  for (str_id id = 0; id < m_strings.size(); ++id) {
+    m_slots[probe(m_strings[id])] = id;
+  }
+}
@@ -0,0 +1,54 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _StringTable_h_
+#define _StringTable_h_
+
+/* String interning table
+ *
+ * Maps each distinct string to a small dense integer id, and back.  Ids are
+ * handed out in order starting from 0 and are never reused or invalidated for
+ * the lifetime of the table, so they can be stored in place of the strings
+ * themselves and compared directly.
+ *
+ * Lookup by string is an open-addressing hash table of ids into the string
+ * vector, so each string is only stored once.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace eval {
+
+class StringTable {
+public:
+  typedef uint32_t str_id;
+
+  StringTable();
+
+  // Returns the id of s, adding it to the table if it's not already there
+  str_id intern(const std::string& s);
+  // Returns the id of s via found, or false if it has never been interned
+  bool find(const std::string& s, str_id& found) const;
+  // Returns the string for a previously-interned id
+  const std::string& lookup(str_id id) const;
+
+  size_t size() const { return m_strings.size(); }
+  // Approximate bytes used by the table
+  size_t memoryUsage() const;
+
+private:
+  static const str_id NO_ID = 0xffffffff;
+  static uint32_t hash(const std::string& s);
+  // Slot where s is, or where it would go
+  size_t probe(const std::string& s) const;
+  void grow();
+
+  std::vector<std::string> m_strings;
+  std::vector<str_id> m_slots;    // power-of-2 size; NO_ID if empty
+};
+
+};
+
+#endif // _StringTable_h_
@@ -0,0 +1,26 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Symbol.h"
+
+#include <string>
+using std::string;
+
+using namespace eval;
+
+symbol_id Symbol::Intern(const string& name) {
+  return Table().intern(name);
+}
+
+bool Symbol::Find(const string& name, symbol_id& found) {
+  return Table().find(name, found);
+}
+
+const string& Symbol::Name(symbol_id symbol) {
+  return Table().lookup(symbol);
+}
+
+StringTable& Symbol::Table() {
+  static StringTable table;
+  return table;
+}
@@ -0,0 +1,38 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Symbol_h_
+#define _Symbol_h_
+
+/* Symbols: interned identifiers
+ *
+ * Every identifier the evaluator looks up is interned once in a global
+ * StringTable and thereafter referred to by its 32-bit symbol id.  Symbol
+ * tables (see SymbolMap) are keyed by these ids, so a lookup hashes an integer
+ * and compares integers rather than walking a tree of string compares.
+ */
+
+#include "StringTable.h"
+
+#include <string>
+
+namespace eval {
+
+typedef StringTable::str_id symbol_id;
+
+class Symbol {
+public:
+  // Returns the symbol for name, creating it if need be
+  static symbol_id Intern(const std::string& name);
+  // Returns the symbol for name via found, or false if there is none.  A
+  // name that has never been interned cannot be in any symbol table.
+  static bool Find(const std::string& name, symbol_id& found);
+  static const std::string& Name(symbol_id symbol);
+
+private:
+  static StringTable& Table();
+};
+
+};
+
+#endif // _Symbol_h_
@@ -0,0 +1,142 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _SymbolMap_h_
+#define _SymbolMap_h_
+
+/* Symbol table: symbol_id -> value
+ *
+ * An open-addressing hash table with linear probing, keyed by interned symbol
+ * ids.  Keys and values live side by side in one array, so a lookup is
+ * usually a single cache line.  Symbol ids are small dense integers, so they
+ * are spread over the table with a multiplicative (Fibonacci) hash.
+ *
+ * Erased entries leave a tombstone rather than moving other entries, so
+ * erasing while walking the slots is safe; tombstones are cleared out the
+ * next time the table is rebuilt.  Walk the table with:
+ *   for (size_t s = 0; s < map.slots(); ++s) {
+ *     if (!map.isUsed(s)) continue;
+ *     ... map.keyAt(s), map.valueAt(s) ...
+ *   }
+ */
+
+#include "Symbol.h"
+
+#include <vector>
+
+namespace eval {
+
+template <class V>
+class SymbolMap {
+public:
+  SymbolMap()
+    : m_entries(INITIAL_SLOTS),
+      m_size(0),
+      m_tombstones(0) {}
+
+  // Returns a pointer to the value for key, or NULL if it is not here
+  V* find(symbol_id key) {
+    size_t slot = probe(key);
+    return key == m_entries[slot].key ? &m_entries[slot].value : NULL;
+  }
+  const V* find(symbol_id key) const {
+    size_t slot = probe(key);
+    return key == m_entries[slot].key ? &m_entries[slot].value : NULL;
+  }
+
+  // Returns false (and changes nothing) if key is already present
+  bool insert(symbol_id key, const V& value) {
+    // Keep live entries plus tombstones at most 1/2 of the table; rebuilding
+    // clears the tombstones, and grows if live entries are over 1/4
+    if (2 * (m_size + m_tombstones + 1) > m_entries.size()) {
+      size_t slots = m_entries.size();
+      while (4 * (m_size + 1) > slots) {
+        slots *= 2;
+      }
+      rebuild(slots);
+    }
+    size_t slot = probe(key);
+    if (key == m_entries[slot].key) return false;
+    if (TOMBSTONE == m_entries[slot].key) --m_tombstones;
+    m_entries[slot].key = key;
+    m_entries[slot].value = value;
+    ++m_size;
+    return true;
+  }
+
+  // Returns false if key was not present
+  bool erase(symbol_id key) {
+    size_t slot = probe(key);
+    if (key != m_entries[slot].key) return false;
+    m_entries[slot].key = TOMBSTONE;
+    m_entries[slot].value = V();
+    --m_size;
+    ++m_tombstones;
+    return true;
+  }
+
+  void clear() {
+    m_entries.assign(INITIAL_SLOTS, Entry());
+    m_size = 0;
+    m_tombstones = 0;
+  }
+
+  size_t size() const { return m_size; }
+  bool empty() const { return 0 == m_size; }
+
+  // Slot-wise access, for walking the table
+  size_t slots() const { return m_entries.size(); }
+  bool isUsed(size_t slot) const { return m_entries[slot].key < TOMBSTONE; }
+  symbol_id keyAt(size_t slot) const { return m_entries[slot].key; }
+  const V& valueAt(size_t slot) const { return m_entries[slot].value; }
+
+private:
+  static const symbol_id EMPTY = 0xffffffff;
+  static const symbol_id TOMBSTONE = 0xfffffffe;
+  static const size_t INITIAL_SLOTS = 8;   // must be a power of 2
+
+  struct Entry {
+    Entry()
+      : key(EMPTY), value() {}
+    symbol_id key;
+    V value;
+  };
+  typedef std::vector<Entry> entry_vec;
+
+  static size_t hash(symbol_id key, size_t mask) {
+    return (size_t)(key * 2654435769u) & mask;
+  }
+
+  // Slot holding key if it is present; otherwise the slot it should go in
+  // (the first tombstone passed, or the empty slot that ended the search)
+  size_t probe(symbol_id key) const {
+    size_t mask = m_entries.size() - 1;
+    size_t found = m_entries.size();
+    for (size_t slot = hash(key, mask); ; slot = (slot + 1) & mask) {
+      symbol_id k = m_entries[slot].key;
+      if (key == k) return slot;
+      if (EMPTY == k) return found < m_entries.size() ? found : slot;
+      if (TOMBSTONE == k && found == m_entries.size()) found = slot;
+    }
+  }
+
+  void rebuild(size_t slots) {
+    entry_vec entries(slots);
+    entries.swap(m_entries);
+    m_tombstones = 0;
+    for (typename entry_vec::const_iterator i = entries.begin();
+         i != entries.end(); ++i) {
+      if (i->key < TOMBSTONE) {
+        m_entries[probe(i->key)] = *i;
+      }
+    }
+  }
+
+  entry_vec m_entries;
+  size_t m_size;
+  size_t m_tombstones;
+};
+
+};
+
+#endif // _SymbolMap_h_
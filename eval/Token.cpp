@@ -26,9 +26,12 @@ Tokenizer::token_vec Tokenizer::tokenize(Log& log, const string& ast) {
   bool escape = false;    // only \ escape is supported
   bool inToken = false;
   bool inValue = false;
+  bool inQuote = false;   // between the quotes of a Value
   for (int i=0; i < ast.length(); ++i) {
     char c = ast[i];
-    log.debug(" - tokenizing char '" + string(1, c) + "'");
+    if (log.isDebug()) {
+      log.debug(" - tokenizing char '" + string(1, c) + "'");
+    }
     switch (mode) {
     case MODE_NONE:
       if (inToken || inValue) {
@@ -82,6 +85,8 @@ Tokenizer::token_vec Tokenizer::tokenize(Log& log, const string& ast) {
         escape = false;
       } else if ('\\' == c && inValue) {
         escape = true;
+      } else if (inQuote && '\'' != c) {
+        current.value += c;
       } else if ('}' == c) {
         if (inToken) {
           v.push_back(current);
@@ -121,20 +126,16 @@ Tokenizer::token_vec Tokenizer::tokenize(Log& log, const string& ast) {
         }
       // A Value must be between single-quotes after the : separator
       } else if ('\'' == c && inValue) {
-        if (current.value != "") {
+        if (inQuote) {
+          // end of the value, which may be empty
           v.push_back(current);
           current = Token();
           inToken = false;
           inValue = false;
+          inQuote = false;
         } else if (i >= 1 && ':' == ast[i-1]) {
           // start of actual value; skip
-        } else if (i >= 2 && '\'' == ast[i-1] && ':' == ast[i-2]) {
-          // empty value.  strange but ok.
-          log.info("Found token with :'' empty value");
-          v.push_back(current);
-          current = Token();
-          inToken = false;
-          inValue = false;
+          inQuote = true;
         } else {
           throw EvalError("Unexpected single-quote in CODE Value");
         }
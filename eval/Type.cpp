@@ -3,24 +3,153 @@
 
 #include "Type.h"
 
+#include "Object.h"
+
+#include <boost/unordered_map.hpp>
+
 #include <algorithm>
+#include <map>
 #include <string>
-using std::auto_ptr;
 using std::string;
 
 using namespace eval;
 
+/* Type */
+
+namespace {
+  // The intern table: canonical Type for each Key.  Entries do not hold a
+  // reference; a Type removes itself when its last TypeRef is released.
+  typedef std::map<Type::Key, const Type*> type_map;
+  type_map& Interned() {
+    static type_map types;
+    return types;
+  }
+  uint32_t g_nextId = 1;
+
+  // Memoized isCompatible() results, keyed by the pair of canonical ids.
+  // Entries for Types that have since been released are unreachable (ids are
+  // not reused), so we just start over if the table gets too big.
+  typedef boost::unordered_map<uint64_t, bool> compatible_map;
+  compatible_map& Compatible() {
+    static compatible_map compatible;
+    return compatible;
+  }
+  const size_t MAX_COMPATIBLE = 1 << 16;
+
+  Type::BACKEND g_backend = Type::DEFAULT_BACKEND;
+};
+
+void Type::SetBackend(BACKEND backend) {
+  if (backend != g_backend) {
+    Compatible().clear();
+  }
+  g_backend = backend;
+}
+
+void Type::SetBackend(const string& backend) {
+  if ("tree" == backend) {
+    SetBackend(BACKEND_TREE);
+  } else if ("bitset" == backend) {
+    SetBackend(BACKEND_BITSET);
+  } else {
+    throw EvalError("Cannot set unknown Type backend '" + backend + "'");
+  }
+}
+
+bool Type::isCompatible(const Type& rhs) const {
+  uint64_t key = ((uint64_t)m_id << 32) | rhs.m_id;
+  compatible_map::const_iterator i = Compatible().find(key);
+  if (Compatible().end() != i) return i->second;
+  bool compatible = BACKEND_BITSET == g_backend ? checkNormalized(rhs)
+                                                : checkCompatible(rhs);
+  if (Compatible().size() >= MAX_COMPATIBLE) {
+    Compatible().clear();
+  }
+  Compatible().insert(compatible_map::value_type(key, compatible));
+  return compatible;
+}
+
+const ObjectSet& Type::requirement() const {
+  if (!m_isNormalized) computeNormalized();
+  return m_requirement;
+}
+
+const Type::conjunction_vec& Type::conjunctions() const {
+  if (!m_isNormalized) computeNormalized();
+  return m_conjunctions;
+}
+
+void Type::computeNormalized() const {
+  ObjectSet requirement;
+  conjunction_vec conjunctions;
+  normalize(requirement, conjunctions);
+  m_requirement = requirement;
+  m_conjunctions.swap(conjunctions);
+  m_isNormalized = true;
+}
+
+bool Type::checkNormalized(const Type& rhs) const {
+  if (isNull()) {
+    throw EvalError("NullType cannot be checked for compatibility");
+  }
+  const ObjectSet& required = requirement();
+  const conjunction_vec& rhsConjunctions = rhs.conjunctions();
+  for (conjunction_iter i = rhsConjunctions.begin();
+       i != rhsConjunctions.end(); ++i) {
+    if (!required.intersects(*i)) return false;
+  }
+  return true;
+}
+
+void Type::GetInterned(std::vector<const Type*>& types) {
+  for (type_map::const_iterator i = Interned().begin();
+       i != Interned().end(); ++i) {
+    types.push_back(i->second);
+  }
+}
+
+const Type* Type::Find(const Key& key) {
+  type_map::const_iterator i = Interned().find(key);
+  if (Interned().end() == i) return NULL;
+  return i->second;
+}
+
+TypeRef Type::Intern(const Type* type) {
+  if (!Interned().insert(type_map::value_type(type->key(), type)).second) {
+    string desc = type->print();
+    delete type;
+    throw EvalError("Type " + desc + " has already been interned");
+  }
+  Type* t = const_cast<Type*>(type);
+  t->m_id = g_nextId++;
+  t->m_interned = true;
+  return TypeRef(type);
+}
+
+void Type::Release(const Type* type) {
+  if (type->m_interned) {
+    Interned().erase(type->key());
+  }
+  delete type;
+}
+
 /* NullType */
 
+TypeRef NullType::Get() {
+  const Type* type = Find(Key(KIND_NULL));
+  if (type) return TypeRef(type);
+  return Intern(new NullType());
+}
+
 Object* NullType::getMember(const string& name) const {
   return NULL;
 }
 
-auto_ptr<Type> NullType::getMemberType(const string& name) const {
-  return auto_ptr<Type>(NULL);
+TypeRef NullType::getMemberType(const string& name) const {
+  return TypeRef();
 }
 
-bool NullType::isCompatible(const Type& rhs) const {
+bool NullType::checkCompatible(const Type& rhs) const {
   throw EvalError("NullType cannot be checked for compatibility");
 }
 
@@ -30,8 +159,10 @@ TypeScore NullType::compatibilityScore(const Type& rhs, TypeScore score) const {
 }
 */
 
-auto_ptr<Type> NullType::duplicate() const {
-  throw EvalError("Cannot duplicate the root type");
+// The root type requires nothing, and as a value is nothing in particular
+void NullType::normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const {
+  conjunctions.push_back(ObjectSet());
 }
 
 string NullType::print() const {
@@ -40,19 +171,38 @@ string NullType::print() const {
 
 /* BasicType */
 
+TypeRef BasicType::Get(const Object& o) {
+  const Type* type = Find(Key(KIND_BASIC, &o));
+  if (type) return TypeRef(type);
+  return Intern(new BasicType(o));
+}
+
+BasicType::BasicType(const Object& o)
+  : m_object(o) {
+  m_object.retain();
+}
+
+BasicType::~BasicType() {
+  m_object.release();
+}
+
+void BasicType::references(HeapRefs& refs) const {
+  refs.objects.push_back(&m_object);
+}
+
 Object* BasicType::getMember(const string& name) const {
   return m_object.getMember(name);
 }
 
-auto_ptr<Type> BasicType::getMemberType(const string& name) const {
+TypeRef BasicType::getMemberType(const string& name) const {
   Object* member = m_object.getMember(name);
   if (!member) {
-    return auto_ptr<Type>(NULL);
+    return TypeRef();
   }
-  return member->getType().duplicate();
+  return TypeRef(&member->getType());
 }
 
-bool BasicType::isCompatible(const Type& rhs) const {
+bool BasicType::checkCompatible(const Type& rhs) const {
   // For compatibility, rhs could be either:
   //  - a BasicType of a descendent of our Object
   //  - an AndType where one of the children is compatible
@@ -60,19 +210,19 @@ bool BasicType::isCompatible(const Type& rhs) const {
   // In the AndType case, no more than one of the children should be
   // compatible, but this should have been enforced by the AndType's
   // construction, so we don't need to check it here.
+  if (&rhs == this) return true;
   const BasicType* basicType = dynamic_cast<const BasicType*>(&rhs);
   const AndType* andType = dynamic_cast<const AndType*>(&rhs);
   const OrType* orType = dynamic_cast<const OrType*>(&rhs);
   if (basicType) {
-    if (&basicType->m_object == &m_object) return true;
     if (basicType->m_object.getType().isNull()) return false;
-    return basicType->m_object.getType().isCompatible(rhs);
+    return isCompatible(basicType->m_object.getType());
   } else if (andType) {
-    return andType->left().isCompatible(rhs) ||
-           andType->right().isCompatible(rhs);
+    return isCompatible(andType->left()) ||
+           isCompatible(andType->right());
   } else if (orType) {
-    return orType->left().isCompatible(rhs) &&
-           orType->right().isCompatible(rhs);
+    return isCompatible(orType->left()) &&
+           isCompatible(orType->right());
   }
   throw EvalError("Cannot check compatibility for unknown Type " + rhs.print());
 }
@@ -98,8 +248,20 @@ TypeScore BasicType::compatibilityScore(const Type& rhs,
 }
 */
 
-auto_ptr<Type> BasicType::duplicate() const {
-  return auto_ptr<Type>(new BasicType(m_object));
+// A value of our Object is our Object and everything its parents are
+void BasicType::normalize(ObjectSet& requirement,
+                          conjunction_vec& conjunctions) const {
+  requirement.insert(m_object.id());
+  const Type& parents = m_object.getType();
+  if (parents.isNull()) {
+    conjunctions.push_back(ObjectSet());
+  } else {
+    conjunctions = parents.conjunctions();
+  }
+  for (conjunction_vec::iterator i = conjunctions.begin();
+       i != conjunctions.end(); ++i) {
+    i->insert(m_object.id());
+  }
 }
 
 string BasicType::print() const {
@@ -108,6 +270,19 @@ string BasicType::print() const {
 
 /* AndType */
 
+TypeRef AndType::Get(const TypeRef& left, const TypeRef& right) {
+  if (!left.get() || !right.get()) {
+    throw EvalError("Cannot create an AndType of a missing Type");
+  }
+  // a&b is b&a; intern them as one Type, with the lower id on the left
+  if (left->id() > right->id()) {
+    return Get(right, left);
+  }
+  const Type* type = Find(Key(KIND_AND, left.get(), right.get()));
+  if (type) return TypeRef(type);
+  return Intern(new AndType(left, right));
+}
+
 Object* AndType::getMember(const string& name) const {
   // It should only exist in one of the children, but that should have been
   // enforced at construction.
@@ -116,16 +291,14 @@ Object* AndType::getMember(const string& name) const {
   return m_right->getMember(name);
 }
 
-auto_ptr<Type> AndType::getMemberType(const string& name) const {
-  if (!m_left.get() || !m_right.get()) {
-    throw EvalError("Cannot get member type of deficient AndType " + print());
-  }
-  auto_ptr<Type> type(m_left->getMemberType(name));
+TypeRef AndType::getMemberType(const string& name) const {
+  TypeRef type(m_left->getMemberType(name));
   if (type.get()) return type;
   return m_right->getMemberType(name);
 }
 
-bool AndType::isCompatible(const Type& rhs) const {
+bool AndType::checkCompatible(const Type& rhs) const {
+  if (&rhs == this) return true;
   const BasicType* basicType = dynamic_cast<const BasicType*>(&rhs);
   const AndType* andType = dynamic_cast<const AndType*>(&rhs);
   const OrType* orType = dynamic_cast<const OrType*>(&rhs);
@@ -136,15 +309,15 @@ bool AndType::isCompatible(const Type& rhs) const {
   } else if (andType) {
     // A&B <=> C&D ?  (C or D matches A) or (C or D matches B)
     return m_left->isCompatible(andType->left()) ||
-           m_right->isCompatible(andType->right()) ||
-           m_left->isCompatible(andType->left()) ||
+           m_left->isCompatible(andType->right()) ||
+           m_right->isCompatible(andType->left()) ||
            m_right->isCompatible(andType->right());
   } else if (orType) {
     // A&B <=> C|D ?  (C matches A or B) and (D matches A or B)
-    return (m_left->isCompatible(andType->left()) ||
-            m_right->isCompatible(andType->left())) &&
-           (m_left->isCompatible(andType->right()) ||
-            m_right->isCompatible(andType->right()));
+    return (m_left->isCompatible(orType->left()) ||
+            m_right->isCompatible(orType->left())) &&
+           (m_left->isCompatible(orType->right()) ||
+            m_right->isCompatible(orType->right()));
   }
   throw EvalError("Cannot check compatibility for unknown Type " + rhs.print());
 }
@@ -173,23 +346,48 @@ TypeScore AndType::compatibilityScore(const Type& rhs, TypeScore score) const {
 }
 */
 
-auto_ptr<Type> AndType::duplicate() const {
-  if (!m_left.get() || !m_right.get()) {
-    throw EvalError("Cannot duplicate deficient AndType " + print());
+void AndType::normalize(ObjectSet& requirement,
+                        conjunction_vec& conjunctions) const {
+  requirement.merge(m_left->requirement());
+  requirement.merge(m_right->requirement());
+  const conjunction_vec& left = m_left->conjunctions();
+  const conjunction_vec& right = m_right->conjunctions();
+  for (conjunction_iter l = left.begin(); l != left.end(); ++l) {
+    for (conjunction_iter r = right.begin(); r != right.end(); ++r) {
+      conjunctions.push_back(*l);
+      conjunctions.back().merge(*r);
+    }
   }
-  return auto_ptr<Type>(new AndType(*m_left.get(), *m_right.get()));
 }
 
 string AndType::print() const {
   return "&(" + m_left->print() + "," + m_right->print() + ")";
 }
 
+void AndType::references(HeapRefs& refs) const {
+  refs.types.push_back(m_left.get());
+  refs.types.push_back(m_right.get());
+}
+
 /* OrType */
 
-auto_ptr<Type> OrType::OrUnion(const Type& a, const Type& b) {
-  if (a.isCompatible(b)) return a.duplicate();
-  if (b.isCompatible(a)) return b.duplicate();
-  return auto_ptr<Type>(new OrType(a, b));
+TypeRef OrType::OrUnion(const TypeRef& a, const TypeRef& b) {
+  if (a->isCompatible(*b)) return a;
+  if (b->isCompatible(*a)) return b;
+  return Get(a, b);
+}
+
+TypeRef OrType::Get(const TypeRef& left, const TypeRef& right) {
+  if (!left.get() || !right.get()) {
+    throw EvalError("Cannot create an OrType of a missing Type");
+  }
+  // a|b is b|a; intern them as one Type, with the lower id on the left
+  if (left->id() > right->id()) {
+    return Get(right, left);
+  }
+  const Type* type = Find(Key(KIND_OR, left.get(), right.get()));
+  if (type) return TypeRef(type);
+  return Intern(new OrType(left, right));
 }
 
 Object* OrType::getMember(const string& name) const {
@@ -197,21 +395,19 @@ Object* OrType::getMember(const string& name) const {
   throw EvalError("Cannot request member " + name + " from OrType " + print());
 }
 
-auto_ptr<Type> OrType::getMemberType(const string& name) const {
+TypeRef OrType::getMemberType(const string& name) const {
   // It must exist in both children.  We return the best |-union of the member
   // types.
-  if (!m_left.get() || !m_right.get()) {
-    throw EvalError("Cannot get member type of deficient OrType " + print());
-  }
-  auto_ptr<Type> leftType(m_left->getMemberType(name));
-  auto_ptr<Type> rightType(m_right->getMemberType(name));
+  TypeRef leftType(m_left->getMemberType(name));
+  TypeRef rightType(m_right->getMemberType(name));
   if (!leftType.get() || !rightType.get()) {
     throw EvalError("A child of OrType " + print() + " has a deficient Type.");
   }
-  return OrUnion(*leftType.get(), *rightType.get());
+  return OrUnion(leftType, rightType);
 }
 
-bool OrType::isCompatible(const Type& rhs) const {
+bool OrType::checkCompatible(const Type& rhs) const {
+  if (&rhs == this) return true;
   const BasicType* basicType = dynamic_cast<const BasicType*>(&rhs);
   const AndType* andType = dynamic_cast<const AndType*>(&rhs);
   const OrType* orType = dynamic_cast<const OrType*>(&rhs);
@@ -226,11 +422,9 @@ bool OrType::isCompatible(const Type& rhs) const {
            m_right->isCompatible(andType->left()) ||
            m_right->isCompatible(andType->right());
   } else if (orType) {
-    // A|B <=> C|D ?  (C and D match A) or (C and D match B)
-    return (m_left->isCompatible(orType->left()) &&
-            m_left->isCompatible(orType->right())) ||
-           (m_right->isCompatible(orType->left()) &&
-            m_right->isCompatible(orType->right()));
+    // A|B <=> C|D ?  (C matches A or B) and (D matches A or B)
+    return isCompatible(orType->left()) &&
+           isCompatible(orType->right());
   }
   throw EvalError("Cannot check compatibility for unknown Type " + rhs.print());
 }
@@ -258,14 +452,21 @@ TypeScore OrType::compatibilityScore(const Type& rhs, TypeScore score) const {
 }
 */
 
-auto_ptr<Type> OrType::duplicate() const {
-  if (!m_left.get() || !m_right.get()) {
-    throw EvalError("Cannot duplicate deficient OrType " + print());
-  }
-  return auto_ptr<Type>(new OrType(*m_left.get(), *m_right.get()));
+void OrType::normalize(ObjectSet& requirement,
+                       conjunction_vec& conjunctions) const {
+  requirement.merge(m_left->requirement());
+  requirement.merge(m_right->requirement());
+  const conjunction_vec& left = m_left->conjunctions();
+  const conjunction_vec& right = m_right->conjunctions();
+  conjunctions.insert(conjunctions.end(), left.begin(), left.end());
+  conjunctions.insert(conjunctions.end(), right.begin(), right.end());
 }
 
 string OrType::print() const {
-  if (!m_left.get() || !m_right.get()) return "|(uninitialized)";
   return "|(" + m_left->print() + "," + m_right->print() + ")";
 }
+
+void OrType::references(HeapRefs& refs) const {
+  refs.types.push_back(m_left.get());
+  refs.types.push_back(m_right.get());
+}
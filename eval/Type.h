@@ -9,9 +9,35 @@
  * A Type is a binary tree, where each node is either an OrList of nodes, an
  * AndList of nodes, or an Object*.
  *
- * We do not own these Object*s; the Object should always outlive a child's
- * Type.  Types are typically owned by a TypedNode, which can give you its
- * Type or a duplicate with its getType() or type() methods.
+ * A BasicType holds a reference to its Object (see Heap), so the Object
+ * always outlives the Type.
+ *
+ * Types are immutable and hash-consed: they can only be obtained from the
+ * Get() factories, which return the one canonical instance of each
+ * structurally distinct type.  So two Types are equal exactly when they are
+ * the same Type, and passing types around never copies a tree.  Types are
+ * reference-counted by TypeRef handles, and are forgotten once the last
+ * handle goes away.
+ *
+ * Each interned Type also gets a canonical id, which is never reused.
+ * isCompatible() memoizes its answers by the pair of ids, so repeated checks
+ * (overload resolution, assignment) are a single hash lookup.  The parents of
+ * an Object never change, and an Object cannot be destroyed before its
+ * BasicType, so the memo never needs invalidating.
+ *
+ * There are two backends for the (uncached) check.  BACKEND_TREE recurses
+ * through the And/Or trees.  BACKEND_BITSET normalizes each Type once, on
+ * first use, into two ObjectSet forms:
+ *  - as a requirement (the lhs of isCompatible): the set of objects any one
+ *    of which a value must descend from.  Both & and | on the lhs are
+ *    satisfied by matching either side.
+ *  - as a value (the rhs): a disjunction of conjunctions, where each
+ *    conjunction is every object, with all its ancestors, that the value is
+ *    at once.  & takes the cross product of its sides' conjunctions; | just
+ *    collects them.
+ * A rhs is compatible if every one of its conjunctions intersects the lhs's
+ * requirement set, which is a few word-parallel ANDs per conjunction rather
+ * than a walk over both trees.
  *
  * A Type can be used to query the members of its underlying object(s), or just
  * their types.  Note that some of the semantics of |-types and &-types are not
@@ -19,16 +45,19 @@
  */
 
 #include "EvalError.h"
+#include "Heap.h"
 #include "Log.h"
-#include "Object.h"
+#include "ObjectSet.h"
 
 #include <limits.h>
-#include <memory>
+#include <stdint.h>
 #include <string>
+#include <vector>
 
 namespace eval {
 
 class Object;
+class TypeRef;
 
 /* A measure of how compatible two types are. */
 /*
@@ -80,14 +109,13 @@ public:
   // Query directly for the Type of a member of the underlying object(s).
   // Use this if you're just doing type-checking analysis rather than
   // retrieving the Object* itself, please.
-  // Caller gets a duplicate (takes ownership) because in the case of OrType,
-  // it might need to create a brand new type to represent this.
+  // Returns a NULL TypeRef if there is no such member.
   // Note that for a function member (method), the type is the type of this
   // method, e.g. @(A)->B, and not just the (set of) return type(s).
-  virtual std::auto_ptr<Type> getMemberType(const std::string& name) const = 0;
+  virtual TypeRef getMemberType(const std::string& name) const = 0;
 
   // Checks if the provided Type is a compatible subtype of this Type
-  virtual bool isCompatible(const Type& rhs) const = 0;
+  bool isCompatible(const Type& rhs) const;
 
   /*
   virtual bool isCompatible(const Type& rhs) const {
@@ -101,90 +129,233 @@ public:
     const Type& rhs, TypeScore initialScore = 0) const = 0;
   */
 
-  // Returns a duplicate of the Type.  Caller takes ownership.
-  virtual std::auto_ptr<Type> duplicate() const = 0;
   virtual std::string print() const = 0;
   virtual bool isNull() const { return false; }
+
+  // Canonical id; unique among all Types ever interned
+  uint32_t id() const { return m_id; }
+
+  // Which implementation isCompatible() uses for cache misses
+  enum BACKEND {
+    BACKEND_TREE,
+    BACKEND_BITSET,
+  };
+  static const BACKEND DEFAULT_BACKEND = BACKEND_TREE;
+  static void SetBackend(BACKEND backend);
+  static void SetBackend(const std::string& backend);
+
+  // Normalized forms for BACKEND_BITSET; see above
+  typedef std::vector<ObjectSet> conjunction_vec;
+  typedef conjunction_vec::const_iterator conjunction_iter;
+  const ObjectSet& requirement() const;
+  const conjunction_vec& conjunctions() const;
+
+  // For Heap::Collect(): our reference count, and what we refer to
+  unsigned int refs() const { return m_refs; }
+  virtual void references(HeapRefs& refs) const {}
+  // Every Type currently interned
+  static void GetInterned(std::vector<const Type*>& types);
+
+  // Identity of a Type in the intern table: its kind, plus the Object or the
+  // (canonical) child Types it was built from.  & and | are commutative, so
+  // their children are keyed in id order.
+  enum KIND {
+    KIND_NULL,
+    KIND_BASIC,
+    KIND_AND,
+    KIND_OR,
+  };
+  struct Key {
+    Key(KIND kind, const void* a = NULL, const void* b = NULL)
+      : kind(kind), a(a), b(b) {}
+    bool operator<(const Key& rhs) const {
+      if (kind != rhs.kind) return kind < rhs.kind;
+      if (a != rhs.a) return a < rhs.a;
+      return b < rhs.b;
+    }
+    KIND kind;
+    const void* a;
+    const void* b;
+  };
+
+protected:
+  friend class TypeRef;
+
+  Type()
+    : m_refs(0), m_id(0), m_interned(false), m_isNormalized(false) {}
+  virtual Key key() const = 0;
+  // The uncached compatibility check, for isCompatible()
+  virtual bool checkCompatible(const Type& rhs) const = 0;
+
+  // Computes our normalized forms for BACKEND_BITSET
+  virtual void normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const = 0;
+  bool checkNormalized(const Type& rhs) const;
+
+  // Returns the canonical Type for key, or NULL if there is none yet
+  static const Type* Find(const Key& key);
+  // Record a newly-constructed Type as the canonical one for its key
+  static TypeRef Intern(const Type* type);
+
+private:
+  // Called by TypeRef when the last handle to type goes away
+  static void Release(const Type* type);
+
+  // Types are shared and immutable
+  Type(const Type&);
+  Type& operator=(const Type&);
+
+  mutable unsigned int m_refs;
+  uint32_t m_id;
+  bool m_interned;
+
+  // Computed on first use by the bitset backend
+  void computeNormalized() const;
+  mutable bool m_isNormalized;
+  mutable ObjectSet m_requirement;
+  mutable conjunction_vec m_conjunctions;
+};
+
+// Reference-counted handle to a canonical Type.  Compares by identity, which
+// for interned Types is structural equality.
+class TypeRef {
+public:
+  TypeRef()
+    : m_type(NULL) {}
+  explicit TypeRef(const Type* type)
+    : m_type(type) { acquire(); }
+  TypeRef(const TypeRef& rhs)
+    : m_type(rhs.m_type) { acquire(); }
+  ~TypeRef() { release(); }
+
+  TypeRef& operator=(const TypeRef& rhs) {
+    if (rhs.m_type != m_type) {
+      rhs.acquire();
+      release();
+      m_type = rhs.m_type;
+    }
+    return *this;
+  }
+
+  const Type* get() const { return m_type; }
+  const Type& operator*() const { return *m_type; }
+  const Type* operator->() const { return m_type; }
+  bool operator==(const TypeRef& rhs) const { return m_type == rhs.m_type; }
+  bool operator!=(const TypeRef& rhs) const { return m_type != rhs.m_type; }
+
+private:
+  void acquire() const {
+    if (m_type) ++m_type->m_refs;
+  }
+  void release() {
+    if (m_type && 0 == --m_type->m_refs) {
+      Type::Release(m_type);
+    }
+    m_type = NULL;
+  }
+
+  const Type* m_type;
 };
 
 // NullType is the Type of stdlib::object, the root of all objects.
 class NullType : public Type {
 public:
-  NullType() {}
+  static TypeRef Get();
+
   virtual Object* getMember(const std::string& name) const;
-  virtual std::auto_ptr<Type> getMemberType(const std::string& name) const;
-  virtual bool isCompatible(const Type& rhs) const;
+  virtual TypeRef getMemberType(const std::string& name) const;
   /*
   virtual TypeScore compatibilityScore(
     const Type& rhs, TypeScore initialScore = 0) const;
   */
-  virtual std::auto_ptr<Type> duplicate() const;
   virtual std::string print() const;
   virtual bool isNull() const { return true; }
+
+private:
+  NullType() {}
+  virtual Key key() const { return Key(KIND_NULL); }
+  virtual bool checkCompatible(const Type& rhs) const;
+  virtual void normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const;
 };
 
 // A BasicType wraps a single Object.  Note that a Variable's Type will be the
 // BasicType of its Object, whereas an Object's Type represents its parents.
 class BasicType : public Type {
 public:
-  BasicType(const Object& o)
-    : m_object(o) {}
+  static TypeRef Get(const Object& o);
+
   virtual Object* getMember(const std::string& name) const;
-  virtual std::auto_ptr<Type> getMemberType(const std::string& name) const;
-  virtual bool isCompatible(const Type& rhs) const;
+  virtual TypeRef getMemberType(const std::string& name) const;
   /*
   virtual TypeScore compatibilityScore(
     const Type& rhs, TypeScore initialScore = 0) const;
   */
-  virtual std::auto_ptr<Type> duplicate() const;
   virtual std::string print() const;
+  virtual void references(HeapRefs& refs) const;
 private:
+  BasicType(const Object& o);
+  virtual ~BasicType();
+  virtual Key key() const { return Key(KIND_BASIC, &m_object); }
+  virtual bool checkCompatible(const Type& rhs) const;
+  virtual void normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const;
   const Object& m_object;
 };
 
 // AndType:  a&b
 class AndType : public Type {
 public:
-  AndType(const Type& left, const Type& right)
-    : m_left(left.duplicate()), m_right(right.duplicate()) {}
-  const Type& left() const { return *m_left.get(); }    // must exist
-  const Type& right() const { return *m_right.get(); }  // must exist
+  static TypeRef Get(const TypeRef& left, const TypeRef& right);
+
+  const Type& left() const { return *m_left; }    // must exist
+  const Type& right() const { return *m_right; }  // must exist
   virtual Object* getMember(const std::string& name) const;
-  virtual std::auto_ptr<Type> getMemberType(const std::string& name) const;
-  virtual bool isCompatible(const Type& rhs) const;
+  virtual TypeRef getMemberType(const std::string& name) const;
   /*
   virtual TypeScore compatibilityScore(
     const Type& rhs, TypeScore initialScore = 0) const;
   */
-  virtual std::auto_ptr<Type> duplicate() const;
   virtual std::string print() const;
+  virtual void references(HeapRefs& refs) const;
 private:
-  std::auto_ptr<Type> m_left;
-  std::auto_ptr<Type> m_right;
+  AndType(const TypeRef& left, const TypeRef& right)
+    : m_left(left), m_right(right) {}
+  virtual Key key() const { return Key(KIND_AND, m_left.get(), m_right.get()); }
+  virtual bool checkCompatible(const Type& rhs) const;
+  virtual void normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const;
+  TypeRef m_left;
+  TypeRef m_right;
 };
 
 // OrType:  a|b
 class OrType : public Type {
 public:
   // Perform the best |-union of two Types
-  static std::auto_ptr<Type> OrUnion(const Type& a, const Type& b);
+  static TypeRef OrUnion(const TypeRef& a, const TypeRef& b);
+
+  static TypeRef Get(const TypeRef& left, const TypeRef& right);
 
-  OrType(const Type& left, const Type& right)
-    : m_left(left.duplicate()), m_right(right.duplicate()) {}
-  const Type& left() const { return *m_left.get(); }
-  const Type& right() const { return *m_right.get(); }
+  const Type& left() const { return *m_left; }
+  const Type& right() const { return *m_right; }
   virtual Object* getMember(const std::string& name) const;
-  virtual std::auto_ptr<Type> getMemberType(const std::string& name) const;
-  virtual bool isCompatible(const Type& rhs) const;
+  virtual TypeRef getMemberType(const std::string& name) const;
   /*
   virtual TypeScore compatibilityScore(
     const Type& rhs, TypeScore initialScore = 0) const;
   */
-  virtual std::auto_ptr<Type> duplicate() const;
   virtual std::string print() const;
+  virtual void references(HeapRefs& refs) const;
 private:
-  std::auto_ptr<Type> m_left;
-  std::auto_ptr<Type> m_right;
+  OrType(const TypeRef& left, const TypeRef& right)
+    : m_left(left), m_right(right) {}
+  virtual Key key() const { return Key(KIND_OR, m_left.get(), m_right.get()); }
+  virtual bool checkCompatible(const Type& rhs) const;
+  virtual void normalize(ObjectSet& requirement,
+                         conjunction_vec& conjunctions) const;
+  TypeRef m_left;
+  TypeRef m_right;
 };
 
 };
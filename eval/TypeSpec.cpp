@@ -15,11 +15,6 @@ void TypeSpec::setup() {
   if (children.size() != 1) {
     throw EvalError("TypeSpec must wrap a single expression fragment");
   }
-
-  Operator* op = dynamic_cast<Operator*>(children.at(0));
-  if (op) {
-    op->analyzeTree();
-  }
   computeType();
 }
 
@@ -7,8 +7,8 @@
 /* Type specifier
  *
  * This is like Expression except instead of wrapping any general expression,
- * it wraps an expression that we intend to use only for its Type.  At setup()
- * time we reorder and validate the operator tree just like an Expression.
+ * it wraps an expression that we intend to use only for its Type.  It is an
+ * OperatorParser, and builds its operator tree just like an Expression.
  * Then we extract the Type of the expression and delete all the Nodes to block
  * them from ever being evaluated.
  *
@@ -18,6 +18,7 @@
  */
 
 #include "Log.h"
+#include "OperatorParser.h"
 #include "RootNode.h"
 #include "Token.h"
 #include "TypedNode.h"
@@ -26,10 +27,11 @@
 
 namespace eval {
 
-class TypeSpec : public TypedNode {
+class TypeSpec : public TypedNode, public OperatorParser {
 public:
   TypeSpec(Log& log, RootNode*const root, const Token& token)
-    : TypedNode(log, root, token) {}
+    : TypedNode(log, root, token),
+      OperatorParser(log) {}
   virtual void setup();
   virtual void evaluate();
 
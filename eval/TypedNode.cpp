@@ -3,22 +3,23 @@
 
 #include "TypedNode.h"
 
-#include <memory>
-using std::auto_ptr;
-
 using namespace eval;
 
-// Returns a duplicate of m_type; caller must take ownership
-auto_ptr<Type> TypedNode::getType() const {
+TypeRef TypedNode::getType() const {
   if (!m_type.get()) {
     throw EvalError("Cannot get Type of TypedNode " + print() + " before it has been computed");
   }
-  return m_type->duplicate();
+  return m_type;
+}
+
+const Value& TypedNode::getValue() const {
+  static const Value none;
+  return none;
 }
 
 const Type& TypedNode::type() const {
   if (!m_type.get()) {
     throw EvalError("Cannot refer to Type of TypedNode " + print() + " before it has been computed");
   }
-  return *m_type.get();
+  return *m_type;
 }
@@ -15,8 +15,7 @@
 #include "RootNode.h"
 #include "Token.h"
 #include "Type.h"
-
-#include <memory>
+#include "Value.h"
 
 namespace eval {
 
@@ -24,18 +23,22 @@ class TypedNode : public Node {
 public:
   TypedNode(Log& log, RootNode*const root, const Token& token)
     : Node(log, root, token),
-      m_type(NULL) {}
+      m_type() {}
   virtual ~TypedNode() {}
 
-  // Returns a duplicate of m_type; caller must take ownership
-  std::auto_ptr<Type> getType() const;
+  // Returns a handle to m_type
+  TypeRef getType() const;
 
-  // Use this for quick const lookups on the Type without duplicating it
+  // Use this for quick const lookups on the Type
   const Type& type() const;
 
+  // Our runtime Value once evaluated: a literal's, an arithmetic result, a
+  // variable's Object's.  A KIND_NONE Value if we have none.
+  virtual const Value& getValue() const;
+
 protected:
   virtual void computeType() = 0;
-  std::auto_ptr<Type> m_type;
+  TypeRef m_type;
 };
 
 };
@@ -0,0 +1,137 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "Value.h"
+
+#include "List.h"
+#include "Map.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <limits>
+#include <stdint.h>
+#include <string>
+using std::string;
+
+using namespace eval;
+
+const int Value::FIXED_DIGITS;
+const int64_t Value::FIXED_SCALE;
+
+namespace {
+  const int64_t INT_MAX64 = std::numeric_limits<int64_t>::max();
+  const int64_t INT_MIN64 = std::numeric_limits<int64_t>::min();
+};
+
+BigInt Value::getFixed() const {
+  if (KIND_FIXED == m_kind) {
+    return m_num;
+  } else if (KIND_INT == m_kind) {
+    return m_num * BigInt(FIXED_SCALE);
+  }
+  throw EvalError("Value " + print() + " is not a number");
+}
+
+bool Value::getSmallFixed(int64_t& units) const {
+  if (!m_num.isSmall()) {
+    return false;
+  }
+  int64_t i = m_num.getSmall();
+  if (KIND_FIXED == m_kind) {
+    units = i;
+    return true;
+  } else if (KIND_INT == m_kind) {
+    if (i > INT_MAX64 / FIXED_SCALE || i < INT_MIN64 / FIXED_SCALE) {
+      return false;
+    }
+    units = i * FIXED_SCALE;
+    return true;
+  }
+  return false;
+}
+
+Value Value::ParseInt(const string& text) {
+  return Int(BigInt::Parse(text));
+}
+
+Value Value::ParseFixed(const string& text) {
+  size_t dot = text.find('.');
+  if (string::npos == dot) {
+    return Fixed(ParseInt(text).getFixed());
+  }
+  size_t places = text.size() - dot - 1;
+  if (places > (size_t)FIXED_DIGITS) {
+    throw EvalError("Fixed literal " + text + " has more than " + boost::lexical_cast<string>(FIXED_DIGITS) + " decimal places");
+  }
+  string whole = text.substr(0, dot);
+  if (0 == places && (whole.empty() || "-" == whole)) {
+    throw EvalError("Fixed literal " + text + " is malformed");
+  }
+  // The digits without the point are the units, short of some places
+  return Fixed(BigInt::Parse(whole + text.substr(dot + 1) +
+                             string(FIXED_DIGITS - places, '0')));
+}
+
+string Value::PrintFixed(const BigInt& units) {
+  BigInt whole, frac;
+  BigInt::DivMod(units.abs(), BigInt(FIXED_SCALE), whole, frac);
+  string places = frac.print();
+  places = string(FIXED_DIGITS - places.size(), '0') + places;
+  size_t last = places.find_last_not_of('0');
+  places = string::npos == last ? "0" : places.substr(0, last + 1);
+  return (units.isNegative() ? "-" : "") + whole.print() + "." + places;
+}
+
+Value Value::NewList(const List& list) {
+  Value v(KIND_LIST);
+  v.m_boxed.reset(new List(list));
+  return v;
+}
+
+const List& Value::getList() const {
+  if (KIND_LIST != m_kind) {
+    throw EvalError("Value " + print() + " is not a list");
+  }
+  return *static_cast<const List*>(m_boxed.get());
+}
+
+List& Value::getMutableList() {
+  if (KIND_LIST != m_kind) {
+    throw EvalError("Value " + print() + " is not a list");
+  }
+  if (!m_boxed.unique()) {
+    m_boxed.reset(new List(getList()));
+  }
+  return *static_cast<List*>(m_boxed.get());
+}
+
+string Value::printList() const {
+  return getList().print();
+}
+
+Value Value::NewMap(const Map& map) {
+  Value v(KIND_MAP);
+  v.m_boxed.reset(new Map(map));
+  return v;
+}
+
+const Map& Value::getMap() const {
+  if (KIND_MAP != m_kind) {
+    throw EvalError("Value " + print() + " is not a map");
+  }
+  return *static_cast<const Map*>(m_boxed.get());
+}
+
+Map& Value::getMutableMap() {
+  if (KIND_MAP != m_kind) {
+    throw EvalError("Value " + print() + " is not a map");
+  }
+  if (!m_boxed.unique()) {
+    m_boxed.reset(new Map(getMap()));
+  }
+  return *static_cast<Map*>(m_boxed.get());
+}
+
+string Value::printMap() const {
+  return getMap().print();
+}
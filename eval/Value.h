@@ -0,0 +1,148 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Value_h_
+#define _Value_h_
+
+/* Value
+ *
+ * The primitive data, if any, that an Object carries: an int, a fixed, a
+ * str, a list or a map.  Most Objects have no Value (KIND_NONE); they are
+ * just members and parents.  The Value is what native builtins and
+ * arithmetic compute on.
+ *
+ * Numbers are BigInts, so they never overflow: an int is the integer itself,
+ * and a fixed is an exact count of 1/FIXED_SCALE units.  A number that fits
+ * in an int64 is unboxed, so copying or computing one never allocates.
+ * Literal nodes and Operators hold their Values directly rather than in
+ * Objects.
+ *
+ * A str is a Rope, so long ones are built up without recopying.  A str,
+ * list or map is boxed: the Value holds just a shared pointer to it, which
+ * keeps a Value small (a kind, a BigInt and the box) for the numbers that
+ * Operators copy around.  A str never changes once made, so the Values it is
+ * copied to all share it.  A list or map is copied only when one of them
+ * changes it (see getMutableList()).
+ */
+
+#include "BigInt.h"
+#include "EvalError.h"
+#include "Rope.h"
+
+#include <boost/shared_ptr.hpp>
+
+#include <stdint.h>
+#include <string>
+
+namespace eval {
+
+class List;
+class Map;
+
+class Value {
+public:
+  enum KIND {
+    KIND_NONE,
+    KIND_INT,
+    KIND_FIXED,
+    KIND_STR,
+    KIND_LIST,
+    KIND_MAP,
+  };
+
+  // A fixed has FIXED_DIGITS decimal places
+  static const int FIXED_DIGITS = 6;
+  static const int64_t FIXED_SCALE = 1000000;
+
+  Value()
+    : m_kind(KIND_NONE) {}
+  static Value Int(const BigInt& i) {
+    Value v(KIND_INT);
+    v.m_num = i;
+    return v;
+  }
+  // A fixed from its count of 1/FIXED_SCALE units
+  static Value Fixed(const BigInt& units) {
+    Value v(KIND_FIXED);
+    v.m_num = units;
+    return v;
+  }
+  static Value Str(const Rope& s) {
+    Value v(KIND_STR);
+    v.m_boxed.reset(new Rope(s));
+    return v;
+  }
+  static Value NewList(const List& list);
+  static Value NewMap(const Map& map);
+
+  KIND kind() const { return m_kind; }
+  bool isNone() const { return KIND_NONE == m_kind; }
+  bool isNumeric() const {
+    return KIND_INT == m_kind || KIND_FIXED == m_kind;
+  }
+  const BigInt& getInt() const {
+    if (KIND_INT != m_kind) {
+      throw EvalError("Value " + print() + " is not an int");
+    }
+    return m_num;
+  }
+  // Units of a fixed; an int is converted
+  BigInt getFixed() const;
+  // The int, or the units of a fixed, if they fit in an int64.  This is the
+  // fast path for arithmetic; otherwise use getInt() or getFixed().
+  bool getSmallInt(int64_t& i) const {
+    if (KIND_INT != m_kind || !m_num.isSmall()) return false;
+    i = m_num.getSmall();
+    return true;
+  }
+  bool getSmallFixed(int64_t& units) const;
+  std::string getStr() const {
+    return getText().str();
+  }
+  // The str without copying it out of its Rope
+  const Rope& getText() const {
+    if (KIND_STR != m_kind) {
+      throw EvalError("Value " + print() + " is not a str");
+    }
+    return *static_cast<const Rope*>(m_boxed.get());
+  }
+  const List& getList() const;
+  // The list, copied first if any other Value shares it
+  List& getMutableList();
+  const Map& getMap() const;
+  Map& getMutableMap();
+
+  std::string print() const {
+    switch (m_kind) {
+      case KIND_NONE: return "<no value>";
+      case KIND_INT: return m_num.print();
+      case KIND_FIXED: return PrintFixed(m_num);
+      case KIND_STR: return "'" + getText().str() + "'";
+      case KIND_LIST: return printList();
+      case KIND_MAP: return printMap();
+      default: return "<unknown value>";
+    }
+  }
+
+  // Parse the text of an INT or FIXED literal, which may have a leading '-'.
+  // Throws if it is malformed or (for a fixed) has more than FIXED_DIGITS
+  // places.
+  static Value ParseInt(const std::string& text);
+  static Value ParseFixed(const std::string& text);
+  static std::string PrintFixed(const BigInt& units);
+
+private:
+  Value(KIND kind)
+    : m_kind(kind) {}
+  std::string printList() const;
+  std::string printMap() const;
+
+  KIND m_kind;
+  BigInt m_num;
+  // The Rope, List or Map of a str, list or map; its deleter knows which
+  boost::shared_ptr<void> m_boxed;
+};
+
+};
+
+#endif // _Value_h_
@@ -14,44 +14,65 @@ using std::vector;
 using namespace eval;
 
 void Variable::setup() {
+  if (!resolve()) {
+    throw EvalError("Object " + m_varname + " does not exist");
+  }
+  computeType();
+}
+
+Object* Variable::resolve() {
   if (children.size() < 1) {
     throw EvalError("Variable node must have >= 1 children");
   }
   Object* current = NULL;
+  m_address = Scope::Address();
+  m_members.clear();
+  m_memberCaches.clear();
   for (child_iter i = children.begin(); i != children.end(); ++i) {
     Identifier* ident = dynamic_cast<Identifier*>(*i);
     if (!ident) {
       throw EvalError("Variable children must all be Identifiers");
     }
-    if (!current) {
+    symbol_id symbol = Symbol::Intern(ident->getName());
+    if (children.begin() == i) {
       m_varname = ident->getName();
-      current = parentScope->getObject(ident->getName());
+      if (parentScope->resolve(symbol, m_address)) {
+        current = parentScope->getObject(m_address);
+      }
     } else {
       m_varname += "." + ident->getName();
-      current = current->getMember(ident->getName());
+      m_members.push_back(symbol);
+      m_memberCaches.push_back(MemberCache());
+      if (current) {
+        current = m_memberCaches.back().lookup(*current, symbol);
+      }
     }
   }
-  m_object = current;
-  if (!m_object) {
-    throw EvalError("Object " + m_varname + " does not exist");
-  }
-  computeType();
+  return current;
 }
 
 // Nothing to do
 void Variable::evaluate() {
 }
 
+// Fetch the object from its lexical address, rather than trusting the one we
+// found at setup(), which may since have been deleted or reverted.  If so the
+// address finds nothing -- even if a new object has taken its slot -- and we
+// throw.
 Object& Variable::getObject() const {
-  if (!m_object) {
+  if (!m_address.isValid()) {
     throw EvalError("Cannot retrieve Object of deficient Variable " + print());
   }
-  return *m_object;
+  Object* object = parentScope->getObject(m_address);
+  for (size_t i = 0; object && i < m_members.size(); ++i) {
+    object = m_memberCaches[i].lookup(*object, m_members[i]);
+  }
+  if (!object) {
+    throw EvalError("Object " + m_varname + " no longer exists");
+  }
+  return *object;
 }
 
 void Variable::computeType() {
-  if (!m_object) {
-    throw EvalError("Failed to find object behind Variable " + print());
-  }
-  m_type.reset(new BasicType(*m_object));
+  m_type = BasicType::Get(getObject());
 }
@@ -11,33 +11,46 @@
  * must refer to an object that exists.  The second and subsequent are the
  * names of a member, a member on that member, etc.  These must all exist in
  * the parent scope at setup()-time, so the Variable can be a TypedNode.
+ *
+ * At setup() the first name is resolved to a lexical address in the parent
+ * scope, and the rest to symbols, so getObject() does not look up any names
+ * by string.
  */
 
 #include "Log.h"
+#include "MemberCache.h"
 #include "Object.h"
 #include "RootNode.h"
+#include "Scope.h"
+#include "Symbol.h"
 #include "Token.h"
 #include "TypedNode.h"
 
 #include <string>
+#include <vector>
 
 namespace eval {
 
 class Variable : public TypedNode {
 public:
   Variable(Log& log, RootNode*const root, const Token& token)
-    : TypedNode(log, root, token),
-      m_object(NULL) {}
+    : TypedNode(log, root, token) {}
   virtual void setup();
   virtual void evaluate();
 
   Object& getObject() const;
+  virtual const Value& getValue() const { return getObject().getValue(); }
 
 private:
   // from TypedNode
   virtual void computeType();
+  // Walk the Identifier chain to find the Object we refer to
+  Object* resolve();
   std::string m_varname;
-  Object* m_object;
+  // Where the first name lives, and the member names after it
+  Scope::Address m_address;
+  std::vector<symbol_id> m_members;
+  mutable std::vector<MemberCache> m_memberCaches;
 };
 
 };
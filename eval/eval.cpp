@@ -14,8 +14,10 @@
 
 #include "AST.h"
 #include "EvalError.h"
+#include "Heap.h"
 #include "Log.h"
 #include "Token.h"
+#include "Type.h"
 
 #include <iostream>
 #include <string>
@@ -31,29 +33,36 @@ namespace {
 };
 
 int main(int argc, char *argv[]) {
-  if (argc < 1 || argc > 2) {
-    cout << "usage: " << PROGRAM_NAME << " [log level]" << endl;
+  if (argc < 1 || argc > 3) {
+    cout << "usage: " << PROGRAM_NAME << " [log level [types: tree, bitset]]" << endl;
     return 1;
   }
 
   Log log;
   try {
-    if (2 == argc) {
+    if (argc >= 2) {
       log.setLevel(argv[1]);
     }
 
     AST ast(log);
+    if (3 == argc) {
+      Type::SetBackend(argv[2]);
+    }
     log.info("Initialized AST");
 
     Tokenizer tokenizer;
     string line;
     while (getline(cin, line)) {
-      log.debug("Received input line: '" + line + "'");
+      if (log.isDebug()) {
+        log.debug("Received input line: '" + line + "'");
+      }
       try {
         Tokenizer::token_vec tokens = tokenizer.tokenize(log, line);
         for (Tokenizer::token_iter i = tokens.begin();
              i != tokens.end(); ++i) {
-          log.debug("Inserting token: '" + i->name + ":" + i->value + "'");
+          if (log.isDebug()) {
+            log.debug("Inserting token: '" + i->name + ":" + i->value + "'");
+          }
           ast.insert(*i);
         }
         log.info("Evaluating: '" + ast.print() + "'");
@@ -69,6 +78,7 @@ int main(int argc, char *argv[]) {
         ast.reset();
       }
     }
+    log.info("Heap: " + Heap::PrintStats());
   } catch (std::exception& e) {
     log.error(string("Unknown error: ") + e.what());
   } catch (...) {
@@ -0,0 +1,52 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _Bench_h_
+#define _Bench_h_
+
+/* Benchmark helpers
+ *
+ * The bench_* programs each time a few loops over one part of the evaluator,
+ * and print a line per loop: what it ran, how many times, and the time per
+ * iteration.  "make bench" builds and runs them all.  They check nothing
+ * beyond not throwing; compare their numbers before and after a change.
+ */
+
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <time.h>
+
+namespace bench {
+
+// Seconds on a monotonic clock
+inline double now() {
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Times a loop: construct it, run the loop, then report()
+class Timer {
+public:
+  Timer() : m_start(now()) {}
+  void report(const std::string& name, unsigned long iterations) const {
+    double seconds = now() - m_start;
+    std::cout << std::left << std::setw(40) << name << std::right
+              << std::setw(12) << iterations << " x "
+              << std::fixed << std::setprecision(1) << std::setw(10)
+              << seconds * 1e9 / iterations << " ns" << std::endl;
+  }
+private:
+  double m_start;
+};
+
+// Keeps the compiler from optimizing away a result we never use
+template <class T>
+inline void keep(const T& value) {
+  __asm__ __volatile__("" : : "g"(&value) : "memory");
+}
+
+};
+
+#endif // _Bench_h_
@@ -0,0 +1,124 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Function call benchmark
+ *
+ * Times calls through Function::call(): a native fib that recurses by
+ * making a CallFrame for each call, as a ProcCall does, and a loop of calls
+ * to a native that returns its argument.  Each fib call allocates its
+ * argument and result Objects, so it also measures that overhead.
+ */
+
+#include "Bench.h"
+
+#include "CallStack.h"
+#include "EvalError.h"
+#include "Function.h"
+#include "Log.h"
+#include "Object.h"
+#include "Signature.h"
+#include "Type.h"
+#include "Value.h"
+
+#include <stdint.h>
+#include <string>
+using std::string;
+
+using namespace eval;
+
+namespace {
+  const int64_t FIB_N = 25;
+  const unsigned long CALLS = 1 << 20;
+
+  CallStack* g_stack = NULL;
+  unsigned long g_calls = 0;
+
+  int64_t smallArg(CallFrame& frame) {
+    int64_t n;
+    if (!frame.getArg(0)->getValue().getSmallInt(n)) {
+      throw EvalError("bench_calls expects small int arguments");
+    }
+    return n;
+  }
+
+  Object* newInt(Log& log, const TypeRef& type, int64_t i) {
+    Object* object = new Object(log, "int", type);
+    object->setValue(Value::Int(i));
+    return object;
+  }
+
+  // fib(n), calling itself through new CallFrames
+  Object* fib(Log& log, CallFrame& frame) {
+    ++g_calls;
+    int64_t n = smallArg(frame);
+    TypeRef type = frame.signature().getReturnType();
+    if (n < 2) return newInt(log, type, n);
+    int64_t sum = 0;
+    for (int64_t k = 1; k <= 2; ++k) {
+      CallFrame inner(*g_stack, frame.function(), frame.signature());
+      inner.setArg(0, newInt(log, type, n - k));
+      Object* result = frame.function().call(inner);
+      result->retain();
+      int64_t value;
+      result->getValue().getSmallInt(value);
+      sum += value;
+      result->release();
+    }
+    return newInt(log, type, sum);
+  }
+
+  Object* identity(Log& log, CallFrame& frame) {
+    ++g_calls;
+    return frame.getArg(0);
+  }
+
+  Function* makeFunction(Log& log, const string& name, const TypeRef& type,
+                         native_fn native) {
+    argspec_list args(1, ArgSpec("n", type, NULL));
+    Function* function = new Function(log, name, type, Signature(args, type, native));
+    function->retain();
+    return function;
+  }
+};
+
+int main() {
+  Log log;
+  CallStack stack;
+  g_stack = &stack;
+  Object* intObject = new Object(log, "int", NullType::Get());
+  intObject->retain();
+  TypeRef intType = BasicType::Get(*intObject);
+
+  Function* fibFunction = makeFunction(log, "fib", intType, fib);
+  {
+    g_calls = 0;
+    bench::Timer timer;
+    CallFrame frame(*g_stack, *fibFunction, *fibFunction->getSignature((size_t)1));
+    frame.setArg(0, newInt(log, intType, FIB_N));
+    Object* result = fibFunction->call(frame);
+    result->retain();
+    timer.report("native fib(25), per call", g_calls);
+    result->release();
+  }
+
+  Function* idFunction = makeFunction(log, "identity", intType, identity);
+  Object* arg = newInt(log, intType, 1);
+  arg->retain();
+  {
+    g_calls = 0;
+    const Signature& signature = *idFunction->getSignature((size_t)1);
+    bench::Timer timer;
+    for (unsigned long n = 0; n < CALLS; ++n) {
+      CallFrame frame(*g_stack, *idFunction, signature);
+      frame.setArg(0, arg);
+      bench::keep(idFunction->call(frame));
+    }
+    timer.report("native identity call", g_calls);
+  }
+  arg->release();
+  idFunction->release();
+  fibFunction->release();
+  intType = TypeRef();
+  intObject->release();
+  return 0;
+}
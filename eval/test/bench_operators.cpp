@@ -0,0 +1,171 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Operator chain benchmark
+ *
+ * Times the operator precedence table lookup, then chains of int arithmetic
+ * of a few lengths that mix priorities and associativity (+ - * / % ^).
+ * Each chain is built from Literal and Operator nodes, as the parser hands
+ * them to an Expression.  It is timed three ways: making the nodes alone,
+ * making them and running them through an OperatorParser, and evaluating
+ * the finished tree again and again.  Parse time is the difference between
+ * the first two.
+ *
+ * The nodes are made by hand rather than through an AST, so they are given
+ * the root's scope directly.  Literals are set up as they are made; the
+ * OperatorParser sets up each operator once it has its operands, as it does
+ * for an Expression.
+ */
+
+#include "Bench.h"
+
+#include "Literal.h"
+#include "Log.h"
+#include "Node.h"
+#include "Operator.h"
+#include "OperatorParser.h"
+#include "RootNode.h"
+#include "Scope.h"
+#include "Token.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+namespace {
+  const unsigned long LOOKUPS = 1 << 24;
+  const unsigned long OPERATORS = 1 << 18;   // per chain loop
+
+  // The token names cycled through in a chain; ^ is kept rare so that values
+  // stay small ints
+  const char* const CHAIN_OPS[] = {
+    "PLUS", "STAR", "MINUS", "SLASH", "PLUS", "PERCENT", "STAR", "CARAT",
+  };
+  const size_t NUM_CHAIN_OPS = sizeof(CHAIN_OPS) / sizeof(CHAIN_OPS[0]);
+
+  // Exposes the stdlib scope that literals and arithmetic look types up in
+  class BenchRoot : public RootNode {
+  public:
+    BenchRoot(Log& log) : RootNode(log) {}
+    Scope* scope() { return getScope(); }
+  };
+
+  class BenchLiteral : public Literal {
+  public:
+    BenchLiteral(Log& log, BenchRoot& root, const string& text)
+      : Literal(log, &root, Token("INT", text)) {
+      parentScope = root.scope();
+      isInit = true;
+      setup();
+      isSetup = true;
+      isAnalyzed = true;
+    }
+  };
+
+  class BenchOperator : public Operator {
+  public:
+    static KIND KindOf(const string& token) {
+      KIND kind;
+      Kind(token, kind);
+      return kind;
+    }
+
+    BenchOperator(Log& log, BenchRoot& root, const string& token)
+      : Operator(log, &root, Token(token), KindOf(token)) {
+      parent = &root;
+      parentScope = root.scope();
+      isInit = true;
+    }
+  };
+
+  // The nodes of an n-operator chain, in source order: operand, then
+  // operator, operand, ...  Operands are 1 to 3, so nothing divides by zero.
+  void makeChain(Log& log, BenchRoot& root, size_t n, vector<Node*>& nodes) {
+    nodes.clear();
+    nodes.push_back(new BenchLiteral(log, root, "2"));
+    for (size_t i = 0; i < n; ++i) {
+      nodes.push_back(new BenchOperator(log, root,
+                                        CHAIN_OPS[i % NUM_CHAIN_OPS]));
+      nodes.push_back(new BenchLiteral(log, root,
+                                       boost::lexical_cast<string>(1 + i % 3)));
+    }
+  }
+
+  Node* parse(Log& log, const vector<Node*>& nodes) {
+    OperatorParser parser(log);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      parser.insertNode(nodes[i]);
+    }
+    return parser.finalizeParse();
+  }
+
+  void lookups(Log& log, BenchRoot& root) {
+    vector<Operator*> ops;
+    for (size_t i = 0; i < NUM_CHAIN_OPS; ++i) {
+      ops.push_back(new BenchOperator(log, root, CHAIN_OPS[i]));
+    }
+    Operator::op_priority total = 0;
+    bench::Timer timer;
+    for (unsigned long n = 0; n < LOOKUPS; ++n) {
+      Operator::op_precedence prec =
+          ops[n % NUM_CHAIN_OPS]->precedence(Operator::INFIX);
+      total += prec.priority + prec.assoc;
+    }
+    timer.report("Operator::precedence infix", LOOKUPS);
+    bench::keep(total);
+    for (size_t i = 0; i < ops.size(); ++i) {
+      delete ops[i];
+    }
+  }
+
+  void run(Log& log, BenchRoot& root, size_t n) {
+    string suffix = " " + boost::lexical_cast<string>(n);
+    unsigned long chains = OPERATORS / n;
+    vector<Node*> nodes;
+    {
+      bench::Timer timer;
+      for (unsigned long c = 0; c < chains; ++c) {
+        makeChain(log, root, n, nodes);
+        for (size_t i = 0; i < nodes.size(); ++i) {
+          delete nodes[i];
+        }
+      }
+      timer.report("make chain, per operator" + suffix, chains * n);
+    }
+    {
+      bench::Timer timer;
+      for (unsigned long c = 0; c < chains; ++c) {
+        makeChain(log, root, n, nodes);
+        delete parse(log, nodes);
+      }
+      timer.report("make and parse chain, per operator" + suffix, chains * n);
+    }
+    makeChain(log, root, n, nodes);
+    TypedNode* tree = dynamic_cast<TypedNode*>(parse(log, nodes));
+    {
+      bench::Timer timer;
+      for (unsigned long c = 0; c < chains; ++c) {
+        tree->resetEvaluated();
+        tree->evaluateNode();
+      }
+      timer.report("evaluate chain, per operator" + suffix, chains * n);
+    }
+    bench::keep(tree->getValue());
+    delete tree;
+  }
+};
+
+int main() {
+  Log log;
+  BenchRoot root(log);
+  lookups(log, root);
+  run(log, root, 4);
+  run(log, root, 16);
+  run(log, root, 64);
+  return 0;
+}
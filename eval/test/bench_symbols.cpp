@@ -0,0 +1,88 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Symbol lookup benchmark
+ *
+ * Times looking names up in a SymbolMap, as scopes and object stores do, next
+ * to the std::map keyed by name that they used before, for tables of a few
+ * sizes.  Half of the lookups hit and half miss.  Also times interning a name
+ * that is already a symbol, which is what a lookup by string pays first.
+ */
+
+#include "Bench.h"
+
+#include "Symbol.h"
+#include "SymbolMap.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <map>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+namespace {
+  const unsigned long LOOKUPS = 1 << 22;
+
+  // Entries in the table, and as many names that are not in it
+  void makeNames(size_t size, vector<string>& names) {
+    names.clear();
+    for (size_t i = 0; i < 2 * size; ++i) {
+      names.push_back("name_" + boost::lexical_cast<string>(size) + "_" +
+                      boost::lexical_cast<string>(i));
+    }
+  }
+
+  void run(size_t size) {
+    string suffix = " " + boost::lexical_cast<string>(size);
+    vector<string> names;
+    makeNames(size, names);
+    vector<symbol_id> symbols;
+    for (size_t i = 0; i < names.size(); ++i) {
+      symbols.push_back(Symbol::Intern(names[i]));
+    }
+
+    SymbolMap<size_t> symbolMap;
+    std::map<string, size_t> stringMap;
+    for (size_t i = 0; i < size; ++i) {
+      symbolMap.insert(symbols[i], i);
+      stringMap[names[i]] = i;
+    }
+
+    unsigned long found = 0;
+    {
+      bench::Timer timer;
+      for (unsigned long n = 0; n < LOOKUPS; ++n) {
+        if (symbolMap.find(symbols[n % symbols.size()])) ++found;
+      }
+      timer.report("SymbolMap find" + suffix, LOOKUPS);
+    }
+    {
+      bench::Timer timer;
+      for (unsigned long n = 0; n < LOOKUPS; ++n) {
+        if (stringMap.find(names[n % names.size()]) != stringMap.end()) {
+          ++found;
+        }
+      }
+      timer.report("std::map<string> find" + suffix, LOOKUPS);
+    }
+    {
+      bench::Timer timer;
+      for (unsigned long n = 0; n < LOOKUPS; ++n) {
+        found += Symbol::Intern(names[n % names.size()]);
+      }
+      timer.report("Symbol::Intern existing" + suffix, LOOKUPS);
+    }
+    bench::keep(found);
+  }
+};
+
+int main() {
+  run(8);
+  run(64);
+  run(1024);
+  return 0;
+}
@@ -0,0 +1,92 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Type compatibility benchmark
+ *
+ * Times Type::isCompatible() over every pair of a small type lattice: a chain
+ * of single inheritance plus some & and | types over it.  "cold" clears the
+ * memo before each pass over the pairs, so every check is a miss and runs the
+ * backend; "memo" repeats the passes with the memo left warm.
+ */
+
+#include "Bench.h"
+
+#include "Log.h"
+#include "Object.h"
+#include "Type.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+using namespace eval;
+
+namespace {
+  const int CHAIN_DEPTH = 16;
+  const int PASSES = 200;
+
+  // Empties the memo, which SetBackend() does whenever the backend changes
+  void clearMemo(Type::BACKEND backend) {
+    Type::SetBackend(Type::BACKEND_TREE == backend ? Type::BACKEND_BITSET
+                                                   : Type::BACKEND_TREE);
+    Type::SetBackend(backend);
+  }
+
+  void run(const string& name, Type::BACKEND backend,
+           const vector<TypeRef>& types, bool cold) {
+    Type::SetBackend(backend);
+    clearMemo(backend);
+    unsigned long checks = 0;
+    unsigned long compatible = 0;
+    bench::Timer timer;
+    for (int pass = 0; pass < PASSES; ++pass) {
+      if (cold) clearMemo(backend);
+      for (size_t i = 0; i < types.size(); ++i) {
+        for (size_t j = 0; j < types.size(); ++j) {
+          if (types[i]->isCompatible(*types[j])) ++compatible;
+          ++checks;
+        }
+      }
+    }
+    timer.report(name, checks);
+    bench::keep(compatible);
+  }
+};
+
+int main() {
+  Log log;
+  vector<Object*> objects;
+  vector<TypeRef> types;
+
+  Object* root = new Object(log, "object", NullType::Get());
+  root->retain();
+  objects.push_back(root);
+  types.push_back(BasicType::Get(*root));
+  for (int i = 0; i < CHAIN_DEPTH; ++i) {
+    Object* o = new Object(log, "t" + boost::lexical_cast<string>(i),
+                           types.back());
+    o->retain();
+    objects.push_back(o);
+    types.push_back(BasicType::Get(*o));
+  }
+  size_t basics = types.size();
+  for (size_t i = 1; i + 2 < basics; i += 3) {
+    types.push_back(AndType::Get(types[i], types[i + 2]));
+    types.push_back(OrType::Get(types[i + 1], types[i + 2]));
+  }
+
+  run("isCompatible tree cold", Type::BACKEND_TREE, types, true);
+  run("isCompatible tree memo", Type::BACKEND_TREE, types, false);
+  run("isCompatible bitset cold", Type::BACKEND_BITSET, types, true);
+  run("isCompatible bitset memo", Type::BACKEND_BITSET, types, false);
+
+  types.clear();
+  for (vector<Object*>::const_iterator i = objects.begin();
+       i != objects.end(); ++i) {
+    (*i)->release();
+  }
+  return 0;
+}
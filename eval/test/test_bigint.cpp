@@ -0,0 +1,288 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* BigInt tests
+ *
+ * The inline int64 and spilled limb forms must meet exactly at the int64
+ * range, including INT64_MIN, whose negation does not fit.  Karatsuba
+ * products are checked against schoolbook multiplication on decimal strings,
+ * and Knuth D quotients against the division identity, on operands on both
+ * sides of KARATSUBA_LIMBS.
+ */
+
+#include "BigInt.h"
+#include "EvalError.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <limits>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_bigint";
+  const int64_t INT64_MAX_ = numeric_limits<int64_t>::max();
+  const int64_t INT64_MIN_ = numeric_limits<int64_t>::min();
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  // A fixed sequence of pseudo-random numbers, so failures reproduce
+  uint64_t g_seed = 88172645463325252ULL;
+  uint64_t nextRandom() {
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+    return g_seed;
+  }
+
+  // A random decimal of exactly digits digits
+  string randomDigits(size_t digits) {
+    string s;
+    s += (char)('1' + nextRandom() % 9);
+    while (s.size() < digits) {
+      s += (char)('0' + nextRandom() % 10);
+    }
+    return s;
+  }
+
+  // Schoolbook product of two non-negative decimals, independent of BigInt
+  string decimalMul(const string& a, const string& b) {
+    vector<int> r(a.size() + b.size(), 0);
+    for (size_t i = a.size(); i-- > 0; ) {
+      for (size_t j = b.size(); j-- > 0; ) {
+        r[i + j + 1] += (a[i] - '0') * (b[j] - '0');
+      }
+    }
+    for (size_t k = r.size(); k-- > 1; ) {
+      r[k - 1] += r[k] / 10;
+      r[k] %= 10;
+    }
+    string s;
+    for (size_t k = 0; k < r.size(); ++k) {
+      if (s.empty() && 0 == r[k]) continue;
+      s += (char)('0' + r[k]);
+    }
+    return s.empty() ? "0" : s;
+  }
+
+  string str(int64_t i) {
+    return boost::lexical_cast<string>(i);
+  }
+
+  // Each of these gives the result as text, or "error" for an EvalError
+  string divError(const BigInt& a, const BigInt& b) {
+    try {
+      return (a / b).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  string modError(const BigInt& a, const BigInt& b) {
+    try {
+      return (a % b).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  string pow(const BigInt& base, uint64_t exp) {
+    try {
+      return BigInt::Pow(base, exp).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  string product(const BigInt& a, const BigInt& b) {
+    try {
+      return (a * b).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  string parse(const string& text) {
+    try {
+      return BigInt::Parse(text).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  // Does DivMod(a, b) satisfy a = q*b + r, |r| < |b|, r has a's sign?
+  string checkDivMod(const BigInt& a, const BigInt& b) {
+    BigInt q, r;
+    BigInt::DivMod(a, b, q, r);
+    if (q * b + r != a) return "q*b + r != a";
+    if (!(r.abs() < b.abs())) return "|r| >= |b|";
+    if (!r.isZero() && r.isNegative() != a.isNegative()) return "sign of r";
+    if (q != a / b || r != a % b) return "DivMod differs from / and %";
+    return "ok";
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool test(const string& name, bool expected, bool observed) {
+  return test(name, string(expected ? "true" : "false"),
+              string(observed ? "true" : "false"));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  // The small/big boundary
+  BigInt max(INT64_MAX_);
+  BigInt min(INT64_MIN_);
+  BigInt one(1);
+  test("INT64_MAX is small", true, max.isSmall());
+  test("INT64_MAX + 1 is big", false, (max + one).isSmall());
+  test("INT64_MAX + 1", "9223372036854775808", (max + one).print());
+  test("INT64_MAX + 1 - 1 is small again", true, (max + one - one).isSmall());
+  test("INT64_MAX + 1 - 1", str(INT64_MAX_), (max + one - one).print());
+  test("INT64_MIN is small", true, min.isSmall());
+  test("INT64_MIN - 1 is big", false, (min - one).isSmall());
+  test("INT64_MIN - 1", "-9223372036854775809", (min - one).print());
+  test("INT64_MIN - 1 + 1 is small", true, (min - one + one).isSmall());
+  test("-INT64_MIN is big", false, (-min).isSmall());
+  test("-INT64_MIN", "9223372036854775808", (-min).print());
+  test("-(-INT64_MIN) is small", true, (-(-min)).isSmall());
+  test("abs(INT64_MIN)", "9223372036854775808", min.abs().print());
+  test("INT64_MIN / -1", "9223372036854775808", (min / BigInt(-1)).print());
+  test("INT64_MIN % -1", "0", (min % BigInt(-1)).print());
+  test("INT64_MIN * -1", "9223372036854775808", (min * BigInt(-1)).print());
+  test("INT64_MIN * INT64_MIN", "85070591730234615865843651857942052864",
+       (min * min).print());
+  test("INT64_MAX * INT64_MAX / INT64_MAX is small", true,
+       (max * max / max).isSmall());
+  test("INT64_MIN < INT64_MAX + 1", true, min < max + one);
+  test("-(INT64_MAX + 1) == INT64_MIN", true, -(max + one) == min);
+  test("-(INT64_MAX + 1) is small", true, (-(max + one)).isSmall());
+
+  // Division by zero
+  BigInt big = BigInt::Parse("123456789012345678901234567890");
+  test("small / 0", "error", divError(BigInt(7), BigInt(0)));
+  test("small % 0", "error", modError(BigInt(7), BigInt(0)));
+  test("big / 0", "error", divError(big, BigInt(0)));
+  test("big % 0", "error", modError(big, BigInt(0)));
+  test("0 / big", "0", divError(BigInt(0), big));
+
+  // Truncation toward zero; the remainder has the dividend's sign
+  test("-7 / 2", "-3", (BigInt(-7) / BigInt(2)).print());
+  test("-7 % 2", "-1", (BigInt(-7) % BigInt(2)).print());
+  test("7 % -2", "1", (BigInt(7) % BigInt(-2)).print());
+  test("-(big + 7) % 10", "-7", (-(big + BigInt(7)) % BigInt(10)).print());
+  test("-(big + 7) / 10", "-12345678901234567890123456789",
+       (-(big + BigInt(7)) / BigInt(10)).print());
+
+  // Parse and print
+  test("parse 0", "0", parse("0"));
+  test("parse -0", "0", parse("-0"));
+  test("parse leading zeros", "7", parse("0000000000000000000000007"));
+  test("parse INT64_MIN", str(INT64_MIN_), parse(str(INT64_MIN_)));
+  test("parse INT64_MIN is small", true,
+       BigInt::Parse(str(INT64_MIN_)).isSmall());
+  test("parse INT64_MAX + 1 is big", false,
+       BigInt::Parse("9223372036854775808").isSmall());
+  test("parse ''", "error", parse(""));
+  test("parse -", "error", parse("-"));
+  test("parse 12a", "error", parse("12a"));
+  test("parse +5", "error", parse("+5"));
+  test("parse --5", "error", parse("--5"));
+  bool roundTrips = true;
+  for (size_t digits = 1; digits < 3000; digits += 1 + digits / 4) {
+    string s = randomDigits(digits);
+    roundTrips = roundTrips && parse(s) == s && parse("-" + s) == "-" + s;
+  }
+  test("parse and print round trip, 1 to 3000 digits", true, roundTrips);
+  string tenK = randomDigits(10000);
+  test("parse and print round trip, 10000 digits", tenK, parse(tenK));
+
+  // Multiplication, below and above KARATSUBA_LIMBS (about 9.6 digits a limb)
+  string nines(400, '9');
+  test("(10^400 - 1)^2", string(399, '9') + "8" + string(399, '0') + "1",
+       (BigInt::Parse(nines) * BigInt::Parse(nines)).print());
+  bool products = true;
+  const size_t sizes[] = { 5, 19, 20, 150, 300, 310, 600, 1200, 2000 };
+  const size_t numSizes = sizeof(sizes) / sizeof(sizes[0]);
+  for (size_t i = 0; i < numSizes; ++i) {
+    for (size_t j = 0; j < numSizes; ++j) {
+      string a = randomDigits(sizes[i]);
+      string b = randomDigits(sizes[j]);
+      string expected = decimalMul(a, b);
+      BigInt product = BigInt::Parse(a) * BigInt::Parse("-" + b);
+      if (product.print() != "-" + expected) {
+        cout << " - " << sizes[i] << " x " << sizes[j] << " digits" << endl;
+        products = false;
+      }
+    }
+  }
+  test("products match schoolbook, 5 to 2000 digits", true, products);
+  test("2^1000 * 2^1000 == 2^2000", true,
+       BigInt::Pow(BigInt(2), 1000) * BigInt::Pow(BigInt(2), 1000) ==
+       BigInt::Pow(BigInt(2), 2000));
+  test("2^MAX_BITS", "error", pow(BigInt(2), BigInt::MAX_BITS));
+  test("products past MAX_BITS", "error",
+       product(BigInt::Pow(BigInt(2), BigInt::MAX_BITS / 2),
+               BigInt::Pow(BigInt(2), BigInt::MAX_BITS / 2 + 1)));
+
+  // Division (Knuth D for multi-limb divisors)
+  string divmods = "ok";
+  for (size_t i = 0; i < numSizes && "ok" == divmods; ++i) {
+    for (size_t j = 0; j <= i && "ok" == divmods; ++j) {
+      BigInt a = BigInt::Parse(randomDigits(sizes[i]));
+      BigInt b = BigInt::Parse(randomDigits(sizes[j]));
+      divmods = checkDivMod(a, b);
+      if ("ok" == divmods) divmods = checkDivMod(-a, b);
+      if ("ok" == divmods) divmods = checkDivMod(a, -b);
+      if ("ok" == divmods) divmods = checkDivMod(-a, -b);
+    }
+  }
+  test("division identity, 5 to 2000 digits", "ok", divmods);
+  // Divisors whose top limb needs the most normalization, or none, and
+  // quotient digits that Algorithm D must correct
+  BigInt limb = BigInt::Pow(BigInt(2), 32);
+  BigInt twoLimbs = BigInt::Pow(BigInt(2), 64);
+  test("(2^640 - 1) / (2^64 - 1)", "ok",
+       checkDivMod(BigInt::Pow(BigInt(2), 640) - one, twoLimbs - one));
+  test("(2^640 - 1) / (2^64 + 1)", "ok",
+       checkDivMod(BigInt::Pow(BigInt(2), 640) - one, twoLimbs + one));
+  test("2^640 / (2^95 + 2^32)", "ok",
+       checkDivMod(BigInt::Pow(BigInt(2), 640),
+                   BigInt::Pow(BigInt(2), 95) + limb));
+  test("(2^64 - 1)^10 / (2^64 - 1)^5", true,
+       BigInt::Pow(twoLimbs - one, 10) / BigInt::Pow(twoLimbs - one, 5) ==
+       BigInt::Pow(twoLimbs - one, 5));
+  BigInt a = BigInt::Parse(randomDigits(1500));
+  BigInt b = BigInt::Parse(randomDigits(700));
+  test("(a*b + 1) / b == a", true, (a * b + one) / b == a);
+  test("(a*b + 1) % b == 1", true, (a * b + one) % b == one);
+  test("(a*b - 1) / b == a - 1", true, (a * b - one) / b == a - one);
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  return num_failed ? 1 : 0;
+}
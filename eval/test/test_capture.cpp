@@ -0,0 +1,167 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Capture tests
+ *
+ * We play the shell: std::cin and std::cout are swapped for strings, and the
+ * reply names a temporary file that we wrote the "output" into.  A command
+ * with a newline must be refused before anything reaches the shell, and the
+ * temporary file must be gone once the Capture has seen its name, whether or
+ * not the capture worked.
+ */
+
+#include "Capture.h"
+#include "EvalError.h"
+#include "Log.h"
+#include "Rope.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+#include <string>
+#include <unistd.h>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_capture";
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  // A new temporary file holding contents, as the shell makes for a capture
+  string tempFile(const string& contents) {
+    char path[] = "/tmp/test_capture.XXXXXX";
+    int fd = mkstemp(path);
+    if (-1 == fd) return "";
+    size_t written = 0;
+    while (written < contents.size()) {
+      ssize_t n = write(fd, contents.data() + written,
+                        contents.size() - written);
+      if (n <= 0) break;
+      written += n;
+    }
+    close(fd);
+    return path;
+  }
+
+  bool exists(const string& path) {
+    return 0 == access(path.c_str(), F_OK);
+  }
+
+  // Run a Capture of cmd with reply as the shell's answer.  Gives what the
+  // evaluator sent the shell, and the output's lines joined by '|', or
+  // "error".
+  struct Result {
+    string sent;
+    string lines;
+    string text;
+    int returnCode;
+  };
+  Result capture(Log& log, const string& cmd, const string& reply) {
+    istringstream in(reply + "\n");
+    ostringstream out;
+    streambuf* oldIn = cin.rdbuf(in.rdbuf());
+    streambuf* oldOut = cout.rdbuf(out.rdbuf());
+    Result result;
+    result.returnCode = -1;
+    try {
+      Capture capture(log, Rope(cmd));
+      result.returnCode = capture.returnCode();
+      result.text = capture.text().str();
+      Rope line;
+      while (capture.nextLine(line)) {
+        result.lines += line.str() + "|";
+      }
+    } catch (EvalError& e) {
+      result.lines = "error";
+    }
+    cin.rdbuf(oldIn);
+    cout.rdbuf(oldOut);
+    result.sent = out.str();
+    return result;
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool test(const string& name, bool expected, bool observed) {
+  return test(name, string(expected ? "true" : "false"),
+              string(observed ? "true" : "false"));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  Log log;
+
+  // A capture that works
+  string path = tempFile("one\ntwo\n\nlast");
+  Result result = capture(log, "ls -l", "0 " + path);
+  test("the command goes to the shell", "CAPTURE:ls -l\n", result.sent);
+  test("the return code", "0", boost::lexical_cast<string>(result.returnCode));
+  test("the text", "one\ntwo\n\nlast", result.text);
+  test("the lines, with a last one with no newline", "one|two||last|",
+       result.lines);
+  test("the temporary file is removed", false, exists(path));
+
+  path = tempFile("");
+  result = capture(log, "true", "0 " + path);
+  test("empty output has no lines", "", result.lines);
+  test("empty output's file is removed", false, exists(path));
+
+  path = tempFile("out\n");
+  result = capture(log, "false", "1 " + path);
+  test("a failed command's return code", "1",
+       boost::lexical_cast<string>(result.returnCode));
+  test("a failed command's output", "out|", result.lines);
+  test("a failed command's file is removed", false, exists(path));
+
+  // Output that is larger than a page, so is mapped
+  string big;
+  for (int i = 0; i < 100000; ++i) {
+    big += boost::lexical_cast<string>(i) + "\n";
+  }
+  path = tempFile(big);
+  result = capture(log, "seq", "0 " + path);
+  test("large output", true, big == result.text);
+  test("large output's file is removed", false, exists(path));
+
+  // A newline would split the command over two lines to the shell
+  result = capture(log, "echo a\nrm -rf b", "0 /nonexistent");
+  test("a command with a newline is refused", "error", result.lines);
+  test("nothing reaches the shell", "", result.sent);
+
+  // Bad replies still remove the file they name
+  path = tempFile("x\n");
+  result = capture(log, "ls", "nonsense " + path);
+  test("a bad return code", "error", result.lines);
+  test("a bad return code's file is removed", false, exists(path));
+  result = capture(log, "ls", "0");
+  test("a reply with no file", "error", result.lines);
+  result = capture(log, "ls", "0 /nonexistent/test_capture");
+  test("a reply with a missing file", "error", result.lines);
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  return num_failed ? 1 : 0;
+}
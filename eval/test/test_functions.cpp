@@ -0,0 +1,197 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Function tests
+ *
+ * Functions defined in shok, from the parser's AST text through to their
+ * results: a plain call, a body that calls itself (whose nodes must be set
+ * aside and restored around the inner call), arguments that are literals or
+ * operators rather than variables, tail calls, return type checks, and errors
+ * that must leave the evaluator able to run the next statement.
+ */
+
+#include "EvalError.h"
+#include "Log.h"
+#include "Node.h"
+#include "Object.h"
+#include "RootNode.h"
+#include "Scope.h"
+#include "Token.h"
+#include "Value.h"
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_functions";
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  // Exposes the global scope, to read back the variables a test made
+  class TestRoot : public RootNode {
+  public:
+    TestRoot(Log& log) : RootNode(log) {}
+    Scope* scope() { return getScope(); }
+  };
+
+  // The parser's output for each line of shok
+  const string SQ = "[{(new (init ID:'sq' (exp (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {(return (exp (var ID:'n') STAR (var ID:'n')))}))))}]";
+  // fact(n): if n { new m = n - 1; return n * fact(m) }; return 1
+  const string FACT = "[{(new (init ID:'fact' (exp (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {(if (exp (var ID:'n')) {(new (init ID:'m' (exp (var ID:'n') MINUS INT:'1')));(return (exp (var ID:'n') STAR (call (var ID:'fact') (exp (var ID:'m')))))});(return (exp INT:'1'))}))))}]";
+  // count(n): if n { new m = n - 1; return count(m) + 1 }; return 0
+  const string COUNT = "[{(new (init ID:'count' (exp (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {(if (exp (var ID:'n')) {(new (init ID:'m' (exp (var ID:'n') MINUS INT:'1')));(return (exp (call (var ID:'count') (exp (var ID:'m'))) PLUS INT:'1'))});(return (exp INT:'0'))}))))}]";
+
+  // fact(n), calling itself on an operator: ... return n * fact2(n - 1) ...
+  const string FACT2 = "[{(new (init ID:'fact2' (exp (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {(if (exp (var ID:'n')) {(return (exp (var ID:'n') STAR (call (var ID:'fact2') (exp (var ID:'n') MINUS INT:'1'))))});(return (exp INT:'1'))}))))}]";
+
+  // sum(n, total): if n { return sum(n - 1, total + n) }; return total
+  const string SUM = "[{(new (init ID:'sum' (exp (func (arg ID:'n' (type (var ID:'int'))) (arg ID:'total' (type (var ID:'int'))) (type (var ID:'int')) {(if (exp (var ID:'n')) {(return (exp (call (var ID:'sum') (exp (var ID:'n') MINUS INT:'1') (exp (var ID:'total') PLUS (var ID:'n')))))});(return (exp (var ID:'total')))}))))}]";
+  // triangle(n): return sum(n, 0)
+  const string TRIANGLE = "[{(new (init ID:'triangle' (exp (func (arg ID:'n' (type (var ID:'int'))) (type (var ID:'int')) {(return (exp (call (var ID:'sum') (exp (var ID:'n')) (exp INT:'0'))))}))))}]";
+  // distance(a, b): return math.abs(a - b)
+  const string DISTANCE = "[{(new (init ID:'distance' (exp (func (arg ID:'a' (type (var ID:'int'))) (arg ID:'b' (type (var ID:'int'))) (type (var ID:'int')) {(return (exp (call (var ID:'math' ID:'abs') (exp (var ID:'a') MINUS (var ID:'b')))))}))))}]";
+
+  string newVar(const string& name, const string& exp) {
+    return "[{(new (init ID:'" + name + "' (exp " + exp + ")))}]";
+  }
+
+  string call(const string& function, const string& arg) {
+    return "(call (var ID:'" + function + "') (exp (var ID:'" + arg + "')))";
+  }
+
+  // Insert and evaluate one line, as AST does; "" or the error
+  string run(Log& log, TestRoot& root, const string& line) {
+    Tokenizer tokenizer;
+    Node* current = &root;
+    try {
+      Tokenizer::token_vec tokens = tokenizer.tokenize(log, line);
+      for (Tokenizer::token_iter i = tokens.begin(); i != tokens.end(); ++i) {
+        current = Node::InsertNode(log, current,
+                                   Node::MakeNode(log, &root, *i));
+      }
+      if (current != &root) {
+        root.reset();
+        return "error: incomplete line";
+      }
+      root.prepare();
+      root.evaluateNode();
+    } catch (EvalError& e) {
+      root.reset();
+      return string("error: ") + e.what();
+    } catch (RecoveredError& e) {
+      // The rest of the line was never inserted, so start over from the root
+      root.reset();
+      return string("error: ") + e.what();
+    }
+    return "";
+  }
+
+  // The value of a global variable
+  string value(TestRoot& root, const string& name) {
+    Object* object = root.scope()->getObject(name);
+    if (!object) return "no " + name;
+    return object->getValue().print();
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool testPrefix(const string& name, const string& prefix,
+                const string& observed) {
+  return test(name, prefix, observed.substr(0, prefix.size()));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  Log log;
+  TestRoot root(log);
+
+  test("arithmetic", "", run(log, root, newVar("x", "INT:'1' PLUS INT:'2' STAR INT:'3'")));
+  test("arithmetic value", "7", value(root, "x"));
+
+  test("define sq", "", run(log, root, SQ));
+  test("sq(x)", "", run(log, root, newVar("a", call("sq", "x"))));
+  test("sq(x) value", "49", value(root, "a"));
+
+  test("define count", "", run(log, root, COUNT));
+  test("count(x) calls itself", "", run(log, root, newVar("b", call("count", "x"))));
+  test("count(x) value", "7", value(root, "b"));
+
+  // n * fact(m) reads n after the inner call, so n must have been restored
+  test("define fact", "", run(log, root, FACT));
+  run(log, root, newVar("n", "INT:'25'"));
+  test("fact(25)", "", run(log, root, newVar("c", call("fact", "n"))));
+  test("fact(25) value", "15511210043330985984000000", value(root, "c"));
+  test("new zero", "", run(log, root, newVar("zero", "INT:'0'")));
+  run(log, root, newVar("d", call("fact", "zero")));
+  test("fact(0) value", "1", value(root, "d"));
+
+  run(log, root, newVar("deep", "INT:'2000'"));
+  testPrefix("count(2000) is too deep",
+             "error: Cannot call count; exceeded the maximum call depth",
+             run(log, root, newVar("e", call("count", "deep"))));
+  test("a call after an error", "", run(log, root, newVar("f", call("fact", "x"))));
+  test("a call after an error value", "5040", value(root, "f"));
+
+  // Arguments that are literals or operators
+  test("sq(3)", "", run(log, root, newVar("sq3", "(call (var ID:'sq') (exp INT:'3'))")));
+  test("sq(3) value", "9", value(root, "sq3"));
+  test("sq(x + 1)", "", run(log, root, newVar("sqx", "(call (var ID:'sq') (exp (var ID:'x') PLUS INT:'1'))")));
+  test("sq(x + 1) value", "64", value(root, "sqx"));
+  test("define fact2", "", run(log, root, FACT2));
+  test("fact2(20)", "", run(log, root, newVar("i", "(call (var ID:'fact2') (exp INT:'20'))")));
+  test("fact2(20) value", "2432902008176640000", value(root, "i"));
+  test("math.abs(-5)", "", run(log, root, newVar("j", "(call (var ID:'math' ID:'abs') (exp MINUS INT:'5'))")));
+  test("math.abs(-5) value", "5", value(root, "j"));
+  test("list.range(10)", "", run(log, root, newVar("k", "(call (var ID:'list' ID:'range') (exp INT:'10'))")));
+  test("list.range(10) value", "[0, 1, 2, 3, 4, 5, 6, 7, 8, 9]", value(root, "k"));
+  run(log, root, newVar("s", "STR:'ab'"));
+  test("str.concat(s, 'x')", "", run(log, root, newVar("l", "(call (var ID:'str' ID:'concat') (exp (var ID:'s')) (exp STR:'x'))")));
+  test("str.concat(s, 'x') value", "'abx'", value(root, "l"));
+
+  // Tail calls run in the caller's frame, so they recurse past the maximum
+  // call depth
+  test("define sum", "", run(log, root, SUM));
+  test("sum(100000, 0)", "", run(log, root, newVar("m", "(call (var ID:'sum') (exp INT:'100000') (exp INT:'0'))")));
+  test("sum(100000, 0) value", "5000050000", value(root, "m"));
+  test("define triangle", "", run(log, root, TRIANGLE));
+  test("triangle(x) + triangle(x)", "", run(log, root, newVar("o", "(call (var ID:'triangle') (exp (var ID:'x'))) PLUS (call (var ID:'triangle') (exp (var ID:'x')))")));
+  test("triangle(x) + triangle(x) value", "56", value(root, "o"));
+  test("define distance", "", run(log, root, DISTANCE));
+  test("distance(3, 10)", "", run(log, root, newVar("p", "(call (var ID:'distance') (exp INT:'3') (exp INT:'10'))")));
+  test("distance(3, 10) value", "7", value(root, "p"));
+
+  test("return outside a function", "error: Cannot return outside a function",
+       run(log, root, "[{(return (exp INT:'1'))}]"));
+  testPrefix("return of the wrong type", "error: Cannot return",
+             run(log, root, "[{(new (init ID:'g' (exp (func (type (var ID:'int')) {(return (exp STR:'x'))}))))}]"));
+  test("no return type", "",
+       run(log, root, "[{(new (init ID:'h' (exp (func {(return)}))))}]"));
+  testPrefix("redefine a function", "error: Variable sq already exists",
+             run(log, root, SQ));
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  return num_failed ? 1 : 0;
+}
@@ -0,0 +1,250 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* List tests
+ *
+ * The packed lane kernels (SSE2 where the compiler has it) must agree with
+ * plain BigInt arithmetic element by element: in the paired lanes and the
+ * scalar tail, at overflow in either lane of a pair, and after falling back
+ * to BigInt.  Binary operations broadcast a list of one element from either
+ * side.
+ */
+
+#include "BigInt.h"
+#include "EvalError.h"
+#include "List.h"
+#include "Operator.h"
+#include "Value.h"
+
+#include <iostream>
+#include <limits>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_list";
+  const int64_t INT64_MAX_ = numeric_limits<int64_t>::max();
+  const int64_t INT64_MIN_ = numeric_limits<int64_t>::min();
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  // A fixed sequence of pseudo-random numbers, so failures reproduce
+  uint64_t g_seed = 88172645463325252ULL;
+  uint64_t nextRandom() {
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+    return g_seed;
+  }
+
+  // Mostly small lanes, and some at the edges of the int64 range
+  int64_t randomLane() {
+    switch (nextRandom() % 8) {
+      case 0: return INT64_MAX_ - (int64_t)(nextRandom() % 4);
+      case 1: return INT64_MIN_ + (int64_t)(nextRandom() % 4);
+      case 2: return (int64_t)nextRandom();
+      default: return (int64_t)(nextRandom() % 2001) - 1000;
+    }
+  }
+
+  List ints(const vector<int64_t>& lanes) {
+    List list;
+    for (size_t i = 0; i < lanes.size(); ++i) {
+      list.push(Value::Int(lanes[i]));
+    }
+    return list;
+  }
+
+  List ints(int64_t a, int64_t b) {
+    vector<int64_t> lanes;
+    lanes.push_back(a);
+    lanes.push_back(b);
+    return ints(lanes);
+  }
+
+  List one(int64_t a) {
+    return ints(vector<int64_t>(1, a));
+  }
+
+  // Does each element of result equal op on the matching BigInts of a and
+  // b, broadcasting a list of one?  "ok", or the first element that is off
+  string checkElementwise(Operator::KIND kind, const vector<int64_t>& a,
+                          const vector<int64_t>& b) {
+    List result = List::Elementwise(kind, ints(a), ints(b));
+    size_t n = max(a.size(), b.size());
+    if (result.size() != n) return "wrong size";
+    for (size_t i = 0; i < n; ++i) {
+      BigInt x(a[1 == a.size() ? 0 : i]);
+      BigInt y(b[1 == b.size() ? 0 : i]);
+      BigInt expected = Operator::KIND_PLUS == kind ? x + y
+                      : Operator::KIND_MINUS == kind ? x - y : x * y;
+      if (result.at(i).getInt() != expected) {
+        return "element " + BigInt((int64_t)i).print() + ": " +
+               result.at(i).print() + " != " + expected.print();
+      }
+    }
+    return "ok";
+  }
+
+  string sum(const List& list) {
+    return list.sum().print();
+  }
+
+  string elementwise(Operator::KIND kind, const List& a, const List& b) {
+    try {
+      return List::Elementwise(kind, a, b).print();
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool test(const string& name, bool expected, bool observed) {
+  return test(name, string(expected ? "true" : "false"),
+              string(observed ? "true" : "false"));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  // Packing
+  List range = List::Range(20);
+  test("range(20) is packed", true, range.isPacked());
+  test("range(5)", "[0, 1, 2, 3, 4]", List::Range(5).print());
+  test("range(20) sum", "190", sum(range));
+  List boxed = List::Range(3);
+  boxed.push(Value::Int(BigInt::Parse("100000000000000000000")));
+  test("a BigInt boxes the list", false, boxed.isPacked());
+  test("boxed list", "[0, 1, 2, 100000000000000000000]", boxed.print());
+  test("boxed sum", "100000000000000000003", sum(boxed));
+
+  // The lane kernels against BigInt, over lengths that leave an SSE2 pair
+  // or a scalar tail, with lanes that overflow
+  string added = "ok";
+  string subtracted = "ok";
+  string multiplied = "ok";
+  for (size_t round = 0; round < 200; ++round) {
+    size_t n = 1 + nextRandom() % 21;
+    vector<int64_t> a;
+    vector<int64_t> b;
+    for (size_t i = 0; i < n; ++i) {
+      a.push_back(randomLane());
+      b.push_back(randomLane());
+    }
+    if ("ok" == added) added = checkElementwise(Operator::KIND_PLUS, a, b);
+    if ("ok" == subtracted) {
+      subtracted = checkElementwise(Operator::KIND_MINUS, a, b);
+    }
+    if ("ok" == multiplied) {
+      multiplied = checkElementwise(Operator::KIND_STAR, a, b);
+    }
+  }
+  test("random +, against BigInt", "ok", added);
+  test("random -, against BigInt", "ok", subtracted);
+  test("random *, against BigInt", "ok", multiplied);
+
+  // Overflow in one lane of an SSE2 pair, and in the scalar tail
+  test("overflow in the first lane of a pair",
+       "[9223372036854775808, 2]",
+       elementwise(Operator::KIND_PLUS, ints(INT64_MAX_, 1), ints(1, 1)));
+  test("overflow in the second lane of a pair",
+       "[2, 9223372036854775808]",
+       elementwise(Operator::KIND_PLUS, ints(1, INT64_MAX_), ints(1, 1)));
+  vector<int64_t> three(3, 1);
+  vector<int64_t> tail(3, 1);
+  tail[2] = INT64_MIN_;
+  test("overflow in the scalar tail", "[0, 0, -9223372036854775809]",
+       elementwise(Operator::KIND_MINUS, ints(tail), ints(three)));
+  test("INT64_MIN - INT64_MAX", "[-18446744073709551615, 0]",
+       elementwise(Operator::KIND_MINUS, ints(INT64_MIN_, 0), ints(INT64_MAX_, 0)));
+  test("overflowed result is boxed", false,
+       List::Elementwise(Operator::KIND_PLUS, ints(INT64_MAX_, 1),
+                         ints(1, 1)).isPacked());
+  test("no overflow stays packed", true,
+       List::Elementwise(Operator::KIND_PLUS, ints(INT64_MAX_ - 1, 1),
+                         ints(1, 1)).isPacked());
+
+  // sum() overflowing the SSE2 accumulator, or only when the halves meet
+  vector<int64_t> big(4, INT64_MAX_);
+  test("sum overflowing a lane", "36893488147419103228", sum(ints(big)));
+  test("sum overflowing when halves meet", "9223372036854775808",
+       sum(ints(INT64_MAX_, 1)));
+  vector<int64_t> cancel;
+  cancel.push_back(INT64_MAX_);
+  cancel.push_back(INT64_MIN_);
+  cancel.push_back(INT64_MAX_);
+  cancel.push_back(1);
+  cancel.push_back(-1);
+  test("sum that cancels", "9223372036854775806", sum(ints(cancel)));
+  test("sum of nothing", "0", sum(List()));
+
+  // find(): SSE2 compares 32-bit halves, so a lane that only matches in one
+  // half must not be found
+  vector<int64_t> halves;
+  halves.push_back(((int64_t)1 << 32) | 5);
+  halves.push_back(((int64_t)7 << 32) | 5);
+  halves.push_back(5);
+  halves.push_back(5);
+  List haystack = ints(halves);
+  test("find a low-half match", "2",
+       BigInt(haystack.find(Value::Int(5))).print());
+  test("find in the first lane", "0",
+       BigInt(haystack.find(Value::Int(((int64_t)1 << 32) | 5))).print());
+  test("find in the second lane", "1",
+       BigInt(haystack.find(Value::Int(((int64_t)7 << 32) | 5))).print());
+  test("find nothing", "-1",
+       BigInt(haystack.find(Value::Int(4))).print());
+  test("find a BigInt in a packed list", "-1",
+       BigInt(range.find(Value::Int(BigInt::Parse("100000000000000000000")))).print());
+  test("find in the scalar tail", "18",
+       BigInt(List::Range(19).find(Value::Int(18))).print());
+
+  // Broadcasting
+  List five = List::Range(5);
+  test("list + [10]", "[10, 11, 12, 13, 14]",
+       elementwise(Operator::KIND_PLUS, five, one(10)));
+  test("[10] - list", "[10, 9, 8, 7, 6]",
+       elementwise(Operator::KIND_MINUS, one(10), five));
+  test("[3] * list", "[0, 3, 6, 9, 12]",
+       elementwise(Operator::KIND_STAR, one(3), five));
+  test("[1] + [2]", "[3]", elementwise(Operator::KIND_PLUS, one(1), one(2)));
+  test("list + [INT64_MAX] overflows", "[9223372036854775807, 9223372036854775808]",
+       elementwise(Operator::KIND_PLUS, List::Range(2), one(INT64_MAX_)));
+  test("mismatched lengths", "error",
+       elementwise(Operator::KIND_PLUS, five, List::Range(3)));
+  test("broadcast a BigInt", "[100000000000000000000, 100000000000000000001]",
+       elementwise(Operator::KIND_PLUS, List::Range(2),
+                   List::Elementwise(Operator::KIND_STAR, one(10000000000LL),
+                                     one(10000000000LL))));
+  test("broadcast compare", "[0, 0, 1, 1, 1]",
+       List::Compare(Operator::KIND_GE, five, one(2)).print());
+  test("where", "[2, 3, 4]",
+       five.where(List::Compare(Operator::KIND_GE, five, one(2))).print());
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  return num_failed ? 1 : 0;
+}
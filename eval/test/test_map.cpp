@@ -0,0 +1,257 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Map tests
+ *
+ * A Map must iterate in insertion order through any mix of sets, overwrites
+ * and removals, across the rehashes that grow its table and the ones that
+ * only sweep out DELETED slots.  Random operations are checked against a
+ * plain model.  str and int keys never equal each other, however alike they
+ * print.
+ */
+
+#include "BigInt.h"
+#include "EvalError.h"
+#include "List.h"
+#include "Map.h"
+#include "Rope.h"
+#include "Value.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_map";
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  // A fixed sequence of pseudo-random numbers, so failures reproduce
+  uint64_t g_seed = 88172645463325252ULL;
+  uint64_t nextRandom() {
+    g_seed ^= g_seed << 13;
+    g_seed ^= g_seed >> 7;
+    g_seed ^= g_seed << 17;
+    return g_seed;
+  }
+
+  Value str(const string& s) {
+    return Value::Str(Rope(s));
+  }
+
+  Value num(int64_t i) {
+    return Value::Int(i);
+  }
+
+  // Keys from a small pool, so that sets hit existing keys and removals
+  // find them: half ints, half strs that print like them
+  Value randomKey(size_t pool) {
+    int64_t i = nextRandom() % pool;
+    if (nextRandom() % 2) {
+      return num(i);
+    }
+    return str(boost::lexical_cast<string>(i));
+  }
+
+  // What a Map should hold: entries in insertion order, by printed key
+  class Model {
+  public:
+    void set(const Value& key, const Value& value) {
+      string k = key.print();
+      map<string, size_t>::iterator i = m_index.find(k);
+      if (m_index.end() != i) {
+        m_entries[i->second].second = value.print();
+        return;
+      }
+      m_index[k] = m_entries.size();
+      m_entries.push_back(make_pair(k, value.print()));
+    }
+    // Leaves the entry in place, emptied, so the others keep their order
+    bool remove(const Value& key) {
+      map<string, size_t>::iterator i = m_index.find(key.print());
+      if (m_index.end() == i) return false;
+      m_entries[i->second].first = "";
+      m_index.erase(i);
+      return true;
+    }
+    string print() const {
+      string s = "{";
+      for (size_t n = 0; n < m_entries.size(); ++n) {
+        if (m_entries[n].first.empty()) continue;
+        if (s.size() > 1) s += ", ";
+        s += m_entries[n].first + ": " + m_entries[n].second;
+      }
+      return s + "}";
+    }
+    size_t size() const { return m_index.size(); }
+  private:
+    vector<pair<string, string> > m_entries;
+    map<string, size_t> m_index;
+  };
+
+  // The value at key, or "none"
+  string get(const Map& map, const Value& key) {
+    const Value* value = map.get(key);
+    return value ? value->print() : "none";
+  }
+
+  string setError(Map& map, const Value& key, const Value& value) {
+    try {
+      map.set(key, value);
+      return "ok";
+    } catch (EvalError& e) {
+      return "error";
+    }
+  }
+
+  // Run ops random operations on keys from pool against the model; "ok" or
+  // the first difference
+  string randomOps(size_t ops, size_t pool, unsigned removePercent) {
+    Map map;
+    Model model;
+    for (size_t n = 0; n < ops; ++n) {
+      Value key = randomKey(pool);
+      if (nextRandom() % 100 < removePercent) {
+        if (map.remove(key) != model.remove(key)) {
+          return "remove " + key.print() + " at op " + boost::lexical_cast<string>(n);
+        }
+      } else {
+        Value value = num(n);
+        map.set(key, value);
+        model.set(key, value);
+      }
+      if (map.size() != model.size()) {
+        return "size at op " + boost::lexical_cast<string>(n);
+      }
+      if (0 == n % 97 && map.print() != model.print()) {
+        return "order at op " + boost::lexical_cast<string>(n);
+      }
+    }
+    return map.print() == model.print() ? "ok" : "order at the end";
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool test(const string& name, bool expected, bool observed) {
+  return test(name, string(expected ? "true" : "false"),
+              string(observed ? "true" : "false"));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  // str vs int keys
+  Map map;
+  map.set(num(1), str("int"));
+  map.set(str("1"), str("str"));
+  test("1 and '1' are different keys", "2",
+       boost::lexical_cast<string>(map.size()));
+  test("get 1", "'int'", get(map, num(1)));
+  test("get '1'", "'str'", get(map, str("1")));
+  test("remove '1'", true, map.remove(str("1")));
+  test("1 is still there", "'int'", get(map, num(1)));
+  test("'1' is gone", "none", get(map, str("1")));
+  test("remove '1' again", false, map.remove(str("1")));
+  Rope built("a");
+  built += "b";
+  map.set(str("ab"), num(10));
+  test("a str key built up equals a literal one", "10",
+       get(map, Value::Str(built)));
+  BigInt big = BigInt::Parse("100000000000000000000");
+  map.set(Value::Int(big), str("big"));
+  test("a BigInt key", "'big'",
+       get(map, Value::Int(BigInt::Parse("100000000000000000000"))));
+  test("a BigInt key is not its str", "none",
+       get(map, str("100000000000000000000")));
+  test("a fixed key", "error", setError(map, Value::Fixed(1), num(1)));
+  test("a list key", "error",
+       setError(map, Value::NewList(List::Range(2)), num(1)));
+  test("a missing value", "error", setError(map, num(2), Value()));
+  test("before overwrite", "{1: 'int', 'ab': 10, 100000000000000000000: 'big'}",
+       map.print());
+  map.set(num(1), str("again"));
+  test("overwrite keeps the position",
+       "{1: 'again', 'ab': 10, 100000000000000000000: 'big'}", map.print());
+  map.remove(num(1));
+  map.set(num(1), str("back"));
+  test("remove then set goes to the end",
+       "{'ab': 10, 100000000000000000000: 'big', 1: 'back'}", map.print());
+
+  // Insertion order across growth and removals
+  Map grown;
+  for (int64_t i = 0; i < 1000; ++i) {
+    grown.set(i % 2 ? num(i) : str(boost::lexical_cast<string>(i)), num(i));
+  }
+  for (int64_t i = 1; i < 1000; i += 2) {
+    grown.remove(num(i));
+  }
+  // Growing again rehashes, which compacts the removed entries away
+  for (int64_t i = 1000; i < 3000; ++i) {
+    grown.set(num(i), num(i));
+  }
+  string order = "ok";
+  List keys = grown.keys();
+  List values = grown.values();
+  if (keys.size() != 2500 || values.size() != 2500) {
+    order = "size " + boost::lexical_cast<string>(keys.size());
+  }
+  for (size_t n = 0; n < keys.size() && "ok" == order; ++n) {
+    int64_t expected = n < 500 ? 2 * n : n + 500;
+    Value key = n < 500 ? str(boost::lexical_cast<string>(expected))
+                        : num(expected);
+    if (keys.at(n).print() != key.print() ||
+        values.at(n).print() != num(expected).print()) {
+      order = "entry " + boost::lexical_cast<string>(n) + " is " +
+              keys.at(n).print();
+    }
+  }
+  test("order across removals and growth", "ok", order);
+  test("removed keys stay gone", "none", get(grown, num(999)));
+  test("kept keys are found", "998", get(grown, str("998")));
+
+  // Churn: sets and removals that keep the size steady fill the table with
+  // DELETED slots, which a same-capacity rehash sweeps out
+  Map churn;
+  for (int64_t i = 0; i < 100000; ++i) {
+    churn.set(num(i), num(i));
+    if (i >= 10) churn.remove(num(i - 10));
+  }
+  test("churn size", "10", boost::lexical_cast<string>(churn.size()));
+  test("churn keeps the last 10 in order",
+       "[99990, 99991, 99992, 99993, 99994, 99995, 99996, 99997, 99998, 99999]",
+       churn.keys().print());
+
+  // Against the model
+  test("random ops, small pool", "ok", randomOps(20000, 40, 30));
+  test("random ops, large pool", "ok", randomOps(50000, 5000, 20));
+  test("random ops, mostly removals", "ok", randomOps(20000, 300, 60));
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  return num_failed ? 1 : 0;
+}
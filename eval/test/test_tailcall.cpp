@@ -0,0 +1,204 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+/* Tail call tests
+ *
+ * Natives that recurse a million deep through CallFrame::tailCall() must run
+ * in one frame, and so finish, without exhausting the call stack (or the C++
+ * stack).  Ordinary nesting past CallStack::MAX_DEPTH must be an EvalError.
+ */
+
+#include "CallStack.h"
+#include "EvalError.h"
+#include "Function.h"
+#include "Log.h"
+#include "Object.h"
+#include "Signature.h"
+#include "Type.h"
+#include "Value.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <iostream>
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+using namespace eval;
+
+namespace {
+  const string PROGRAM_NAME = "test_tailcall";
+  const int64_t DEEP = 1000000;
+  unsigned num_tests = 0;
+  unsigned num_failed = 0;
+
+  CallStack* g_stack = NULL;
+  size_t g_maxDepth = 0;
+  // Set up by main()
+  TypeRef g_int;
+  const Function* g_sum = NULL;
+  const Function* g_even = NULL;
+  const Function* g_odd = NULL;
+  const Function* g_nest = NULL;
+
+  int64_t intArg(CallFrame& frame, size_t n) {
+    int64_t i = 0;
+    frame.getArg(n)->getValue().getSmallInt(i);
+    return i;
+  }
+
+  Object* newInt(Log& log, int64_t i) {
+    Object* object = new Object(log, "int", g_int);
+    object->setValue(Value::Int(i));
+    return object;
+  }
+
+  void noteDepth() {
+    if (g_stack->depth() > g_maxDepth) g_maxDepth = g_stack->depth();
+  }
+
+  // Retarget frame at function, with new arguments
+  void tailCall(CallFrame& frame, const Function& function,
+                Object* arg0, Object* arg1 = NULL) {
+    frame.tailCall(function, *function.getSignature((size_t)(arg1 ? 2 : 1)));
+    frame.setArg(0, arg0);
+    if (arg1) frame.setArg(1, arg1);
+  }
+
+  // sum(n, total): n + ... + 1 + total
+  Object* sum(Log& log, CallFrame& frame) {
+    noteDepth();
+    int64_t n = intArg(frame, 0);
+    int64_t total = intArg(frame, 1);
+    if (0 == n) return newInt(log, total);
+    tailCall(frame, *g_sum, newInt(log, n - 1), newInt(log, total + n));
+    return NULL;
+  }
+
+  // even(n) and odd(n) call each other
+  Object* even(Log& log, CallFrame& frame) {
+    noteDepth();
+    int64_t n = intArg(frame, 0);
+    if (0 == n) return newInt(log, 1);
+    tailCall(frame, *g_odd, newInt(log, n - 1));
+    return NULL;
+  }
+
+  Object* odd(Log& log, CallFrame& frame) {
+    noteDepth();
+    int64_t n = intArg(frame, 0);
+    if (0 == n) return newInt(log, 0);
+    tailCall(frame, *g_even, newInt(log, n - 1));
+    return NULL;
+  }
+
+  // Not a tail call: nests a frame per level
+  Object* nest(Log& log, CallFrame& frame) {
+    int64_t n = intArg(frame, 0);
+    if (0 == n) return newInt(log, 0);
+    CallFrame inner(*g_stack, *g_nest, frame.signature());
+    inner.setArg(0, newInt(log, n - 1));
+    return g_nest->call(inner);
+  }
+
+  const Function* define(Log& log, const string& name, size_t argc,
+                         native_fn native) {
+    argspec_list args;
+    for (size_t n = 0; n < argc; ++n) {
+      args.push_back(ArgSpec("arg" + boost::lexical_cast<string>(n), g_int,
+                             NULL));
+    }
+    Function* function = new Function(log, name, g_int,
+                                      Signature(args, g_int, native));
+    function->retain();
+    return function;
+  }
+
+  // Call function on one or two ints; the result as text, or the error
+  string run(Log& log, const Function& function, int64_t arg0,
+             int64_t arg1 = -1) {
+    g_maxDepth = 0;
+    try {
+      Object* result;
+      {
+        CallFrame frame(*g_stack, function,
+                        *function.getSignature((size_t)(arg1 < 0 ? 1 : 2)));
+        frame.setArg(0, newInt(log, arg0));
+        if (arg1 >= 0) frame.setArg(1, newInt(log, arg1));
+        result = function.call(frame);
+        if (!result) return "no result";
+        result->retain();
+      }
+      string text = result->getValue().print();
+      result->release();
+      return text;
+    } catch (EvalError& e) {
+      return string("error: ") + e.what();
+    }
+  }
+};
+
+bool test(const string& name, const string& expected, const string& observed) {
+  ++num_tests;
+  if (observed == expected) {
+    cout << "pass: " << name << endl;
+    return true;
+  }
+  ++num_failed;
+  cout << "FAIL: " << name << endl;
+  cout << " - expected: '" << expected << "'" << endl;
+  cout << " - observed: '" << observed << "'" << endl;
+  return false;
+}
+
+bool testPrefix(const string& name, const string& prefix,
+                const string& observed) {
+  return test(name, prefix, observed.substr(0, prefix.size()));
+}
+
+int main(int argc, char* argv[]) {
+  if (argc != 1) {
+    cout << "usage: " << PROGRAM_NAME << endl;
+    return 1;
+  }
+
+  Log log;
+  CallStack stack;
+  g_stack = &stack;
+  Object* intObject = new Object(log, "int", NullType::Get());
+  intObject->retain();
+  g_int = BasicType::Get(*intObject);
+  g_sum = define(log, "sum", 2, sum);
+  g_even = define(log, "even", 1, even);
+  g_odd = define(log, "odd", 1, odd);
+  g_nest = define(log, "nest", 1, nest);
+
+  string deep = boost::lexical_cast<string>(DEEP);
+  test("sum(" + deep + ", 0)", "500000500000", run(log, *g_sum, DEEP, 0));
+  test("sum runs in one frame", "1",
+       boost::lexical_cast<string>(g_maxDepth));
+  test("even(" + deep + ")", "1", run(log, *g_even, DEEP));
+  test("odd(" + deep + ")", "0", run(log, *g_odd, DEEP));
+  test("even/odd run in one frame", "1",
+       boost::lexical_cast<string>(g_maxDepth));
+  test("frames are popped", "0", boost::lexical_cast<string>(stack.depth()));
+  test("nest(100)", "0", run(log, *g_nest, 100));
+  testPrefix("nest(" + deep + ") is an error",
+             "error: Cannot call nest; exceeded the maximum call depth",
+             run(log, *g_nest, DEEP));
+  test("frames are popped after an error", "0",
+       boost::lexical_cast<string>(stack.depth()));
+
+  cout << endl;
+  cout << "----------" << endl;
+  cout << "Ran " << num_tests << " test" << (1==num_tests?"":"s") << endl;
+  cout << endl;
+
+  g_nest->release();
+  g_odd->release();
+  g_even->release();
+  g_sum->release();
+  g_int = TypeRef();
+  intObject->release();
+  return num_failed ? 1 : 0;
+}
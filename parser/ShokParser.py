@@ -224,13 +224,18 @@ Object = Seq('object',
   [('LBRACE','(object'), n, ObjectBody, w, ('RBRACE',')')]
 )
 
-TypeList = Seq('typelist',
-  [Future('Type'),
-    Star('types', Seq('commatype', [w, ('COMMA',' '), n, Future('Type')]))]
+# Each argument is named, so that the body can refer to it
+FunctionArg = (Seq('functionarg',
+  ['ID', w, ('COLON',' '), n, Future('Type')]
+), '(arg %s)')
+
+ArgList = Seq('arglist',
+  [FunctionArg,
+    Star('args', Seq('commaarg', [w, ('COMMA',' '), n, FunctionArg]))]
 )
 
 FunctionArgs = Seq('functionargs',
-  [('LPAREN',''), n, (Opt(TypeList),' %s'), ('RPAREN','')]
+  [('LPAREN',''), n, (Opt(ArgList),'%s'), ('RPAREN','')]
 )
 
 FunctionReturn = Seq('functionreturn',
@@ -238,12 +243,19 @@ FunctionReturn = Seq('functionreturn',
 )
 
 Function = (Seq('function',
-  [('AT',''), w, (Opt(FunctionArgs),'(args%s) '), w,
-    (Opt(FunctionReturn),'(returns %s) '), w, Future('CodeBlock')]
+  [('AT',''), w, (Opt(FunctionArgs),'%s '), w,
+    (Opt(FunctionReturn),'%s '), w, Future('CodeBlock')]
 ), '(func %s)')
 
+# A call is an atom too, so that its result can be used in an expression.
+# Its ( must follow the name directly, or the name alone would be ambiguous.
+ProcCall = (Seq('proccall',
+  [Var, ('LPAREN',''), n, Future('ExpList'), n, ('RPAREN','')]
+), '(call %s)')
+
 Atom = Or('atom', [
   Literal,
+  ProcCall,
   List,
   Parens,
   Object,
@@ -266,8 +278,7 @@ Replace(BinopExp, 2, SubExp)
 
 Exp = (SubExp, '(exp %s)')
 Type = (SubExp, '(type %s)')
-Replace(TypeList, 'Type', Type)
-Replace(TypeList.items[1].items, 'Type', Type)
+Replace(FunctionArg[0], 'Type', Type)
 Replace(FunctionReturn, 'Type', Type)
 
 
@@ -331,6 +342,7 @@ ExpList = Seq('explist',
   [(Exp,' %s'), Star('explists', Seq('commaexp', [w, ('COMMA',' '), n, Exp]))],
 )
 Replace(List, 'ExpList', ExpList)
+Replace(ProcCall[0], 'ExpList', Opt(ExpList))
 
 StmtProcCall = (Seq('stmtproccall',
   [Var, w, ('LPAREN',''), n, Opt(ExpList), n, ('RPAREN','')]
@@ -412,8 +424,9 @@ StmtBreak = Or('stmtbreak', [
   ('CONTINUE','continue'),
   #Seq('continuelabel',
   #  [('CONTINUE','continue'), ws, ('LABEL','<label>')]),
-  Seq('return',
-    [('RETURN','return'), Opt(Seq('returnexp', [(ws,''), (Exp,' %s')]))]),
+  (Seq('return',
+    [('RETURN',''), Opt(Seq('returnexp', [(ws,''), (Exp,' %s')]))]),
+    '(return%s)'),
   Seq('yield',
     [('YIELD','yield'), ws, Exp]),
 ])
@@ -15,10 +15,12 @@
  */
 
 #include "Proc.h"
+#include "ScriptCache.h"
 #include "Util.h"
 
 #include <boost/tokenizer.hpp>
 
+#include <fstream>
 #include <iostream>
 #include <stdlib.h>
 #include <string>
@@ -34,6 +36,15 @@ using std::vector;
 namespace {
   const string PROGRAM_NAME = "shok";
   const string PROMPT = "shok: ";
+  const string LEXER = "./shok_lexer";
+  const string PARSER = "./shok_parser";
+  const string EVAL = "./shok_eval";
+  // What the front-end is built or run from, for the ScriptCache
+  const char* const FRONT_END_SOURCES[] = {
+    "parser/*.py",
+    "lexer/*.qx",
+    "lexer/*.cpp",
+  };
 };
 
 string runBuiltin_cd(const vector<string>& args) {
@@ -78,7 +89,8 @@ struct CmdResult {
   }
 };
 
-CmdResult runCommand(string cmd) {
+// Run a command.  Its stdout goes to outfd if that is given, else ours.
+CmdResult runCommand(string cmd, int outfd = -1) {
   // Parse the cmd into something exec-able.
   // Check if the program name is a shell built-in before we try to exec it.
   // TODO: allow escaped spaces in the program name
@@ -96,6 +108,7 @@ CmdResult runCommand(string cmd) {
   Proc cmdProc("cmd");
   cmdProc.cmd = "";
   cmdProc.pipechat = false;
+  cmdProc.outfd = outfd;
   for (tok_t::const_iterator i = tok.begin(); i != tok.end(); ++i) {
     if ("" == cmdProc.cmd) {
       cmdProc.cmd = *i;
@@ -128,80 +141,179 @@ CmdResult runCommand(string cmd) {
   return CmdResult(WEXITSTATUS(status));
 }
 
+// Run a command with its stdout going into a new temporary file, for the
+// evaluator to map and then remove.  The file's path is left in path, or ""
+// if it could not be made (and the command was not run).
+CmdResult captureCommand(const string& cmd, string& path) {
+  const char* tmpdir = getenv("TMPDIR");
+  string pattern = string(tmpdir && *tmpdir ? tmpdir : "/tmp") +
+                   "/shok-capture.XXXXXX";
+  vector<char> name(pattern.begin(), pattern.end());
+  name.push_back('\0');
+  int fd = mkstemp(&name[0]);
+  if (-1 == fd) {
+    perror(("Cannot make a file to capture \"" + cmd + "\"").c_str());
+    path = "";
+    return CmdResult();
+  }
+  path = &name[0];
+  CmdResult result = runCommand(cmd, fd);
+  close(fd);
+  return result;
+}
+
+// Send a line of input through the lexer and parser, returning the AST
+string frontEnd(Proc& lexer, Proc& parser, const string& line) {
+  // send line to lexer
+  lexer.out << line << endl;
+
+  // get tokens
+  string tokens;
+  std::getline(lexer.in, tokens);
+
+  // send tokens to parser
+  parser.out << tokens << endl;
+
+  // get AST
+  string ast;
+  std::getline(parser.in, ast);
+  return ast;
+}
+
+// Have the evaluator run an AST line, including any commands it asks for.
+// Returns false if the evaluator reported an error.
+bool evaluate(Proc& eval, string ast) {
+  if ("::Parse error:" == ast.substr(0, 14)) {
+    cout << "[shell] parser: " << ast.substr(15) << endl;
+    ast = "";   // skip eval
+  }
+
+  // send AST to eval
+  eval.out << ast << endl;
+
+  // get commands or result
+  string eval_result;
+  while (true) {
+    std::getline(eval.in, eval_result);
+    if ("" == eval_result) {
+      break;
+    } else if ("CMD:" == eval_result.substr(0, 4)) {
+      string cmd = eval_result.substr(4);
+      CmdResult cmd_result = runCommand(cmd);
+      // send back the command return-code to the evaluator
+      eval.out << cmd_result.print() << endl;
+    } else if ("CAPTURE:" == eval_result.substr(0, 8)) {
+      string cmd = eval_result.substr(8);
+      string path;
+      CmdResult cmd_result = captureCommand(cmd, path);
+      // send back the return-code and where the output is
+      eval.out << cmd_result.print();
+      if ("" != path) {
+        eval.out << " " << path;
+      }
+      eval.out << endl;
+    } else if ("PRINT:" == eval_result.substr(0, 6)) {
+      cout << "[shell]: " << eval_result.substr(6) << endl;
+    } else {
+      // Unexpected communication from the evaluator, probably but not
+      // necessarily starting with 'ERROR:'.  Grab up to a max of 20 lines
+      // from the evaluator until we hit "" or give up.  This makes sure we
+      // eat any CMDs that could have otherwise happened after the error.
+      const int MAX_ERROR_COUNT = 20;
+      int error_count = 1;
+      while ("" != eval_result && error_count <= MAX_ERROR_COUNT) {
+        cout << "[shell] eval: '" << eval_result << "'" << endl;
+        std::getline(eval.in, eval_result);
+        ++error_count;
+      }
+      if (MAX_ERROR_COUNT == error_count) {
+        cout << "[shell] eval: found 20 errors; aborting" << endl;
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+// Run a script file.  The front-end output for the script is cached on disk,
+// so that on later runs the lexer and parser need not be started at all.
+// Returns nonzero if the evaluator reported an error for any line.
+int runScript(const string& filename) {
+  std::ifstream file(filename.c_str());
+  if (!file) {
+    cerr << PROGRAM_NAME << ": cannot open script " << filename << endl;
+    return 1;
+  }
+  vector<string> lines;
+  string source;
+  string line;
+  while (std::getline(file, line)) {
+    lines.push_back(line);
+    source += line + "\n";
+  }
+
+  vector<string> programs;
+  programs.push_back(LEXER);
+  programs.push_back(PARSER);
+  programs.push_back(EVAL);
+  vector<string> sources(FRONT_END_SOURCES, FRONT_END_SOURCES +
+      sizeof(FRONT_END_SOURCES) / sizeof(FRONT_END_SOURCES[0]));
+  ScriptCache cache(programs, sources);
+  vector<string> asts;
+  if (!cache.load(source, asts)) {
+    Proc lexer(LEXER);
+    lexer.run();
+
+    Proc parser(PARSER);
+    parser.run();
+
+    for (vector<string>::const_iterator i = lines.begin();
+         i != lines.end(); ++i) {
+      asts.push_back(frontEnd(lexer, parser, *i));
+    }
+    lexer.finish();
+    parser.finish();
+    cache.store(source, asts);
+  }
+
+  Proc eval(EVAL);
+  eval.run();
+  bool failed = false;
+  for (vector<string>::const_iterator i = asts.begin(); i != asts.end(); ++i) {
+    if (!evaluate(eval, *i)) {
+      failed = true;
+      // TODO: signal the Parser to restart parsing
+    }
+  }
+  eval.finish();
+
+  while (wait(NULL) > 0) {}
+  return failed ? 1 : 0;
+}
+
 int main(int argc, char *argv[]) {
-  if (1 != argc) {
-    cout << "usage: " << PROGRAM_NAME << endl;
+  if (argc > 2) {
+    cout << "usage: " << PROGRAM_NAME << " [script]" << endl;
     return 1;
   }
+  if (2 == argc) {
+    return runScript(argv[1]);
+  }
 
-  Proc lexer("./shok_lexer");
+  Proc lexer(LEXER);
   lexer.run();
 
-  Proc parser("./shok_parser");
+  Proc parser(PARSER);
   parser.run();
 
-  Proc eval("./shok_eval");
+  Proc eval(EVAL);
   eval.run();
 
   cout << PROMPT;
   string line;
   while (std::getline(cin, line)) {
-    // send line to lexer
-    lexer.out << line << endl;
-
-    // get tokens
-    string tokens;
-    std::getline(lexer.in, tokens);
-
-    // send tokens to parser
-    parser.out << tokens << endl;
-
-    // get AST
-    string ast;
-    std::getline(parser.in, ast);
-    if ("::Parse error:" == ast.substr(0, 14)) {
-      cout << "[shell] parser: " << ast.substr(15) << endl;
-      ast = "";   // skip eval
-    }
-
-    // send AST to eval
-    eval.out << ast << endl;
-
-    // get commands or result
-    string eval_result;
-    bool error = false;
-    while (true) {
-      std::getline(eval.in, eval_result);
-      if ("" == eval_result) {
-        break;
-      } else if ("CMD:" == eval_result.substr(0, 4)) {
-        string cmd = eval_result.substr(4);
-        CmdResult cmd_result = runCommand(cmd);
-        // send back the command return-code to the evaluator
-        eval.out << cmd_result.print() << endl;
-      } else if ("PRINT:" == eval_result.substr(0, 6)) {
-        cout << "[shell]: " << eval_result.substr(6) << endl;
-      } else {
-        // Unexpected communication from the evaluator, probably but not
-        // necessarily starting with 'ERROR:'.  Grab up to a max of 20 lines
-        // from the evaluator until we hit "" or give up.  This makes sure we
-        // eat any CMDs that could have otherwise happened after the error.
-        const int MAX_ERROR_COUNT = 20;
-        int error_count = 1;
-        while ("" != eval_result && error_count <= MAX_ERROR_COUNT) {
-          cout << "[shell] eval: '" << eval_result << "'" << endl;
-          std::getline(eval.in, eval_result);
-          ++error_count;
-        }
-        if (MAX_ERROR_COUNT == error_count) {
-          cout << "[shell] eval: found 20 errors; aborting" << endl;
-        }
-        error = true;
-        break;
-      }
-    }
-
-    if (error) {
+    string ast = frontEnd(lexer, parser, line);
+    if (!evaluate(eval, ast)) {
       // TODO: signal the Parser to restart parsing
     }
 
@@ -47,6 +47,7 @@ public:
     : name(name),
       cmd(name),
       pipechat(true),
+      outfd(-1),
       env(environ) {}
 
   ~Proc() {
@@ -89,6 +90,9 @@ public:
         // set stdin and stdout line-buffered
         setlinebuf(stdout);
         setlinebuf(stdin);
+      } else if (-1 != outfd && STDOUT_FILENO != outfd) {
+        dupPipe(outfd, STDOUT_FILENO, "child output");
+        closePipe(outfd, "child output after dup");
       }
 
       child_exec();
@@ -119,6 +123,9 @@ public:
   // stdin/stdout.  Default: true.  If false, the child inherits the parent's
   // stdin/stdout (sketchy).
   bool pipechat;
+  // If not -1 (the default), the child's stdout instead of the parent's.
+  // Only used when pipechat is false.
+  int outfd;
   pid_t pid;
   std::string cmd;      // command for child to invoke; defaults to name
   std::vector<std::string> args;  // args for the command
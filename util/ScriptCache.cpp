@@ -0,0 +1,156 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#include "ScriptCache.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <errno.h>
+#include <fstream>
+#include <glob.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <vector>
+using std::string;
+using std::vector;
+
+const int ScriptCache::VERSION;
+const char* const ScriptCache::HEADER = "shok-script-cache";
+
+ScriptCache::ScriptCache(const vector<string>& programs,
+                         const vector<string>& sources)
+  : dir(cacheDir()),
+    fingerprint("v" + boost::lexical_cast<string>(VERSION)) {
+  for (vector<string>::const_iterator i = programs.begin();
+       i != programs.end(); ++i) {
+    addFile(*i);
+  }
+  for (vector<string>::const_iterator i = sources.begin();
+       i != sources.end(); ++i) {
+    glob_t matches;
+    // Matches come back sorted, so the fingerprint is stable
+    if (0 != glob(i->c_str(), 0, NULL, &matches)) {
+      fingerprint += " " + *i + ":missing";
+    } else {
+      for (size_t n = 0; n < matches.gl_pathc; ++n) {
+        addFile(matches.gl_pathv[n]);
+      }
+    }
+    globfree(&matches);
+  }
+}
+
+bool ScriptCache::load(const string& source, line_vec& asts) const {
+  if ("" == dir) return false;
+  std::ifstream in(entryPath(source).c_str());
+  if (!in) return false;
+  string header;
+  string fp;
+  string count;
+  if (!std::getline(in, header) || header != HEADER ||
+      !std::getline(in, fp) || fp != fingerprint + keySuffix(source) ||
+      !std::getline(in, count)) {
+    return false;
+  }
+  size_t n;
+  try {
+    n = boost::lexical_cast<size_t>(count);
+  } catch (boost::bad_lexical_cast&) {
+    return false;
+  }
+  line_vec lines;
+  lines.reserve(n);
+  string line;
+  for (size_t i = 0; i < n; ++i) {
+    if (!std::getline(in, line)) return false;
+    lines.push_back(line);
+  }
+  asts.swap(lines);
+  return true;
+}
+
+void ScriptCache::store(const string& source, const line_vec& asts) const {
+  if ("" == dir || !makeDirs(dir)) return;
+  string path = entryPath(source);
+  string tmp = path + "." + boost::lexical_cast<string>(getpid());
+  {
+    std::ofstream out(tmp.c_str());
+    if (!out) return;
+    out << HEADER << "\n" << fingerprint << keySuffix(source) << "\n"
+        << asts.size() << "\n";
+    for (line_vec::const_iterator i = asts.begin(); i != asts.end(); ++i) {
+      out << *i << "\n";
+    }
+    out.flush();
+    if (!out) {
+      unlink(tmp.c_str());
+      return;
+    }
+  }
+  if (0 != rename(tmp.c_str(), path.c_str())) {
+    unlink(tmp.c_str());
+  }
+}
+
+/* private */
+
+void ScriptCache::addFile(const string& path) {
+  struct stat st;
+  std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+  if (0 != stat(path.c_str(), &st) || !in) {
+    fingerprint += " " + path + ":missing";
+    return;
+  }
+  uint64_t h = hash("");
+  char buf[65536];
+  while (in.read(buf, sizeof(buf)) || in.gcount() > 0) {
+    h = hash(buf, in.gcount(), h);
+  }
+  fingerprint += " " + path + ":" +
+                 boost::lexical_cast<string>(st.st_size) + ":" +
+                 boost::lexical_cast<string>(st.st_mtime) + ":" + hex(h);
+}
+
+uint64_t ScriptCache::hash(const char* s, size_t n, uint64_t h) {
+  for (size_t i = 0; i < n; ++i) {
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+string ScriptCache::hex(uint64_t h) {
+  char buf[17];
+  snprintf(buf, sizeof(buf), "%016llx", (unsigned long long)h);
+  return buf;
+}
+
+string ScriptCache::cacheDir() {
+  const char* xdg = getenv("XDG_CACHE_HOME");
+  if (xdg && *xdg) return string(xdg) + "/shok";
+  const char* home = getenv("HOME");
+  if (home && *home) return string(home) + "/.cache/shok";
+  return "";
+}
+
+bool ScriptCache::makeDirs(const string& path) {
+  for (size_t pos = path.find('/', 1); ; pos = path.find('/', pos + 1)) {
+    string sub = path.substr(0, pos);
+    if (-1 == mkdir(sub.c_str(), 0700) && EEXIST != errno) return false;
+    if (string::npos == pos) return true;
+  }
+}
+
+string ScriptCache::keySuffix(const string& source) const {
+  return " " + hex(hash(source)) + ":" +
+         boost::lexical_cast<string>(source.length());
+}
+
+string ScriptCache::entryPath(const string& source) const {
+  return dir + "/" + hex(hash(source, hash(fingerprint)));
+}
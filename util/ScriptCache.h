@@ -0,0 +1,79 @@
+// Copyright (C) 2013 Michael Biggs.  See the COPYING file at the top-level
+// directory of this distribution and at http://shok.io/code/copyright.html
+
+#ifndef _ScriptCache_h_
+#define _ScriptCache_h_
+
+/* On-disk cache of front-end output for script files
+ *
+ * Lexing and parsing a script (the parser is a separate Python process) is
+ * most of the cost of running a short script.  A ScriptCache remembers the
+ * parser's output -- one AST line per script line -- for a script's contents,
+ * so that later runs can hand it straight to the evaluator without starting
+ * the lexer or parser at all.
+ *
+ * Entries are keyed by a hash of the script contents, the cache format
+ * version, and a fingerprint of the front-end programs, of the evaluator,
+ * which holds the standard library, and of the front-end sources.  The
+ * sources matter because the parser is a script: its program is only the
+ * entry point, and the grammar lives in the modules it imports.  Each file's
+ * fingerprint is its size, mtime and a hash of its contents, so that
+ * rebuilding or editing any of them invalidates every entry, even within the
+ * mtime's one-second resolution or when a copy keeps the old mtime.
+ *
+ * Entries live in $XDG_CACHE_HOME/shok, or ~/.cache/shok, one file per key;
+ * they are written to a temporary file and renamed into place so a
+ * concurrent reader never sees a partial entry.
+ *
+ * Any problem with the cache (missing directory, unreadable or corrupt entry)
+ * just results in a miss; it never stops the script from running.
+ */
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class ScriptCache {
+public:
+  typedef std::vector<std::string> line_vec;
+
+  // Bump this whenever the format of an entry, or of the AST, changes
+  static const int VERSION = 1;
+
+  // programs: paths of the front-end and evaluator executables
+  // sources: glob patterns for the files the front-end is built or run from
+  ScriptCache(const std::vector<std::string>& programs,
+              const std::vector<std::string>& sources);
+
+  // Fills asts and returns true if there is a valid entry for source
+  bool load(const std::string& source, line_vec& asts) const;
+  // Save the front-end output for source.  Failures are ignored.
+  void store(const std::string& source, const line_vec& asts) const;
+
+private:
+  static const char* const HEADER;
+
+  // Add path's size, mtime and content hash to the fingerprint
+  void addFile(const std::string& path);
+
+  // 64-bit FNV-1a, continuing from h
+  static uint64_t hash(const char* s, size_t n,
+                       uint64_t h = 14695981039346656037ULL);
+  static uint64_t hash(const std::string& s,
+                       uint64_t h = 14695981039346656037ULL) {
+    return hash(s.data(), s.size(), h);
+  }
+  static std::string hex(uint64_t h);
+  static std::string cacheDir();
+  static bool makeDirs(const std::string& path);
+
+  // The content hash and length are also recorded inside the entry, so a
+  // hash collision on the file name is caught when loading.
+  std::string keySuffix(const std::string& source) const;
+  std::string entryPath(const std::string& source) const;
+
+  const std::string dir;
+  std::string fingerprint;
+};
+
+#endif // _ScriptCache_h_